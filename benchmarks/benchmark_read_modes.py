@@ -0,0 +1,80 @@
+'''Benchmarks patch extraction throughput of each read mode
+
+Usage:
+    python benchmarks/benchmark_read_modes.py --shape 16 256 256 256 --num-patches 2000
+
+Random patches are sampled from a generated npy file. To measure cold reads, drop the page cache
+between modes, e.g. `sync; echo 3 > /proc/sys/vm/drop_caches`, or pass a file larger than RAM via
+--fpath. ReadMode.direct always bypasses the page cache.
+'''
+import argparse
+import os
+import time
+import numpy as np
+
+from npy_patcher import PatcherSessionFloat, ReadMode
+
+
+def parse_args():
+    '''Parses command line arguments'''
+    parser = argparse.ArgumentParser(description=__doc__.split('\n', maxsplit=1)[0])
+    parser.add_argument('--fpath', default=None, help='Existing float32 npy file to read')
+    parser.add_argument('--shape', type=int, nargs='+', default=[16, 128, 128, 128])
+    parser.add_argument('--qidx', type=int, nargs='+', default=[0, 3, 5, 7])
+    parser.add_argument('--pshape', type=int, nargs='+', default=[32, 32, 32])
+    parser.add_argument('--pstride', type=int, nargs='+', default=[16, 16, 16])
+    parser.add_argument('--num-patches', type=int, default=1000)
+    parser.add_argument('--batch-size', type=int, default=64)
+    parser.add_argument('--num-threads', type=int, default=1)
+    parser.add_argument(
+        '--modes',
+        nargs='+',
+        default=['stream', 'pread', 'mmap', 'uring', 'direct'],
+        choices=list(ReadMode.__members__),
+    )
+    return parser.parse_args()
+
+
+def benchmark(fpath, args, mode, pnums):
+    '''Extracts pnums in batches, returns patches per second and MB per second'''
+    session = PatcherSessionFloat(fpath, args.qidx, args.pshape, args.pstride, mode=mode)
+    start = time.perf_counter()
+    for i in range(0, len(pnums), args.batch_size):
+        session.get_patches(pnums[i : i + args.batch_size], num_threads=args.num_threads)
+    elapsed = time.perf_counter() - start
+    patch_bytes = session.get_patch_size() * np.dtype(np.float32).itemsize
+    return len(pnums) / elapsed, len(pnums) * patch_bytes / elapsed / 1e6
+
+
+def main():
+    '''Runs benchmark for each read mode'''
+    args = parse_args()
+    fpath = args.fpath
+    if fpath is None:
+        fpath = 'benchmark_read_modes.npy'
+        data = np.lib.format.open_memmap(
+            fpath, mode='w+', dtype=np.float32, shape=tuple(args.shape)
+        )
+        data[...] = np.random.randn(*args.shape).astype(np.float32)
+        del data
+    try:
+        session = PatcherSessionFloat(fpath, args.qidx, args.pshape, args.pstride)
+        rng = np.random.default_rng(0)
+        pnums = rng.integers(0, np.prod(session.get_num_patches()), args.num_patches).tolist()
+        del session
+
+        print(f'{"mode":>8} {"patches/s":>12} {"MB/s":>10}')
+        for name in args.modes:
+            try:
+                patches_per_s, mb_per_s = benchmark(fpath, args, ReadMode.__members__[name], pnums)
+            except RuntimeError as err:
+                print(f'{name:>8} {"skipped":>12}  ({err})')
+                continue
+            print(f'{name:>8} {patches_per_s:>12.1f} {mb_per_s:>10.1f}')
+    finally:
+        if args.fpath is None:
+            os.remove(fpath)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,298 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>  // std::min
+#include <cstring>    // std::memcpy
+#include <stdexcept>  // std::runtime_error
+
+#include "src/block_cache.hpp"
+
+
+namespace block_cache {
+
+
+LruPolicy::LruPolicy(size_t num_slots) : positions(num_slots) {}
+
+
+void LruPolicy::insert(size_t slot) {
+    order.push_front(slot);
+    positions[slot] = order.begin();
+}
+
+
+void LruPolicy::access(size_t slot) {
+    order.splice(order.begin(), order, positions[slot]);
+}
+
+
+size_t LruPolicy::victim() {
+    size_t slot = order.back();
+    order.pop_back();
+    return slot;
+}
+
+
+ClockPolicy::ClockPolicy(size_t num_slots) : referenced(num_slots, 0), hand(0) {}
+
+
+void ClockPolicy::insert(size_t slot) {
+    referenced[slot] = 1;
+}
+
+
+void ClockPolicy::access(size_t slot) {
+    referenced[slot] = 1;
+}
+
+
+size_t ClockPolicy::victim() {
+    while (referenced[hand]) {
+        referenced[hand] = 0;
+        hand = (hand + 1) % referenced.size();
+    }
+    size_t slot = hand;
+    hand = (hand + 1) % referenced.size();
+    return slot;
+}
+
+
+/**
+ * @brief Creates an eviction policy
+ *
+ * @param policy Policy type
+ * @param num_slots Number of cache slots
+ * @return std::unique_ptr<EvictionPolicy> Eviction policy
+ */
+std::unique_ptr<EvictionPolicy> make_policy(Policy policy, size_t num_slots) {
+    switch (policy) {
+        case Policy::lru:
+            return std::make_unique<LruPolicy>(num_slots);
+        case Policy::clock:
+            return std::make_unique<ClockPolicy>(num_slots);
+        default:
+            throw std::runtime_error("Unrecognised eviction policy.");
+    }
+}
+
+
+/**
+ * @brief Construct a new BlockCache object
+ *
+ * @param budget Memory budget in bytes, 0 disables the cache
+ * @param block_size Block size in bytes
+ * @param policy Eviction policy
+ */
+BlockCache::BlockCache(size_t budget, size_t block_size, Policy policy) {
+    configure(budget, block_size, policy);
+}
+
+
+/**
+ * @brief Sets the memory budget, block size and eviction policy, dropping all cached blocks.
+ *
+ * @param budget Memory budget in bytes, 0 disables the cache
+ * @param block_size Block size in bytes
+ * @param policy Eviction policy
+ */
+void BlockCache::configure(size_t budget, size_t block_size, Policy policy) {
+    if (block_size == 0) {
+        throw std::runtime_error("Block size must be greater than 0.");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    this->budget = budget;
+    this->block_size = block_size;
+    this->policy = make_policy(policy, budget / block_size);
+    policy_kind = policy;
+    index.clear();
+    file_ids.clear();
+    std::vector<Slot>().swap(slots);
+    hits = misses = evictions = 0;
+}
+
+
+/**
+ * @brief Gets the identifier of a file within the cache. Identifiers are never reused, such
+ *      that readers opened before the cache is cleared cannot be served blocks of another file.
+ *
+ * @param stamp Stamp of file
+ * @return size_t File identifier
+ */
+size_t BlockCache::get_file_id(const file_stamp::Stamp& stamp) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = file_ids.emplace(stamp, next_file_id);
+    if (it.second) {
+        next_file_id++;
+    }
+    return it.first->second;
+}
+
+
+size_t BlockCache::get_block_size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return block_size;
+}
+
+
+/**
+ * @brief Copies bytes from a cached block. The block is pinned while it is copied outside
+ *      of the lock, such that threads reading cached blocks are not serialized on the copy.
+ *
+ * @param file_id File identifier
+ * @param block_size Block size the block index was computed with
+ * @param block Block index
+ * @param within Byte offset within block
+ * @param length Number of bytes to copy
+ * @param out Destination buffer
+ * @return true If the block was cached
+ */
+bool BlockCache::read(size_t file_id, size_t block_size, size_t block, size_t within,
+                      size_t length, char* out) {
+    std::shared_ptr<const std::vector<char>> data;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (block_size == this->block_size) {
+            auto file = index.find(file_id);
+            if (file != index.end()) {
+                auto it = file->second.find(block);
+                if ((it != file->second.end()) &&
+                    (within + length <= slots[it->second].data->size())) {
+                    data = slots[it->second].data;
+                    policy->access(it->second);
+                }
+            }
+        }
+        if (!data) {
+            misses++;
+            return false;
+        }
+        hits++;
+    }
+    std::memcpy(out, data->data() + within, length);
+    return true;
+}
+
+
+/**
+ * @brief Inserts a block, evicting a block if the memory budget is reached
+ *
+ * @param file_id File identifier
+ * @param block_size Block size the block index was computed with
+ * @param block Block index
+ * @param data Block data
+ * @param length Block length, only less than the block size at the end of file
+ */
+void BlockCache::insert(size_t file_id, size_t block_size, size_t block, const char* data,
+                        size_t length) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const size_t num_slots = budget / this->block_size;
+    if ((block_size != this->block_size) || (num_slots == 0)) {
+        return;
+    }
+    std::unordered_map<size_t, size_t>& blocks = index[file_id];
+    if (blocks.count(block)) {
+        return;  // inserted by another reader meanwhile
+    }
+    size_t slot;
+    if (slots.size() < num_slots) {
+        slot = slots.size();
+        slots.emplace_back();
+    } else {
+        slot = policy->victim();
+        index[slots[slot].file_id].erase(slots[slot].block);
+        evictions++;
+    }
+    slots[slot].file_id = file_id;
+    slots[slot].block = block;
+    slots[slot].data = std::make_shared<const std::vector<char>>(data, data + length);
+    blocks[block] = slot;
+    policy->insert(slot);
+}
+
+
+/**
+ * @brief Gets the cache statistics
+ *
+ * @return CacheStats Number of hits, misses & evictions, cached bytes, budget and block size
+ */
+CacheStats BlockCache::get_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t size = 0;
+    for (const Slot& slot : slots) {
+        size += slot.data->size();
+    }
+    return {hits, misses, evictions, size, budget, block_size};
+}
+
+
+/**
+ * @brief Drops all cached blocks and resets the statistics
+ */
+void BlockCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    policy = make_policy(policy_kind, budget / block_size);
+    index.clear();
+    file_ids.clear();
+    std::vector<Slot>().swap(slots);
+    hits = misses = evictions = 0;
+}
+
+
+/**
+ * @brief Gets the process wide block cache
+ *
+ * @return BlockCache& Block cache
+ */
+BlockCache& get_cache() {
+    static BlockCache cache(default_budget, default_block_size, Policy::lru);
+    return cache;
+}
+
+
+/**
+ * @brief Opens file, the file is identified within the block cache by its stamp, such that
+ *      a modified or rewritten file is not served stale blocks.
+ *
+ * @param filepath Filepath to open
+ */
+CachedReader::CachedReader(const std::string& filepath) : file(filepath) {
+    const file_stamp::Stamp stamp = file_stamp::get(filepath);
+    file_size = static_cast<size_t>(stamp.size);
+    file_id = get_cache().get_file_id(stamp);
+}
+
+
+/**
+ * @brief Reads bytes block by block, copying from cached blocks and reading whole blocks
+ *      into the cache otherwise.
+ *
+ * @param buf Destination buffer
+ * @param offset Byte offset within file
+ * @param length Number of bytes to read
+ */
+void CachedReader::read(char* buf, size_t offset, size_t length) {
+    BlockCache& cache = get_cache();
+    const size_t block_size = cache.get_block_size();
+    thread_local std::vector<char> block_buf;
+    while (length > 0) {
+        size_t block = offset / block_size;
+        size_t within = offset % block_size;
+        size_t n = std::min(length, block_size - within);
+        if (!cache.read(file_id, block_size, block, within, n, buf)) {
+            size_t start = block * block_size;
+            if (offset + n > file_size) {
+                throw std::runtime_error("IO Error: unexpected end of file.");
+            }
+            size_t block_length = std::min(block_size, file_size - start);
+            block_buf.resize(block_length);
+            file.read(block_buf.data(), start, block_length);
+            std::memcpy(buf, block_buf.data() + within, n);
+            cache.insert(file_id, block_size, block, block_buf.data(), block_length);
+        }
+        buf += n;
+        offset += n;
+        length -= n;
+    }
+}
+
+}  // namespace block_cache
@@ -0,0 +1,129 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef BLOCK_CACHE_HPP_
+#define BLOCK_CACHE_HPP_
+
+#include <list>           // std::list
+#include <map>            // std::map
+#include <memory>         // std::shared_ptr, std::unique_ptr
+#include <mutex>          // std::mutex
+#include <string>         // std::string
+#include <unordered_map>  // std::unordered_map
+#include <vector>         // std::vector
+
+#include "src/file_stamp.hpp"
+#include "src/reader.hpp"
+
+namespace block_cache {
+
+// Defaults used by the process wide block cache
+constexpr size_t default_budget = 256 << 20;
+constexpr size_t default_block_size = 64 << 10;
+
+// Eviction policy used once the memory budget is reached
+enum class Policy { lru, clock };
+
+// Number of block lookups served from the cache, and read from file
+struct CacheStats {
+    size_t hits, misses, evictions, size, budget, block_size;
+};
+
+/**
+ * @brief Chooses which cache slot to evict. Slots are numbered 0 to num_slots - 1.
+ */
+class EvictionPolicy {
+  public:
+    virtual ~EvictionPolicy() = default;
+    virtual void insert(size_t) = 0;
+    virtual void access(size_t) = 0;
+    virtual size_t victim() = 0;
+};
+
+/**
+ * @brief Evicts the least recently used slot.
+ */
+class LruPolicy : public EvictionPolicy {
+  private:
+    std::list<size_t> order;
+    std::vector<std::list<size_t>::iterator> positions;
+
+  public:
+    explicit LruPolicy(size_t);
+    void insert(size_t) override;
+    void access(size_t) override;
+    size_t victim() override;
+};
+
+/**
+ * @brief Approximates LRU with one reference bit per slot, a clock hand sweeps the slots
+ *      clearing reference bits until an unreferenced slot is found.
+ */
+class ClockPolicy : public EvictionPolicy {
+  private:
+    std::vector<char> referenced;
+    size_t hand;
+
+  public:
+    explicit ClockPolicy(size_t);
+    void insert(size_t) override;
+    void access(size_t) override;
+    size_t victim() override;
+};
+
+std::unique_ptr<EvictionPolicy> make_policy(Policy, size_t);
+
+/**
+ * @brief Cache of fixed size, aligned blocks of files, shared by all readers within the
+ *      process. Blocks are identified by file and block index.
+ */
+class BlockCache {
+  private:
+    struct Slot {
+        size_t file_id, block;
+        std::shared_ptr<const std::vector<char>> data;  // pinned by readers while copied from
+    };
+    std::mutex mutex;
+    std::map<file_stamp::Stamp, size_t> file_ids;  // a modified file gets a new identifier
+    std::unordered_map<size_t, std::unordered_map<size_t, size_t>> index;
+    std::vector<Slot> slots;
+    std::unique_ptr<EvictionPolicy> policy;
+    Policy policy_kind;
+    size_t budget, block_size, next_file_id = 0;
+    size_t hits = 0, misses = 0, evictions = 0;
+
+  public:
+    BlockCache(size_t, size_t, Policy);
+    void configure(size_t, size_t, Policy);
+    size_t get_file_id(const file_stamp::Stamp &);
+    size_t get_block_size();
+    bool read(size_t, size_t, size_t, size_t, size_t, char *);
+    void insert(size_t, size_t, size_t, const char *, size_t);
+    CacheStats get_stats();
+    void clear();
+};
+
+BlockCache &get_cache();
+
+/**
+ * @brief Serves reads from the process wide block cache, reading whole blocks with pread
+ *      on a cache miss.
+ */
+class CachedReader : public reader::Reader {
+  private:
+    reader::PreadReader file;
+    size_t file_id, file_size;
+
+  public:
+    explicit CachedReader(const std::string &);
+    void read(char *, size_t, size_t) override;
+    bool is_thread_safe() const override { return true; }
+    size_t max_gap() const override { return 0; }
+    void advise(reader::AccessHint hint) override { file.advise(hint); }
+    void will_need(size_t offset, size_t length) override { file.will_need(offset, length); }
+};
+
+}  // namespace block_cache
+
+#endif  // BLOCK_CACHE_HPP_
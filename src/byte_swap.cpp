@@ -0,0 +1,110 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>  // std::reverse
+#include <cstdint>    // uint8_t
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>  // _mm_shuffle_epi8, _mm256_shuffle_epi8
+#define NPY_PATCHER_X86 1
+#endif
+
+#include "src/byte_swap.hpp"
+
+
+namespace byte_swap {
+
+namespace {
+
+/**
+ * @brief Reverses the bytes of each element, one element at a time
+ *
+ * @param data Data to swap
+ * @param count Number of elements
+ * @param elem_size Element size in bytes
+ */
+void swap_scalar(char* data, size_t count, size_t elem_size) {
+    for (size_t i = 0; i < count; i++) {
+        std::reverse(data + (i * elem_size), data + ((i + 1) * elem_size));
+    }
+}
+
+#ifdef NPY_PATCHER_X86
+
+// Byte shuffle reversing each element of a 16 byte lane, for element sizes 2, 4 & 8
+alignas(16) constexpr uint8_t shuffle_masks[3][16] = {
+    {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+    {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+    {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8},
+};
+
+
+const uint8_t* get_mask(size_t elem_size) {
+    return shuffle_masks[(elem_size == 2) ? 0 : ((elem_size == 4) ? 1 : 2)];
+}
+
+
+__attribute__((target("ssse3"))) size_t swap_ssse3(char* data, size_t length,
+                                                     size_t elem_size) {
+    const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(get_mask(elem_size)));
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i* ptr = reinterpret_cast<__m128i*>(data + i);
+        _mm_storeu_si128(ptr, _mm_shuffle_epi8(_mm_loadu_si128(ptr), mask));
+    }
+    return i;
+}
+
+
+__attribute__((target("avx2"))) size_t swap_avx2(char* data, size_t length, size_t elem_size) {
+    const __m128i lane = _mm_load_si128(reinterpret_cast<const __m128i*>(get_mask(elem_size)));
+    const __m256i mask = _mm256_broadcastsi128_si256(lane);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i* ptr = reinterpret_cast<__m256i*>(data + i);
+        _mm256_storeu_si256(ptr, _mm256_shuffle_epi8(_mm256_loadu_si256(ptr), mask));
+    }
+    return i;
+}
+
+#endif
+
+}  // namespace
+
+
+/**
+ * @brief Checks whether elements of the given size can be byte swapped
+ *
+ * @param elem_size Element size in bytes
+ * @return true If the element size is 2, 4 or 8 bytes
+ */
+bool is_supported(size_t elem_size) {
+    return (elem_size == 2) || (elem_size == 4) || (elem_size == 8);
+}
+
+
+/**
+ * @brief Reverses the byte order of each element in place. Uses AVX2 or SSSE3 byte shuffles
+ *      when supported by the CPU, chosen at runtime, the remaining bytes are swapped by the
+ *      scalar fallback.
+ *
+ * @param data Data to swap
+ * @param length Number of bytes, a multiple of elem_size
+ * @param elem_size Element size in bytes, one of 2, 4 or 8
+ */
+void swap_in_place(char* data, size_t length, size_t elem_size) {
+    size_t done = 0;
+#ifdef NPY_PATCHER_X86
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+    if (has_avx2) {
+        done = swap_avx2(data, length, elem_size);
+    } else if (has_ssse3) {
+        done = swap_ssse3(data, length, elem_size);
+    }
+#endif
+    swap_scalar(data + done, (length - done) / elem_size, elem_size);
+}
+
+}  // namespace byte_swap
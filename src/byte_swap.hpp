@@ -0,0 +1,17 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef BYTE_SWAP_HPP_
+#define BYTE_SWAP_HPP_
+
+#include <cstddef>  // size_t
+
+namespace byte_swap {
+
+bool is_supported(size_t);
+void swap_in_place(char *, size_t, size_t);
+
+}  // namespace byte_swap
+
+#endif  // BYTE_SWAP_HPP_
@@ -0,0 +1,620 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <sys/stat.h>  // stat
+
+#include <algorithm>   // std::max, std::min
+#include <cstdint>     // uint64_t
+#include <cstring>     // std::memcmp, std::memcpy
+#include <fstream>     // std::ifstream, std::ofstream
+#include <functional>  // std::hash
+#include <sstream>     // std::ostringstream
+#include <stdexcept>   // std::runtime_error
+#include <tuple>       // std::tie
+
+#include "src/byte_swap.hpp"
+#include "src/chunk_store.hpp"
+#include "src/header_cache.hpp"
+#include "src/le_bytes.hpp"
+#include "src/lz4.hpp"
+#include "src/npz.hpp"
+
+
+namespace chunk_store {
+
+namespace {
+
+// Layout of the fixed size start of the header, followed by the shape, chunk shape, chunk
+// offset and then the offset & size of each chunk, all as 8 byte little endian integers
+constexpr char magic[] = "NPYCHUNK";
+constexpr size_t magic_length = 8;
+constexpr uint64_t version = 1;
+constexpr uint64_t shuffle_flag = 0x1;
+constexpr size_t prefix_size = 32;
+constexpr size_t index_entry_size = 16;
+
+
+/**
+ * @brief Groups the n-th byte of every element together, such that the slowly varying high
+ *      bytes of neighbouring values form long runs for the compressor
+ */
+void shuffle_bytes(const char* src, char* dst, size_t count, size_t itemsize) {
+    for (size_t i = 0; i < count; i++) {
+        for (size_t b = 0; b < itemsize; b++) {
+            dst[(b * count) + i] = src[(i * itemsize) + b];
+        }
+    }
+}
+
+
+void unshuffle_bytes(const char* src, char* dst, size_t count, size_t itemsize) {
+    for (size_t b = 0; b < itemsize; b++) {
+        for (size_t i = 0; i < count; i++) {
+            dst[(i * itemsize) + b] = src[(b * count) + i];
+        }
+    }
+}
+
+
+/**
+ * @brief Gets the number of chunks along each patched dimension
+ */
+std::vector<size_t> get_chunk_grid(const Header& header) {
+    std::vector<size_t> grid(header.chunk_shape.size());
+    for (size_t i = 0; i < grid.size(); i++) {
+        grid[i] = (header.shape[i + 1] + header.chunk_offset[i] + header.chunk_shape[i] - 1) /
+                  header.chunk_shape[i];
+    }
+    return grid;
+}
+
+
+size_t chunk_start(const Header& header, size_t dim, size_t chunk) {
+    return std::max(chunk * header.chunk_shape[dim], header.chunk_offset[dim]) -
+           header.chunk_offset[dim];
+}
+
+
+size_t chunk_extent(const Header& header, size_t dim, size_t chunk) {
+    const size_t end = std::min(((chunk + 1) * header.chunk_shape[dim]) - header.chunk_offset[dim],
+                                header.shape[dim + 1]);
+    return end - chunk_start(header, dim, chunk);
+}
+
+
+/**
+ * @brief Copies the box of a chunk out of one qspace index of the data, in C order
+ *
+ * @param header Store header
+ * @param grid Number of chunks along each patched dimension
+ * @param index Chunk index within the qspace index, C order over the chunk grid
+ * @param channel Data of the qspace index, C order
+ * @param out Output buffer
+ * @return size_t Number of elements in the chunk
+ */
+size_t copy_chunk(const Header& header, const std::vector<size_t>& grid, size_t index,
+                  const char* channel, char* out) {
+    const size_t ndim = grid.size();
+    std::vector<size_t> start(ndim), extent(ndim), strides(ndim, header.itemsize);
+    for (size_t i = ndim; i-- > 0;) {
+        const size_t chunk = index % grid[i];
+        index /= grid[i];
+        start[i] = chunk_start(header, i, chunk);
+        extent[i] = chunk_extent(header, i, chunk);
+        if (i + 1 < ndim) {
+            strides[i] = strides[i + 1] * header.shape[i + 2];
+        }
+    }
+    const size_t row_bytes = extent[ndim - 1] * header.itemsize;
+    std::vector<size_t> row(ndim, 0);
+    size_t count = 0;
+    while (true) {
+        size_t offset = 0;
+        for (size_t i = 0; i < ndim; i++) {
+            offset += (start[i] + row[i]) * strides[i];
+        }
+        std::memcpy(out + (count * header.itemsize), channel + offset, row_bytes);
+        count += extent[ndim - 1];
+        size_t i = ndim - 1;
+        while ((i-- > 0) && (++row[i] == extent[i])) {
+            row[i] = 0;
+        }
+        if (i == static_cast<size_t>(-1)) {
+            return count;
+        }
+    }
+}
+
+
+/**
+ * @brief Copies one qspace index of Fortran ordered data into C order
+ *
+ * @param data Whole array, Fortran order
+ * @param shape Array shape, natural order
+ * @param itemsize Element size in bytes
+ * @param q qspace index
+ * @param out Output buffer
+ */
+void gather_fortran_channel(const char* data, const std::vector<size_t>& shape, size_t itemsize,
+                            size_t q, char* out) {
+    const size_t ndim = shape.size();
+    std::vector<size_t> strides(ndim, itemsize);
+    for (size_t i = 1; i < ndim; i++) {
+        strides[i] = strides[i - 1] * shape[i - 1];
+    }
+    std::vector<size_t> index(ndim, 0);
+    size_t count = 1;
+    for (size_t i = 1; i < ndim; i++) {
+        count *= shape[i];
+    }
+    for (size_t n = 0; n < count; n++) {
+        size_t offset = q * strides[0];
+        for (size_t i = 1; i < ndim; i++) {
+            offset += index[i] * strides[i];
+        }
+        std::memcpy(out + (n * itemsize), data + offset, itemsize);
+        for (size_t i = ndim; i-- > 1;) {
+            if (++index[i] < shape[i]) {
+                break;
+            }
+            index[i] = 0;
+        }
+    }
+}
+
+}  // namespace
+
+
+bool ChunkCache::FileKey::operator<(const FileKey& other) const {
+    return std::tie(stamp, index_hash) < std::tie(other.stamp, other.index_hash);
+}
+
+
+/**
+ * @brief Construct a new ChunkCache object
+ *
+ * @param budget Memory budget in bytes, 0 disables the cache
+ */
+ChunkCache::ChunkCache(size_t budget) : budget(budget) {}
+
+
+/**
+ * @brief Sets the memory budget, evicting the least recently used chunks beyond it
+ *
+ * @param new_budget Memory budget in bytes, 0 disables the cache
+ */
+void ChunkCache::configure(size_t new_budget) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = new_budget;
+    evict(0);
+}
+
+
+/**
+ * @brief Evicts the least recently used chunks until needed bytes fit within the budget
+ */
+void ChunkCache::evict(size_t needed) {
+    while (!order.empty() && (size + needed > budget)) {
+        const Entry& entry = order.back();
+        size -= entry.data->size();
+        entries[entry.store_id].erase(entry.index);
+        order.pop_back();
+        evictions++;
+    }
+}
+
+
+size_t ChunkCache::get_store_id(const file_stamp::Stamp& stamp, size_t index_hash) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = store_ids.emplace(FileKey{stamp, index_hash}, next_store_id);
+    if (it.second) {
+        next_store_id++;
+    }
+    return it.first->second;
+}
+
+
+/**
+ * @brief Gets a cached chunk, marking it as the most recently used
+ *
+ * @param store_id Store id
+ * @param index Chunk index within the store
+ * @return Chunk Decompressed chunk, nullptr if not cached
+ */
+Chunk ChunkCache::find(size_t store_id, size_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto store = entries.find(store_id);
+    if (store != entries.end()) {
+        auto it = store->second.find(index);
+        if (it != store->second.end()) {
+            order.splice(order.begin(), order, it->second);
+            hits++;
+            return it->second->data;
+        }
+    }
+    misses++;
+    return nullptr;
+}
+
+
+/**
+ * @brief Inserts a decompressed chunk, unless it is already cached, e.g. by a concurrent reader
+ *      that missed on the same chunk, or is larger than the budget.
+ *
+ * @param store_id Store id
+ * @param index Chunk index within the store
+ * @param data Decompressed chunk
+ */
+void ChunkCache::insert(size_t store_id, size_t index, const Chunk& data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if ((data->size() > budget) || (entries[store_id].count(index) != 0)) {
+        return;
+    }
+    evict(data->size());
+    order.push_front({store_id, index, data});
+    entries[store_id][index] = order.begin();
+    size += data->size();
+}
+
+
+CacheStats ChunkCache::get_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return {hits, misses, evictions, size, budget};
+}
+
+
+/**
+ * @brief Drops all cached chunks and resets the statistics
+ */
+void ChunkCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    order.clear();
+    entries.clear();
+    store_ids.clear();
+    size = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+
+/**
+ * @brief Gets the process wide chunk cache
+ */
+ChunkCache& get_cache() {
+    static ChunkCache cache(default_budget);
+    return cache;
+}
+
+
+/**
+ * @brief Construct a new Store object, reads & validates the header and chunk index.
+ *
+ * @param path Filepath of the store
+ */
+Store::Store(const std::string& path) : file(path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        throw std::runtime_error("IO Error: failed to stat " + path);
+    }
+    const uint64_t file_size = static_cast<uint64_t>(st.st_size);
+
+    char prefix[prefix_size];
+    if (file_size < prefix_size) {
+        throw std::runtime_error("Not a chunked store: " + path);
+    }
+    file.read(prefix, 0, prefix_size);
+    if (std::memcmp(prefix, magic, magic_length) != 0) {
+        throw std::runtime_error("Not a chunked store: " + path);
+    }
+    if (le_bytes::load(&prefix[8], 4) != version) {
+        std::ostringstream oss;
+        oss << "Chunked store version " << le_bytes::load(&prefix[8], 4)
+            << " is not supported: " << path;
+        throw std::runtime_error(oss.str());
+    }
+    header.shuffle = (le_bytes::load(&prefix[12], 4) & shuffle_flag) != 0;
+    header.kind = prefix[16];
+    header.byteorder = prefix[17];
+    header.itemsize = le_bytes::load(&prefix[20], 4);
+    const size_t ndim = le_bytes::load(&prefix[24], 4);
+    if ((ndim < 2) || (header.itemsize == 0)) {
+        throw std::runtime_error("Chunked store header is corrupt: " + path);
+    }
+
+    const size_t dims_size = ((3 * ndim) - 2) * 8;
+    if (file_size < prefix_size + dims_size) {
+        throw std::runtime_error("Chunked store header is corrupt: " + path);
+    }
+    std::vector<char> dims(dims_size);
+    file.read(dims.data(), prefix_size, dims_size);
+    for (size_t i = 0; i < ndim; i++) {
+        header.shape.push_back(le_bytes::load(&dims[i * 8], 8));
+    }
+    for (size_t i = 0; i < ndim - 1; i++) {
+        header.chunk_shape.push_back(le_bytes::load(&dims[(ndim + i) * 8], 8));
+        header.chunk_offset.push_back(le_bytes::load(&dims[((2 * ndim) - 1 + i) * 8], 8));
+        if ((header.chunk_shape[i] == 0) || (header.chunk_offset[i] >= header.chunk_shape[i])) {
+            throw std::runtime_error("Chunked store header is corrupt: " + path);
+        }
+    }
+    grid = get_chunk_grid(header);
+    for (size_t n : grid) {
+        chunks_per_channel *= n;
+    }
+
+    // Chunk index, one entry per chunk of each qspace index
+    const size_t num_chunks = header.shape[0] * chunks_per_channel;
+    const size_t index_offset = prefix_size + dims_size;
+    if ((file_size - index_offset) / index_entry_size < num_chunks) {
+        throw std::runtime_error("Chunked store index is truncated: " + path);
+    }
+    std::vector<char> index(num_chunks * index_entry_size);
+    file.read(index.data(), index_offset, index.size());
+    const size_t index_hash = std::hash<std::string>()(std::string(index.begin(), index.end()));
+    store_id = get_cache().get_store_id(file_stamp::from_stat(st), index_hash);
+    offsets.resize(num_chunks);
+    sizes.resize(num_chunks);
+    for (size_t i = 0; i < num_chunks; i++) {
+        offsets[i] = le_bytes::load(&index[i * index_entry_size], 8);
+        sizes[i] = le_bytes::load(&index[(i * index_entry_size) + 8], 8);
+        if ((offsets[i] > file_size) || (sizes[i] > file_size - offsets[i])) {
+            throw std::runtime_error("Chunked store index is corrupt: " + path);
+        }
+    }
+
+    // Data in the opposite byte order is swapped as chunks are decompressed
+    if ((header.byteorder != npy_header::no_endian_char) &&
+        (header.byteorder != npy_header::host_endian_char) && (header.itemsize > 1)) {
+        swap_size = (header.kind == 'c') ? header.itemsize / 2 : header.itemsize;
+        if (!byte_swap::is_supported(swap_size)) {
+            throw std::runtime_error("Byte swapping is not supported for the type in file.");
+        }
+    }
+}
+
+
+const Header& Store::get_header() const {
+    return header;
+}
+
+
+const std::vector<size_t>& Store::get_grid() const {
+    return grid;
+}
+
+
+/**
+ * @brief Gets the data index at which a chunk starts along a patched dimension
+ *
+ * @param dim Patched dimension, natural order
+ * @param chunk Chunk index along the dimension
+ * @return size_t Data index
+ */
+size_t Store::get_chunk_start(size_t dim, size_t chunk) const {
+    return chunk_start(header, dim, chunk);
+}
+
+
+/**
+ * @brief Gets the extent of a chunk along a patched dimension, chunks at the edges of the data
+ *      are cut short
+ *
+ * @param dim Patched dimension, natural order
+ * @param chunk Chunk index along the dimension
+ * @return size_t Number of elements
+ */
+size_t Store::get_chunk_extent(size_t dim, size_t chunk) const {
+    return chunk_extent(header, dim, chunk);
+}
+
+
+size_t Store::get_compressed_bytes() const {
+    size_t total = 0;
+    for (uint64_t size : sizes) {
+        total += size;
+    }
+    return total;
+}
+
+
+/**
+ * @brief Gets a decompressed chunk, from the process wide chunk cache if present, otherwise
+ *      the chunk is read, decompressed and inserted into the cache.
+ *
+ * @param q qspace index
+ * @param index Chunk index within the qspace index, C order over the chunk grid
+ * @return Chunk Chunk data in C order, in the store datatype and host byte order
+ */
+Chunk Store::get_chunk(size_t q, size_t index) const {
+    const size_t id = (q * chunks_per_channel) + index;
+    ChunkCache& cache = get_cache();
+    Chunk cached = cache.find(store_id, id);
+    if (cached) {
+        return cached;
+    }
+
+    size_t count = 1;
+    for (size_t i = grid.size(), rest = index; i-- > 0; rest /= grid[i]) {
+        count *= chunk_extent(header, i, rest % grid[i]);
+    }
+    const size_t raw_size = count * header.itemsize;
+    std::vector<char> stored(sizes[id]);
+    file.read(stored.data(), offsets[id], sizes[id]);
+
+    auto data = std::make_shared<std::vector<char>>(raw_size);
+    const bool shuffled = header.shuffle && (header.itemsize > 1);
+    std::vector<char> decompressed;
+    const char* bytes = stored.data();
+    if (sizes[id] != raw_size) {
+        // Chunks that did not compress are stored as is
+        decompressed.resize(raw_size);
+        lz4::decompress(stored.data(), stored.size(), decompressed.data(), raw_size);
+        bytes = decompressed.data();
+    }
+    if (shuffled) {
+        unshuffle_bytes(bytes, data->data(), count, header.itemsize);
+    } else {
+        std::memcpy(data->data(), bytes, raw_size);
+    }
+    if (swap_size != 0) {
+        byte_swap::swap_in_place(data->data(), raw_size, swap_size);
+    }
+    cache.insert(store_id, id, data);
+    return data;
+}
+
+
+/**
+ * @brief Converts an npy file, or npz archive member, into a chunked store. Each qspace index
+ *      is split into chunks of chunk_shape, and each chunk is compressed with LZ4. Choosing the
+ *      chunk shape & offset such that chunk boundaries fall on patch boundaries, e.g. the patch
+ *      stride and the left padding, minimises the chunks each patch overlaps. Data is read one
+ *      qspace index at a time, other than Fortran ordered data which is read whole.
+ *
+ * @param npy_path Filepath of the npy file
+ * @param store_path Filepath of the store to write
+ * @param chunk_shape Chunk shape of the patched dimensions
+ * @param chunk_offset Offset of the chunk grid, chunk boundaries lie at multiples of the chunk
+ *      shape minus the offset, taken modulo the chunk shape, empty for 0
+ * @param shuffle Group the bytes of each element by significance before compressing, which
+ *      compresses multi byte datatypes better
+ */
+void convert(const std::string& npy_path, const std::string& store_path,
+             const std::vector<size_t>& chunk_shape, const std::vector<size_t>& chunk_offset,
+             bool shuffle) {
+    npz::Location location = npz::resolve(npy_path);
+    std::ifstream stream(location.path, std::ifstream::binary);
+    if (!stream) {
+        throw std::runtime_error("IO Error: failed to open " + npy_path);
+    }
+    header_cache::Entry entry = header_cache::get_header(location.path, stream, location.offset);
+    const npy_header::header_t& npy = entry.header;
+    const size_t ndim = npy.shape.size();
+    if (ndim < 2) {
+        throw std::runtime_error("Chunked stores require a qspace dimension and at least one "
+                                 "patched dimension.");
+    }
+
+    Header header;
+    header.kind = npy.dtype.kind;
+    header.itemsize = npy.dtype.itemsize;
+    header.byteorder = (npy.dtype.byteorder == npy_header::no_endian_char)
+                           ? npy_header::no_endian_char
+                           : npy_header::host_endian_char;
+    header.shuffle = shuffle;
+    header.shape = npy.shape;
+    header.chunk_shape = chunk_shape;
+    header.chunk_offset = chunk_offset.empty() ? std::vector<size_t>(ndim - 1, 0) : chunk_offset;
+    if ((header.chunk_shape.size() != ndim - 1) || (header.chunk_offset.size() != ndim - 1)) {
+        std::ostringstream oss;
+        oss << "Chunk shape & offset must have one value per patched dimension, " << ndim - 1
+            << " for " << npy_path << ".";
+        throw std::runtime_error(oss.str());
+    }
+    for (size_t i = 0; i < ndim - 1; i++) {
+        if (header.chunk_shape[i] == 0) {
+            std::ostringstream oss;
+            oss << "Chunk shape in dim " << i << " must be greater than 0.";
+            throw std::runtime_error(oss.str());
+        }
+        header.chunk_offset[i] %= header.chunk_shape[i];
+    }
+
+    // Data in the opposite byte order is stored in host byte order
+    size_t swap_size = 0;
+    if ((npy.dtype.byteorder != npy_header::no_endian_char) &&
+        (npy.dtype.byteorder != npy_header::host_endian_char) && (header.itemsize > 1)) {
+        swap_size = (header.kind == 'c') ? header.itemsize / 2 : header.itemsize;
+        if (!byte_swap::is_supported(swap_size)) {
+            throw std::runtime_error("Byte swapping is not supported for the type in file.");
+        }
+    }
+
+    const std::vector<size_t> grid = get_chunk_grid(header);
+    size_t chunks_per_channel = 1, channel_count = 1;
+    for (size_t i = 0; i < ndim - 1; i++) {
+        chunks_per_channel *= grid[i];
+        channel_count *= header.shape[i + 1];
+    }
+    const size_t channel_bytes = channel_count * header.itemsize;
+
+    // Header, followed by space for the index, which is written once the chunks are
+    std::vector<char> prefix(prefix_size + (((3 * ndim) - 2) * 8), 0);
+    std::memcpy(prefix.data(), magic, magic_length);
+    le_bytes::store(&prefix[8], version, 4);
+    le_bytes::store(&prefix[12], shuffle ? shuffle_flag : 0, 4);
+    prefix[16] = header.kind;
+    prefix[17] = header.byteorder;
+    le_bytes::store(&prefix[20], header.itemsize, 4);
+    le_bytes::store(&prefix[24], ndim, 4);
+    for (size_t i = 0; i < ndim; i++) {
+        le_bytes::store(&prefix[prefix_size + (i * 8)], header.shape[i], 8);
+    }
+    for (size_t i = 0; i < ndim - 1; i++) {
+        le_bytes::store(&prefix[prefix_size + ((ndim + i) * 8)], header.chunk_shape[i], 8);
+        const size_t offset_pos = prefix_size + (((2 * ndim) - 1 + i) * 8);
+        le_bytes::store(&prefix[offset_pos], header.chunk_offset[i], 8);
+    }
+    std::vector<char> index(header.shape[0] * chunks_per_channel * index_entry_size, 0);
+
+    std::ofstream out(store_path, std::ofstream::binary | std::ofstream::trunc);
+    if (!out) {
+        throw std::runtime_error("IO Error: failed to open " + store_path);
+    }
+    out.write(prefix.data(), static_cast<std::streamsize>(prefix.size()));
+    out.write(index.data(), static_cast<std::streamsize>(index.size()));
+    uint64_t pos = prefix.size() + index.size();
+
+    std::vector<char> data, channel(channel_bytes), chunk, shuffled;
+    for (size_t q = 0; q < header.shape[0]; q++) {
+        if (npy.fortran_order) {
+            if (data.empty()) {
+                data.resize(channel_bytes * header.shape[0]);
+                stream.seekg(static_cast<std::streamoff>(entry.data_offset));
+                stream.read(data.data(), static_cast<std::streamsize>(data.size()));
+            }
+            gather_fortran_channel(data.data(), header.shape, header.itemsize, q,
+                                   channel.data());
+        } else {
+            stream.seekg(static_cast<std::streamoff>(entry.data_offset + (q * channel_bytes)));
+            stream.read(channel.data(), static_cast<std::streamsize>(channel_bytes));
+        }
+        if (!stream) {
+            throw std::runtime_error("IO Error: failed to read data from " + npy_path);
+        }
+        if (swap_size != 0) {
+            byte_swap::swap_in_place(channel.data(), channel_bytes, swap_size);
+        }
+
+        for (size_t c = 0; c < chunks_per_channel; c++) {
+            chunk.resize(channel_bytes);
+            const size_t count = copy_chunk(header, grid, c, channel.data(), chunk.data());
+            const size_t raw_size = count * header.itemsize;
+            const char* bytes = chunk.data();
+            if (shuffle && (header.itemsize > 1)) {
+                shuffled.resize(raw_size);
+                shuffle_bytes(chunk.data(), shuffled.data(), count, header.itemsize);
+                bytes = shuffled.data();
+            }
+            std::vector<char> compressed = lz4::compress(bytes, raw_size);
+            const bool is_compressed = compressed.size() < raw_size;
+            const size_t size = is_compressed ? compressed.size() : raw_size;
+            out.write(is_compressed ? compressed.data() : bytes,
+                      static_cast<std::streamsize>(size));
+            const size_t entry_offset = ((q * chunks_per_channel) + c) * index_entry_size;
+            le_bytes::store(&index[entry_offset], pos, 8);
+            le_bytes::store(&index[entry_offset + 8], size, 8);
+            pos += size;
+        }
+    }
+    out.seekp(static_cast<std::streamoff>(prefix.size()));
+    out.write(index.data(), static_cast<std::streamsize>(index.size()));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("IO Error: failed to write " + store_path);
+    }
+}
+
+}  // namespace chunk_store
@@ -0,0 +1,496 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHUNK_STORE_HPP_
+#define CHUNK_STORE_HPP_
+
+#include <algorithm>      // std::fill, std::lower_bound, std::max, std::sort, std::unique
+#include <cstddef>        // size_t, std::ptrdiff_t
+#include <cstdint>        // uint64_t
+#include <cstring>        // std::memcpy
+#include <list>           // std::list
+#include <map>            // std::map
+#include <memory>         // std::shared_ptr, std::unique_ptr
+#include <mutex>          // std::mutex, std::lock_guard
+#include <sstream>        // std::ostringstream
+#include <stdexcept>      // std::runtime_error
+#include <string>         // std::string
+#include <thread>         // std::thread
+#include <unordered_map>  // std::unordered_map
+#include <vector>         // std::vector
+
+#include "src/convert.hpp"
+#include "src/file_stamp.hpp"
+#include "src/npy_header.hpp"
+#include "src/pad_mode.hpp"
+#include "src/patcher.hpp"
+#include "src/reader.hpp"
+#include "src/thread_pool.hpp"
+
+namespace chunk_store {
+
+// Default memory budget of the process wide decompressed chunk cache
+constexpr size_t default_budget = 256 << 20;
+
+// Decompressed chunk, shared between the cache and the patches being copied from it
+using Chunk = std::shared_ptr<const std::vector<char>>;
+
+// Array description & chunk grid of a store. Shapes are in natural order, the qspace
+// dimension first, and chunks span a single qspace index.
+struct Header {
+    char kind, byteorder;
+    size_t itemsize;
+    bool shuffle;
+    std::vector<size_t> shape, chunk_shape, chunk_offset;
+};
+
+// Number of chunk lookups served from the cache, and decompressed from file
+struct CacheStats {
+    size_t hits, misses, evictions, size, budget;
+};
+
+/**
+ * @brief Least recently used cache of decompressed chunks, shared by all readers within the
+ *      process, with a memory budget in bytes. Chunks are identified by store and chunk index.
+ */
+class ChunkCache {
+  private:
+    // Identifies a store, such that a rewritten store is not served stale chunks. The chunk
+    // index is hashed as well, for file systems with coarse timestamps.
+    struct FileKey {
+        file_stamp::Stamp stamp;
+        size_t index_hash;
+        bool operator<(const FileKey &) const;
+    };
+    struct Entry {
+        size_t store_id, index;
+        Chunk data;
+    };
+    std::mutex mutex;
+    std::map<FileKey, size_t> store_ids;
+    std::list<Entry> order;  // most recently used first
+    std::unordered_map<size_t, std::unordered_map<size_t, std::list<Entry>::iterator>> entries;
+    size_t budget, size = 0, next_store_id = 0;
+    size_t hits = 0, misses = 0, evictions = 0;
+    void evict(size_t);
+
+  public:
+    explicit ChunkCache(size_t);
+    void configure(size_t);
+    size_t get_store_id(const file_stamp::Stamp &, size_t);
+    Chunk find(size_t, size_t);
+    void insert(size_t, size_t, const Chunk &);
+    CacheStats get_stats();
+    void clear();
+};
+
+ChunkCache &get_cache();
+
+/**
+ * @brief Chunked store opened for reading. The header and chunk index are read once, chunks
+ *      are read with pread and decompressed on a cache miss, such that a store may be read
+ *      from multiple threads.
+ */
+class Store {
+  private:
+    mutable reader::PreadReader file;
+    Header header;
+    std::vector<size_t> grid;
+    std::vector<uint64_t> offsets, sizes;
+    size_t chunks_per_channel = 1, store_id, swap_size = 0;
+
+  public:
+    explicit Store(const std::string &);
+    const Header &get_header() const;
+    const std::vector<size_t> &get_grid() const;
+    size_t get_chunk_start(size_t, size_t) const;
+    size_t get_chunk_extent(size_t, size_t) const;
+    size_t get_compressed_bytes() const;
+    Chunk get_chunk(size_t, size_t) const;
+};
+
+void convert(const std::string &, const std::string &, const std::vector<size_t> &,
+             const std::vector<size_t> & = {}, bool = true);
+
+}  // namespace chunk_store
+
+/**
+ * @brief Reads patches from a chunked store, with the same patch geometry, patch numbering and
+ *      padding as a PatcherSession of the npy file the store was converted from. Only the
+ *      chunks a patch overlaps are decompressed, and chunks shared by overlapping patches are
+ *      reused from the process wide chunk cache.
+ *
+ * @tparam T datatype of the patches
+ */
+template <typename T>
+class ChunkStoreSession : protected Patcher<T> {
+  private:
+    const std::string fpath_arg;
+    const std::vector<size_t> qidx_arg, pshape_arg, pstride_arg, padding_arg, pnum_offset_arg;
+    const chunk_store::Store store;
+    std::vector<size_t> chunk_shape, chunk_offset, grid_strides;
+    std::mutex pool_mutex;
+    std::unique_ptr<ThreadPool> pool;
+    void copy_channel(size_t, const std::vector<std::vector<size_t>> &,
+                      const std::vector<std::vector<size_t>> &,
+                      const std::vector<std::vector<size_t>> &, T *) const;
+
+  public:
+    ChunkStoreSession(const std::string &, const std::vector<size_t> &,
+                      const std::vector<size_t> &, const std::vector<size_t> &,
+                      const std::vector<size_t> & = {}, const std::vector<size_t> & = {});
+    std::vector<T> get_patch(size_t);
+    void get_patch_into(size_t, T *) const;
+    std::vector<T> get_patches(const std::vector<size_t> &, size_t = 1);
+    void get_patches_into(const std::vector<size_t> &, T *, size_t = 1);
+    size_t get_compressed_bytes() const;
+    const std::string &get_filepath() const;
+    const std::vector<size_t> &get_qidx() const;
+    const std::vector<size_t> &get_pshape() const;
+    const std::vector<size_t> &get_pstride() const;
+    const std::vector<size_t> &get_extra_padding() const;
+    const std::vector<size_t> &get_pnum_offset() const;
+    std::vector<size_t> get_chunk_shape() const;
+    using Patcher<T>::get_patch_size;
+    using Patcher<T>::get_data_shape;
+    using Patcher<T>::get_padding;
+    using Patcher<T>::get_num_patches;
+    using Patcher<T>::set_padding_mode;
+    using Patcher<T>::get_padding_mode;
+    using Patcher<T>::get_padding_value;
+};
+
+/**
+ * @brief Construct a new ChunkStoreSession object, reads the store header & chunk index and
+ *      sets the patch geometry.
+ *
+ * @tparam T datatype of the patches
+ * @param fpath filepath of the chunked store
+ * @param qidx qspace index (0th index in file)
+ * @param pshape patch shape
+ * @param pstride patch stride
+ * @param padding extra padding, applied after initial padding calculation
+ * @param pnum_offset patch number offset
+ */
+template <typename T>
+ChunkStoreSession<T>::ChunkStoreSession(const std::string &fpath, const std::vector<size_t> &qidx,
+                                        const std::vector<size_t> &pshape,
+                                        const std::vector<size_t> &pstride,
+                                        const std::vector<size_t> &padding,
+                                        const std::vector<size_t> &pnum_offset)
+    : fpath_arg(fpath),
+      qidx_arg(qidx),
+      pshape_arg(pshape),
+      pstride_arg(pstride),
+      padding_arg(padding),
+      pnum_offset_arg(pnum_offset),
+      store(fpath) {
+    if (qidx.empty()) {
+        throw std::runtime_error("qspace index must contain at least one index.");
+    }
+    const chunk_store::Header &header = store.get_header();
+    if (pshape.size() + 1 != header.shape.size()) {
+        std::ostringstream oss;
+        oss << "Patch shape has " << pshape.size() << " dims, store " << fpath << " has "
+            << header.shape.size() - 1 << " patched dims.";
+        throw std::runtime_error(oss.str());
+    }
+    for (size_t q : qidx) {
+        if (q >= header.shape[0]) {
+            std::ostringstream oss;
+            oss << "qspace index " << q << " is out of bounds for " << header.shape[0]
+                << " qspace indices.";
+            throw std::runtime_error(oss.str());
+        }
+    }
+    this->set_init_vars(fpath, qidx, pshape, pstride, padding, pnum_offset);
+    this->data_shape = header.shape;
+    std::reverse(this->data_shape.begin(), this->data_shape.end());
+    this->file_size = header.itemsize;
+    this->converter = nullptr;
+    const npy_header::dtype_t &dtype = npy_header::has_typestring<T>::dtype;
+    if ((header.kind != dtype.kind) || (header.itemsize != dtype.itemsize)) {
+        if ((header.kind != 'c') && (dtype.kind != 'c')) {
+            this->converter = convert::get_kernel<T>(header.kind, header.itemsize);
+        }
+        if (this->converter == nullptr) {
+            throw std::runtime_error("Type mismatch between class and file.");
+        }
+    }
+    this->set_geometry();
+    std::vector<T>().swap(this->patch);  // patches are copied into caller owned buffers
+
+    // Chunk grid in the reversed dimension order of the patch geometry
+    chunk_shape.assign(header.chunk_shape.rbegin(), header.chunk_shape.rend());
+    chunk_offset.assign(header.chunk_offset.rbegin(), header.chunk_offset.rend());
+    const std::vector<size_t> &grid = store.get_grid();
+    grid_strides.assign(grid.size(), 1);
+    for (size_t i = 1; i < grid.size(); i++) {
+        grid_strides[i] = grid_strides[i - 1] * grid[grid.size() - i];
+    }
+}
+
+/**
+ * @brief Extracts a patch from the store.
+ *
+ * @tparam T datatype of the patches
+ * @param pnum patch number
+ * @return std::vector<T> Patch data
+ */
+template <typename T>
+std::vector<T> ChunkStoreSession<T>::get_patch(size_t pnum) {
+    std::vector<T> patch(this->patch_size);
+    get_patch_into(pnum, patch.data());
+    return patch;
+}
+
+/**
+ * @brief Extracts a patch from the store into an output buffer. The data index that each
+ *      element of the patch is copied from is found along each dimension, following the
+ *      padding mode within padded regions, which gives the chunks the patch overlaps. Those
+ *      chunks are fetched once per qspace index, and each row of the patch is copied from
+ *      them in runs. Safe to call from multiple threads.
+ *
+ * @tparam T datatype of the patches
+ * @param pnum patch number
+ * @param out output buffer, must hold get_patch_size() elements
+ */
+template <typename T>
+void ChunkStoreSession<T>::get_patch_into(size_t pnum, T *out) const {
+    ReadState state;
+    this->set_patch_numbers(pnum, state);
+    const size_t ndim = this->patch_shape.size();
+    const size_t npos = static_cast<size_t>(-1);
+
+    // Data index, chunk index & index among the overlapped chunks of each patch element
+    std::vector<std::vector<size_t>> sources(ndim), touched(ndim), locals(ndim);
+    for (size_t i = 0; i < ndim; i++) {
+        const std::ptrdiff_t start =
+            static_cast<std::ptrdiff_t>(state.patch_num[i] * this->patch_stride[i]) -
+            static_cast<std::ptrdiff_t>(this->padding[2 * i]);
+        const std::ptrdiff_t size = static_cast<std::ptrdiff_t>(this->data_shape[i]);
+        sources[i].resize(this->patch_shape[i]);
+        for (size_t j = 0; j < this->patch_shape[i]; j++) {
+            const std::ptrdiff_t index = start + static_cast<std::ptrdiff_t>(j);
+            size_t source = static_cast<size_t>(index);
+            if ((index < 0) || (index >= size)) {
+                source = (this->padding_mode == pad_mode::Mode::constant)
+                             ? npos
+                             : pad_mode::source_index(this->padding_mode, index,
+                                                      this->data_shape[i]);
+            }
+            sources[i][j] = source;
+            if (source != npos) {
+                touched[i].push_back((source + chunk_offset[i]) / chunk_shape[i]);
+            }
+        }
+        std::sort(touched[i].begin(), touched[i].end());
+        touched[i].erase(std::unique(touched[i].begin(), touched[i].end()), touched[i].end());
+        locals[i].resize(this->patch_shape[i]);
+        for (size_t j = 0; j < this->patch_shape[i]; j++) {
+            if (sources[i][j] != npos) {
+                const size_t chunk = (sources[i][j] + chunk_offset[i]) / chunk_shape[i];
+                locals[i][j] = static_cast<size_t>(
+                    std::lower_bound(touched[i].begin(), touched[i].end(), chunk) -
+                    touched[i].begin());
+            }
+        }
+    }
+
+    const size_t channel_size = this->patch_size / this->qspace_index.size();
+    for (size_t c = 0; c < this->qspace_index.size(); c++) {
+        copy_channel(this->qspace_index[c], sources, touched, locals, out + (c * channel_size));
+    }
+}
+
+/**
+ * @brief Copies one qspace index of a patch from the chunks it overlaps.
+ *
+ * @tparam T datatype of the patches
+ * @param q qspace index
+ * @param sources data index of each patch element along each dimension, -1 if constant padded
+ * @param touched chunk indices overlapped along each dimension, sorted
+ * @param locals index within touched of the chunk of each patch element
+ * @param out output buffer of the qspace index
+ */
+template <typename T>
+void ChunkStoreSession<T>::copy_channel(size_t q, const std::vector<std::vector<size_t>> &sources,
+                                        const std::vector<std::vector<size_t>> &touched,
+                                        const std::vector<std::vector<size_t>> &locals,
+                                        T *out) const {
+    const size_t ndim = this->patch_shape.size();
+    const size_t npos = static_cast<size_t>(-1);
+    const size_t itemsize = this->file_size;
+    const T fill = static_cast<T>(this->padding_value);
+
+    // Fetch the overlapped chunks, the box of touched[0] x ... x touched[ndim - 1]
+    std::vector<size_t> local_strides(ndim, 1);
+    for (size_t i = 1; i < ndim; i++) {
+        local_strides[i] = local_strides[i - 1] * touched[i - 1].size();
+    }
+    std::vector<chunk_store::Chunk> chunks(local_strides.back() * touched.back().size());
+    for (size_t l = 0; l < chunks.size(); l++) {
+        size_t index = 0;
+        for (size_t i = 0; i < ndim; i++) {
+            index += touched[i][(l / local_strides[i]) % touched[i].size()] * grid_strides[i];
+        }
+        chunks[l] = store.get_chunk(q, index);
+    }
+
+    // Start & extent within the data of each overlapped chunk along each dimension
+    std::vector<std::vector<size_t>> starts(ndim), extents(ndim);
+    for (size_t i = 0; i < ndim; i++) {
+        const size_t dim = ndim - 1 - i;  // natural order dimension of the store
+        for (size_t chunk : touched[i]) {
+            starts[i].push_back(store.get_chunk_start(dim, chunk));
+            extents[i].push_back(store.get_chunk_extent(dim, chunk));
+        }
+    }
+
+    // Copy row by row, rows lying within constant padding are filled
+    std::vector<size_t> row(ndim, 0);
+    const size_t row_size = this->patch_shape[0];
+    const size_t num_rows = (this->patch_size / this->qspace_index.size()) / row_size;
+    for (size_t r = 0; r < num_rows; r++, out += row_size) {
+        bool padded = false;
+        size_t local = 0;
+        for (size_t i = 1; i < ndim; i++) {
+            padded |= (sources[i][row[i]] == npos);
+            local += padded ? 0 : locals[i][row[i]] * local_strides[i];
+        }
+        if (padded) {
+            std::fill(out, out + row_size, fill);
+        } else {
+            size_t j = 0;
+            while (j < row_size) {
+                const size_t source = sources[0][j];
+                if (source == npos) {
+                    out[j++] = fill;
+                    continue;
+                }
+                // Run of consecutive data indices within the same chunk
+                const size_t l0 = locals[0][j];
+                size_t length = 1;
+                while ((j + length < row_size) && (locals[0][j + length] == l0) &&
+                       (sources[0][j + length] == source + length)) {
+                    length++;
+                }
+                size_t offset = source - starts[0][l0];
+                size_t stride = extents[0][l0];
+                for (size_t i = 1; i < ndim; i++) {
+                    const size_t li = locals[i][row[i]];
+                    offset += (sources[i][row[i]] - starts[i][li]) * stride;
+                    stride *= extents[i][li];
+                }
+                const char *src = chunks[local + l0]->data() + (offset * itemsize);
+                if (this->converter != nullptr) {
+                    this->converter(src, reinterpret_cast<char *>(out + j), length);
+                } else {
+                    std::memcpy(out + j, src, length * sizeof(T));
+                }
+                j += length;
+            }
+        }
+        for (size_t i = 1; i < ndim; i++) {
+            if (++row[i] < this->patch_shape[i]) {
+                break;
+            }
+            row[i] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Extracts a batch of patches from the store.
+ *
+ * @tparam T datatype of the patches
+ * @param pnums patch numbers
+ * @param num_threads number of worker threads, 0 uses the number of hardware threads
+ * @return std::vector<T> Patch data, contiguous patches in order of pnums
+ */
+template <typename T>
+std::vector<T> ChunkStoreSession<T>::get_patches(const std::vector<size_t> &pnums,
+                                                 size_t num_threads) {
+    std::vector<T> patches(this->patch_size * pnums.size());
+    get_patches_into(pnums, patches.data(), num_threads);
+    return patches;
+}
+
+/**
+ * @brief Extracts a batch of patches from the store into an output buffer. Patches are
+ *      decompressed in parallel when more than one thread is given.
+ *
+ * @tparam T datatype of the patches
+ * @param pnums patch numbers
+ * @param out output buffer, must hold pnums.size() * get_patch_size() elements
+ * @param num_threads number of worker threads, 0 uses the number of hardware threads
+ */
+template <typename T>
+void ChunkStoreSession<T>::get_patches_into(const std::vector<size_t> &pnums, T *out,
+                                            size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    if ((num_threads == 1) || (pnums.size() <= 1)) {
+        for (size_t i = 0; i < pnums.size(); i++) {
+            get_patch_into(pnums[i], out + (i * this->patch_size));
+        }
+        return;
+    }
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    if (!pool || (pool->size() != num_threads)) {
+        pool = std::make_unique<ThreadPool>(num_threads);
+    }
+    pool->parallel_for(pnums.size(), [&](size_t, size_t i) {
+        get_patch_into(pnums[i], out + (i * this->patch_size));
+    });
+}
+
+/**
+ * @brief Gets the size of the compressed chunks of the store in bytes
+ *
+ * @tparam T datatype of the patches
+ * @return size_t Compressed bytes
+ */
+template <typename T>
+size_t ChunkStoreSession<T>::get_compressed_bytes() const {
+    return store.get_compressed_bytes();
+}
+
+template <typename T>
+const std::string &ChunkStoreSession<T>::get_filepath() const {
+    return fpath_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &ChunkStoreSession<T>::get_qidx() const {
+    return qidx_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &ChunkStoreSession<T>::get_pshape() const {
+    return pshape_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &ChunkStoreSession<T>::get_pstride() const {
+    return pstride_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &ChunkStoreSession<T>::get_extra_padding() const {
+    return padding_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &ChunkStoreSession<T>::get_pnum_offset() const {
+    return pnum_offset_arg;
+}
+
+template <typename T>
+std::vector<size_t> ChunkStoreSession<T>::get_chunk_shape() const {
+    return store.get_header().chunk_shape;
+}
+
+#endif  // CHUNK_STORE_HPP_
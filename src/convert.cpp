@@ -0,0 +1,89 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#if defined(__SSE2__)
+#include <emmintrin.h>  // _mm_unpacklo_epi8, _mm_cvtepi32_ps, _mm_storeu_ps
+#endif
+
+#include "src/convert.hpp"
+
+
+namespace convert {
+
+namespace {
+
+/**
+ * @brief Converts the remaining elements after the vectorised loop
+ */
+template <typename From>
+void convert_tail(const char* src, char* dst, size_t done, size_t count) {
+    for (size_t i = done; i < count; i++) {
+        From value;
+        std::memcpy(&value, src + (i * sizeof(From)), sizeof(From));
+        float out = static_cast<float>(value);
+        std::memcpy(dst + (i * sizeof(float)), &out, sizeof(float));
+    }
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief Stores 8 unsigned 16 bit integers as floats
+ */
+inline void store_u16x8(char* dst, __m128i values) {
+    const __m128i zero = _mm_setzero_si128();
+    _mm_storeu_ps(reinterpret_cast<float*>(dst),
+                  _mm_cvtepi32_ps(_mm_unpacklo_epi16(values, zero)));
+    _mm_storeu_ps(reinterpret_cast<float*>(dst + 16),
+                  _mm_cvtepi32_ps(_mm_unpackhi_epi16(values, zero)));
+}
+#endif
+
+}  // namespace
+
+
+template <>
+void convert_elements<uint8_t, float>(const char* src, char* dst, size_t count) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        store_u16x8(dst + (i * 4), _mm_unpacklo_epi8(bytes, zero));
+        store_u16x8(dst + ((i + 8) * 4), _mm_unpackhi_epi8(bytes, zero));
+    }
+#endif
+    convert_tail<uint8_t>(src, dst, i, count);
+}
+
+
+template <>
+void convert_elements<int16_t, float>(const char* src, char* dst, size_t count) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 2)));
+        // Sign extend by interleaving into the upper halves, then shifting down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+        _mm_storeu_ps(reinterpret_cast<float*>(dst + (i * 4)), _mm_cvtepi32_ps(lo));
+        _mm_storeu_ps(reinterpret_cast<float*>(dst + ((i + 4) * 4)), _mm_cvtepi32_ps(hi));
+    }
+#endif
+    convert_tail<int16_t>(src, dst, i, count);
+}
+
+
+template <>
+void convert_elements<uint16_t, float>(const char* src, char* dst, size_t count) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 2)));
+        store_u16x8(dst + (i * 4), values);
+    }
+#endif
+    convert_tail<uint16_t>(src, dst, i, count);
+}
+
+}  // namespace convert
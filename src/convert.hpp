@@ -0,0 +1,128 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONVERT_HPP_
+#define CONVERT_HPP_
+
+#include <cstddef>  // size_t
+#include <cstdint>  // int8_t, int16_t, int32_t, int64_t, uint8_t, uint16_t, uint32_t, uint64_t
+#include <cstring>  // std::memcpy
+#include <limits>   // std::numeric_limits
+
+namespace convert {
+
+// Converts count elements of the file datatype into the output datatype
+using Kernel = void (*)(const char *, char *, size_t);
+
+/**
+ * @brief Converts elements with a static_cast. Loads and stores are memcpy'd, such that
+ *      unaligned data is supported, which compilers lower to plain moves.
+ *
+ * @tparam From datatype in file
+ * @tparam To output datatype
+ * @param src Source elements
+ * @param dst Destination elements
+ * @param count Number of elements
+ */
+template <typename From, typename To>
+void convert_elements(const char *src, char *dst, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        From value;
+        std::memcpy(&value, src + (i * sizeof(From)), sizeof(From));
+        To out = static_cast<To>(value);
+        std::memcpy(dst + (i * sizeof(To)), &out, sizeof(To));
+    }
+}
+
+// Vectorised specialisations for the common integer to float conversions
+template <>
+void convert_elements<uint8_t, float>(const char *, char *, size_t);
+template <>
+void convert_elements<int16_t, float>(const char *, char *, size_t);
+template <>
+void convert_elements<uint16_t, float>(const char *, char *, size_t);
+
+/**
+ * @brief Whether every value of From is exactly representable in To, e.g. int16 or uint8 to
+ *      float. Narrowing conversions, such as float to int or int64 to int32, are not.
+ */
+template <typename From, typename To>
+constexpr bool preserves_values() {
+    using from_limits = std::numeric_limits<From>;
+    using to_limits = std::numeric_limits<To>;
+    if (!from_limits::is_integer) {
+        return !to_limits::is_integer && (from_limits::digits <= to_limits::digits) &&
+               (from_limits::max_exponent <= to_limits::max_exponent);
+    }
+    return (from_limits::digits <= to_limits::digits) &&
+           (to_limits::is_signed || !from_limits::is_signed);
+}
+
+/**
+ * @brief Gets the kernel converting From to To, if the conversion preserves values
+ *
+ * @tparam From datatype in file
+ * @tparam To output datatype
+ * @return Kernel Conversion kernel, nullptr if the conversion may lose values
+ */
+template <typename From, typename To>
+Kernel get_widening_kernel() {
+    if constexpr (preserves_values<From, To>()) {
+        return &convert_elements<From, To>;
+    } else {
+        return nullptr;
+    }
+}
+
+/**
+ * @brief Gets the kernel converting from the file datatype to To
+ *
+ * @tparam To output datatype
+ * @param kind File datatype kind, one of 'f', 'i' or 'u'
+ * @param itemsize File datatype size in bytes
+ * @return Kernel Conversion kernel, nullptr if the conversion is not supported or may lose
+ *      values
+ */
+template <typename To>
+Kernel get_kernel(char kind, size_t itemsize) {
+    switch (kind) {
+        case 'f':
+            if (itemsize == sizeof(float)) {
+                return get_widening_kernel<float, To>();
+            }
+            if (itemsize == sizeof(double)) {
+                return get_widening_kernel<double, To>();
+            }
+            break;
+        case 'i':
+            switch (itemsize) {
+                case 1:
+                    return get_widening_kernel<int8_t, To>();
+                case 2:
+                    return get_widening_kernel<int16_t, To>();
+                case 4:
+                    return get_widening_kernel<int32_t, To>();
+                case 8:
+                    return get_widening_kernel<int64_t, To>();
+            }
+            break;
+        case 'u':
+            switch (itemsize) {
+                case 1:
+                    return get_widening_kernel<uint8_t, To>();
+                case 2:
+                    return get_widening_kernel<uint16_t, To>();
+                case 4:
+                    return get_widening_kernel<uint32_t, To>();
+                case 8:
+                    return get_widening_kernel<uint64_t, To>();
+            }
+            break;
+    }
+    return nullptr;
+}
+
+}  // namespace convert
+
+#endif  // CONVERT_HPP_
@@ -0,0 +1,72 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef FILE_STAMP_HPP_
+#define FILE_STAMP_HPP_
+
+#include <sys/stat.h>   // stat
+#include <sys/types.h>  // dev_t, ino_t, off_t
+
+#include <ctime>      // time_t
+#include <stdexcept>  // std::runtime_error
+#include <string>     // std::string
+#include <tuple>      // std::tie
+
+namespace file_stamp {
+
+/**
+ * @brief Identifies a version of a file, such that caches keyed on it are not served stale
+ *      data once the file is modified in place, or removed and written again. Timestamps are
+ *      kept to the nanosecond, as a rewrite of the same size may reuse the inode within the
+ *      same second.
+ */
+struct Stamp {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    long mtime_nsec;
+    time_t ctime;
+    long ctime_nsec;
+
+    bool operator<(const Stamp &other) const {
+        return std::tie(dev, ino, size, mtime, mtime_nsec, ctime, ctime_nsec) <
+               std::tie(other.dev, other.ino, other.size, other.mtime, other.mtime_nsec,
+                        other.ctime, other.ctime_nsec);
+    }
+};
+
+/**
+ * @brief Gets the stamp of a file from its status
+ *
+ * @param st File status
+ * @return Stamp Stamp of the file
+ */
+inline Stamp from_stat(const struct stat &st) {
+#ifdef __APPLE__
+    const struct timespec &mtim = st.st_mtimespec, &ctim = st.st_ctimespec;
+#else
+    const struct timespec &mtim = st.st_mtim, &ctim = st.st_ctim;
+#endif
+    return {st.st_dev, st.st_ino, st.st_size, mtim.tv_sec, mtim.tv_nsec, ctim.tv_sec,
+            ctim.tv_nsec};
+}
+
+/**
+ * @brief Gets the stamp of a file
+ *
+ * @param filepath Filepath
+ * @return Stamp Stamp of the file
+ */
+inline Stamp get(const std::string &filepath) {
+    struct stat st;
+    if (::stat(filepath.c_str(), &st) != 0) {
+        throw std::runtime_error("IO Error: failed to stat " + filepath);
+    }
+    return from_stat(st);
+}
+
+}  // namespace file_stamp
+
+#endif  // FILE_STAMP_HPP_
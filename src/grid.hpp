@@ -0,0 +1,301 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef GRID_HPP_
+#define GRID_HPP_
+
+#include <algorithm>  // std::min, std::max
+#include <cstring>    // std::memcpy
+#include <stdexcept>  // std::runtime_error
+#include <string>     // std::string
+#include <vector>     // std::vector
+
+#include "src/patcher.hpp"
+#include "src/reader.hpp"
+
+/**
+ * @brief Iterates over every patch of the grid in patch number order. Data is read in slabs
+ *      along the outermost patched dimension, only the rows needed for the current band of
+ *      patches are kept in a ring buffer. Rows shared by overlapping bands are therefore
+ *      read once, and patches are extracted from memory.
+ *
+ * @tparam T datatype of data found within fpath
+ */
+template <typename T>
+class GridIterator : protected Patcher<T> {
+  private:
+    /**
+     * @brief Serves reads of the patch plan from the ring buffer.
+     */
+    class SlabReader : public reader::Reader {
+      private:
+        GridIterator &grid;
+
+      public:
+        explicit SlabReader(GridIterator &grid) : grid(grid) {}
+        void read(char *buf, size_t offset, size_t length) override {
+            grid.read_slab(buf, offset, length);
+        }
+        size_t max_gap() const override { return 0; }
+    };
+    static constexpr size_t no_slot = -1;
+    const std::vector<size_t> qidx_arg, pshape_arg;
+    SlabReader slab_reader;
+    std::vector<char> ring;
+    std::vector<size_t> channel_slots, channels;
+    size_t ring_rows, row_bytes, channel_bytes;
+    size_t band, loaded_lo, loaded_hi, next_pnum, bytes_read;
+    ReadState grid_state;
+    void load_band(size_t);
+    void read_slab(char *, size_t, size_t);
+
+  public:
+    GridIterator(const std::string &, const std::vector<size_t> &, const std::vector<size_t> &,
+                 const std::vector<size_t> &, const std::vector<size_t> & = {},
+                 reader::ReadMode = reader::ReadMode::stream);
+    ~GridIterator();
+    GridIterator(const GridIterator &) = delete;
+    GridIterator &operator=(const GridIterator &) = delete;
+    bool next(T *);
+    void reset();
+    size_t size() const;
+    size_t position() const;
+    size_t get_bytes_read() const;
+    size_t get_slab_bytes() const;
+    const std::vector<size_t> &get_qidx() const;
+    const std::vector<size_t> &get_pshape() const;
+    using Patcher<T>::get_patch_size;
+    using Patcher<T>::get_data_shape;
+    using Patcher<T>::get_padding;
+    using Patcher<T>::get_num_patches;
+    using Patcher<T>::set_normalization;
+    using Patcher<T>::clear_normalization;
+    using Patcher<T>::get_normalizer;
+    using Patcher<T>::set_padding_mode;
+    using Patcher<T>::get_padding_mode;
+    using Patcher<T>::get_padding_value;
+};
+
+/**
+ * @brief Construct a new GridIterator object, opens the npy file, sets the patch geometry
+ *      and allocates the ring buffer. Slabs are read in file order, so the reader is advised
+ *      of sequential access.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param fpath filepath for .npy data file
+ * @param qidx qspace index (0th index in file)
+ * @param pshape patch shape
+ * @param pstride patch stride
+ * @param padding extra padding, applied after initial padding calculation
+ * @param mode backend used to read the slabs
+ */
+template <typename T>
+GridIterator<T>::GridIterator(const std::string &fpath, const std::vector<size_t> &qidx,
+                              const std::vector<size_t> &pshape,
+                              const std::vector<size_t> &pstride,
+                              const std::vector<size_t> &padding, reader::ReadMode mode)
+    : qidx_arg(qidx), pshape_arg(pshape), slab_reader(*this) {
+    if (qidx.empty()) {
+        throw std::runtime_error("qspace index must contain at least one index.");
+    }
+    this->set_init_vars(fpath, qidx, pshape, pstride, padding, {});
+    this->open_file();
+    if (this->fortran_order) {
+        throw std::runtime_error("Grid iteration of Fortran ordered data is not supported.");
+    }
+    this->open_reader(mode);
+    this->reader->advise(reader::AccessHint::sequential);
+    this->set_geometry();
+    std::vector<T>().swap(this->patch);
+
+    // Ring buffer holds one band of rows for each distinct qspace index
+    const size_t dim = this->patch_shape.size() - 1;
+    channel_slots.assign(this->data_shape.back(), no_slot);
+    for (size_t c : qidx) {
+        if (c >= channel_slots.size()) {
+            throw std::runtime_error("qspace index out of range: " + std::to_string(c));
+        }
+        if (channel_slots[c] == no_slot) {
+            channel_slots[c] = channels.size();
+            channels.push_back(c);
+        }
+    }
+    ring_rows = this->patch_shape[dim];
+    row_bytes = this->data_strides[dim];
+    channel_bytes = this->data_strides[dim + 1];
+    ring.resize(channels.size() * ring_rows * row_bytes);
+    reset();
+}
+
+/**
+ * @brief Destroy the GridIterator object, closes the npy file.
+ *
+ * @tparam T datatype of data found within fpath
+ */
+template <typename T>
+GridIterator<T>::~GridIterator() {
+    this->stream.close();
+}
+
+/**
+ * @brief Restarts iteration from the first patch.
+ *
+ * @tparam T datatype of data found within fpath
+ */
+template <typename T>
+void GridIterator<T>::reset() {
+    band = no_slot;
+    loaded_lo = loaded_hi = 0;
+    next_pnum = 0;
+    bytes_read = 0;
+}
+
+/**
+ * @brief Loads the rows of a band of patches into the ring buffer. Rows already loaded for
+ *      the previous band are kept, only the new rows are read, one read per qspace index.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param new_band patch number in the outermost patched dimension
+ */
+template <typename T>
+void GridIterator<T>::load_band(size_t new_band) {
+    const size_t dim = this->patch_shape.size() - 1;
+    const size_t pad_lo = this->padding[2 * dim];
+    const size_t pad_hi = this->padding[(2 * dim) + 1];
+    size_t lo = 0;
+    size_t rows = ring_rows;
+    if (new_band == 0) {
+        rows -= pad_lo;
+    } else {
+        lo = (new_band * this->patch_stride[dim]) - pad_lo;
+    }
+    if (new_band + 1 == this->num_patches[dim]) {
+        rows -= pad_hi;
+    }
+    const size_t hi = lo + rows;
+    const size_t first = ((band != no_slot) && (new_band > band)) ? std::max(lo, loaded_hi) : lo;
+
+    for (size_t slot = 0; slot < channels.size(); slot++) {
+        size_t row = first;
+        while (row < hi) {
+            // Split where the new rows wrap around the ring
+            size_t ring_row = row % ring_rows;
+            size_t n = std::min(hi - row, ring_rows - ring_row);
+            size_t offset =
+                this->data_offset + (channels[slot] * channel_bytes) + (row * row_bytes);
+            char *dest = ring.data() + (((slot * ring_rows) + ring_row) * row_bytes);
+            this->reader->read(dest, offset, n * row_bytes);
+            bytes_read += n * row_bytes;
+            row += n;
+        }
+    }
+    band = new_band;
+    loaded_lo = lo;
+    loaded_hi = hi;
+}
+
+/**
+ * @brief Copies bytes from the ring buffer, given the file offset they were read from. Rows
+ *      outside the loaded band, i.e. the source rows of padding modes other than constant,
+ *      are read from file.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param buf Destination buffer
+ * @param offset Byte offset within file
+ * @param length Number of bytes
+ */
+template <typename T>
+void GridIterator<T>::read_slab(char *buf, size_t offset, size_t length) {
+    size_t rel = offset - this->data_offset;
+    while (length > 0) {
+        size_t channel = rel / channel_bytes;
+        size_t row = (rel % channel_bytes) / row_bytes;
+        size_t within = rel % row_bytes;
+        size_t n = std::min(length, row_bytes - within);
+        if ((channel >= channel_slots.size()) || (channel_slots[channel] == no_slot)) {
+            throw std::runtime_error("Requested data is not within the loaded slab.");
+        }
+        if ((row < loaded_lo) || (row >= loaded_hi)) {
+            this->reader->read(buf, this->data_offset + rel, n);
+            bytes_read += n;
+        } else {
+            size_t ring_row = (channel_slots[channel] * ring_rows) + (row % ring_rows);
+            std::memcpy(buf, ring.data() + (ring_row * row_bytes) + within, n);
+        }
+        buf += n;
+        rel += n;
+        length -= n;
+    }
+}
+
+/**
+ * @brief Extracts the next patch, loading the next slab when entering a new band.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param out output buffer, must hold get_patch_size() elements
+ * @return true If a patch was extracted, false once all patches have been visited
+ */
+template <typename T>
+bool GridIterator<T>::next(T *out) {
+    if (next_pnum >= size()) {
+        return false;
+    }
+    this->set_patch_numbers(next_pnum, grid_state);
+    if (grid_state.patch_num.back() != band) {
+        load_band(grid_state.patch_num.back());
+    }
+    this->extract_patch(next_pnum, out, &slab_reader, grid_state);
+    next_pnum++;
+    return true;
+}
+
+/**
+ * @brief Gets the total number of patches in the grid
+ *
+ * @tparam T datatype of data found within fpath
+ * @return size_t Number of patches
+ */
+template <typename T>
+size_t GridIterator<T>::size() const {
+    return this->max_patch_num;
+}
+
+template <typename T>
+size_t GridIterator<T>::position() const {
+    return next_pnum;
+}
+
+/**
+ * @brief Gets the number of bytes read from file since the last reset
+ *
+ * @tparam T datatype of data found within fpath
+ * @return size_t Bytes read
+ */
+template <typename T>
+size_t GridIterator<T>::get_bytes_read() const {
+    return bytes_read;
+}
+
+/**
+ * @brief Gets the ring buffer size, i.e. the peak memory used for the slab
+ *
+ * @tparam T datatype of data found within fpath
+ * @return size_t Ring buffer size in bytes
+ */
+template <typename T>
+size_t GridIterator<T>::get_slab_bytes() const {
+    return ring.size();
+}
+
+template <typename T>
+const std::vector<size_t> &GridIterator<T>::get_qidx() const {
+    return qidx_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &GridIterator<T>::get_pshape() const {
+    return pshape_arg;
+}
+
+#endif  // GRID_HPP_
@@ -0,0 +1,141 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <list>       // std::list
+#include <map>        // std::map
+#include <mutex>      // std::mutex, std::lock_guard
+#include <stdexcept>  // std::runtime_error
+#include <tuple>      // std::tie
+#include <utility>    // std::pair
+
+#include "src/file_stamp.hpp"
+#include "src/header_cache.hpp"
+
+
+namespace header_cache {
+
+namespace {
+
+// Identifies a file, such that a replaced or modified file is not served a stale header
+struct Key {
+    std::string path;
+    file_stamp::Stamp stamp;
+    size_t offset;
+
+    bool operator<(const Key& other) const {
+        return std::tie(path, stamp, offset) < std::tie(other.path, other.stamp, other.offset);
+    }
+};
+
+/**
+ * @brief Least recently used cache of parsed headers, shared by all patchers in the process.
+ *      Most recently used entries are kept at the front of the list.
+ */
+struct Cache {
+    std::mutex mutex;
+    std::list<std::pair<Key, Entry>> entries;
+    std::map<Key, std::list<std::pair<Key, Entry>>::iterator> index;
+    size_t capacity = default_capacity;
+    size_t hits = 0;
+    size_t misses = 0;
+
+    void evict() {
+        while (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+};
+
+
+Cache& get_cache() {
+    static Cache cache;
+    return cache;
+}
+
+}  // namespace
+
+
+/**
+ * @brief Gets the parsed header of an npy file, reading and parsing it from the opened stream
+ *      only if the file is not already cached.
+ *
+ * @param filepath Filepath of the npy file, or of the archive holding it
+ * @param stream Opened file stream, only read from on a cache miss
+ * @param offset Byte offset of the npy file within the file, non-zero for archive members
+ * @return Entry Parsed header and data offset
+ */
+Entry get_header(const std::string& filepath, std::istream& stream, size_t offset) {
+    Key key{filepath, file_stamp::get(filepath), offset};
+
+    Cache& cache = get_cache();
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.index.find(key);
+        if (it != cache.index.end()) {
+            cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+            cache.hits++;
+            return it->second->second;
+        }
+        cache.misses++;
+    }
+
+    // Parse outside of the lock, such that other files can be served meanwhile
+    stream.seekg(static_cast<std::streamoff>(offset));
+    std::string header_s = npy_header::read_header(stream);
+    size_t data_offset = stream.tellg();
+    if (!stream) {
+        throw std::runtime_error("IO Error: failed to read header of " + filepath);
+    }
+    Entry entry{npy_header::parse_header(header_s), data_offset};
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if ((cache.capacity > 0) && (cache.index.find(key) == cache.index.end())) {
+        cache.entries.emplace_front(key, entry);
+        cache.index.emplace(key, cache.entries.begin());
+        cache.evict();
+    }
+    return entry;
+}
+
+
+/**
+ * @brief Gets the cache statistics
+ *
+ * @return CacheStats Number of hits & misses, number of cached headers and capacity
+ */
+CacheStats get_stats() {
+    Cache& cache = get_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    return {cache.hits, cache.misses, cache.entries.size(), cache.capacity};
+}
+
+
+/**
+ * @brief Sets the maximum number of cached headers, evicting the least recently used
+ *      headers if needed. 0 disables the cache.
+ *
+ * @param capacity Maximum number of cached headers
+ */
+void set_capacity(size_t capacity) {
+    Cache& cache = get_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.capacity = capacity;
+    cache.evict();
+}
+
+
+/**
+ * @brief Removes all cached headers and resets the statistics
+ */
+void clear() {
+    Cache& cache = get_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.entries.clear();
+    cache.index.clear();
+    cache.hits = 0;
+    cache.misses = 0;
+}
+
+}  // namespace header_cache
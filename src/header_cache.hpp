@@ -0,0 +1,36 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef HEADER_CACHE_HPP_
+#define HEADER_CACHE_HPP_
+
+#include <istream>  // std::istream
+#include <string>   // std::string
+
+#include "src/npy_header.hpp"
+
+namespace header_cache {
+
+// Default maximum number of cached headers
+constexpr size_t default_capacity = 4096;
+
+// Parsed header, and the byte offset of the data section
+struct Entry {
+    npy_header::header_t header;
+    size_t data_offset;
+};
+
+// Number of lookups served from the cache, and parsed from file
+struct CacheStats {
+    size_t hits, misses, size, capacity;
+};
+
+Entry get_header(const std::string &, std::istream &, size_t = 0);
+CacheStats get_stats();
+void set_capacity(size_t);
+void clear();
+
+}  // namespace header_cache
+
+#endif  // HEADER_CACHE_HPP_
@@ -0,0 +1,58 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef LE_BYTES_HPP_
+#define LE_BYTES_HPP_
+
+#include <cstddef>  // size_t
+#include <cstdint>  // uint64_t
+#include <cstring>  // std::memcpy
+#include <utility>  // std::swap
+
+#include "src/npy_header.hpp"
+
+namespace le_bytes {
+
+/**
+ * @brief Loads a little endian unsigned integer of up to 8 bytes, as found in zip archives and
+ *      the headers of chunked stores & patch-major files
+ *
+ * @param data Bytes to load, need not be aligned
+ * @param size Number of bytes, at most 8
+ * @return uint64_t Loaded value
+ */
+inline uint64_t load(const char *data, size_t size) {
+    unsigned char bytes[sizeof(uint64_t)] = {};
+    std::memcpy(bytes, data, size);
+    if (npy_header::big_endian) {
+        for (size_t i = 0; i < sizeof(bytes) / 2; i++) {
+            std::swap(bytes[i], bytes[sizeof(bytes) - 1 - i]);
+        }
+    }
+    uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Stores the low bytes of a value as a little endian unsigned integer
+ *
+ * @param data Destination, need not be aligned
+ * @param value Value to store
+ * @param size Number of bytes, at most 8
+ */
+inline void store(char *data, uint64_t value, size_t size) {
+    unsigned char bytes[sizeof(uint64_t)];
+    std::memcpy(bytes, &value, sizeof(value));
+    if (npy_header::big_endian) {
+        for (size_t i = 0; i < sizeof(bytes) / 2; i++) {
+            std::swap(bytes[i], bytes[sizeof(bytes) - 1 - i]);
+        }
+    }
+    std::memcpy(data, bytes, size);
+}
+
+}  // namespace le_bytes
+
+#endif  // LE_BYTES_HPP_
@@ -0,0 +1,237 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>  // std::min
+#include <cstdint>    // uint32_t
+#include <cstring>    // std::memcpy
+#include <stdexcept>  // std::runtime_error
+
+#include "src/lz4.hpp"
+
+
+namespace lz4 {
+
+namespace {
+
+constexpr size_t min_match = 4;
+constexpr size_t last_literals = 5;  // the last bytes of a block are always literals
+constexpr size_t match_limit = 12;   // the last match starts at least this far from the end
+constexpr size_t max_offset = 65535;
+constexpr size_t max_input_size = 0x7E000000;
+constexpr int hash_bits = 16;
+constexpr size_t skip_trigger = 6;  // step grows by 1 every 2^skip_trigger failed searches
+
+
+uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+
+uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - hash_bits);
+}
+
+
+/**
+ * @brief Writes the remainder of a literal or match length, as bytes of 255 followed by a
+ *      final byte below 255
+ */
+char* write_length(char* op, size_t length) {
+    while (length >= 255) {
+        *op++ = static_cast<char>(255);
+        length -= 255;
+    }
+    *op++ = static_cast<char>(length);
+    return op;
+}
+
+
+/**
+ * @brief Writes a sequence of literals followed by a match. The last sequence of a block has
+ *      no match, given by a match length of 0.
+ *
+ * @param op Output position
+ * @param literals Literal bytes
+ * @param num_literals Number of literal bytes
+ * @param offset Distance back to the match
+ * @param length Match length
+ * @return char* Output position after the sequence
+ */
+char* write_sequence(char* op, const char* literals, size_t num_literals, size_t offset,
+                     size_t length) {
+    char* token = op++;
+    unsigned char value = static_cast<unsigned char>(std::min<size_t>(num_literals, 15) << 4);
+    if (num_literals >= 15) {
+        op = write_length(op, num_literals - 15);
+    }
+    std::memcpy(op, literals, num_literals);
+    op += num_literals;
+    if (length > 0) {
+        *op++ = static_cast<char>(offset & 0xFF);
+        *op++ = static_cast<char>(offset >> 8);
+        const size_t extra = length - min_match;
+        value |= static_cast<unsigned char>(std::min<size_t>(extra, 15));
+        if (extra >= 15) {
+            op = write_length(op, extra - 15);
+        }
+    }
+    *token = static_cast<char>(value);
+    return op;
+}
+
+
+/**
+ * @brief Reads the remainder of a literal or match length
+ */
+size_t read_length(const unsigned char* in, size_t size, size_t& ip) {
+    size_t length = 0;
+    unsigned char byte;
+    do {
+        if (ip >= size) {
+            throw std::runtime_error("Corrupt LZ4 block, length runs past the end.");
+        }
+        byte = in[ip++];
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+}  // namespace
+
+
+/**
+ * @brief Gets the largest compressed size of an input, reached by incompressible data
+ *
+ * @param size Input size in bytes
+ * @return size_t Maximum compressed size in bytes
+ */
+size_t compress_bound(size_t size) {
+    return size + (size / 255) + 16;
+}
+
+
+/**
+ * @brief Compresses a block with a single pass greedy match search. Positions are hashed by
+ *      their next 4 bytes, and failed searches step further ahead as they accumulate, such that
+ *      incompressible data is skipped over quickly.
+ *
+ * @param src Input bytes
+ * @param size Input size in bytes
+ * @return std::vector<char> Compressed block
+ */
+std::vector<char> compress(const char* src, size_t size) {
+    if (size > max_input_size) {
+        throw std::runtime_error("LZ4 block input is too large.");
+    }
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+    std::vector<char> out(compress_bound(size));
+    char* op = out.data();
+    size_t anchor = 0;
+
+    if (size > match_limit) {
+        std::vector<uint32_t> table(size_t(1) << hash_bits, 0);  // position + 1, 0 if empty
+        const size_t last_match = size - match_limit;
+        const size_t match_end = size - last_literals;
+        size_t ip = 0;
+        size_t searches = size_t(1) << skip_trigger;
+        while (ip < last_match) {
+            const uint32_t sequence = read32(in + ip);
+            const uint32_t h = hash(sequence);
+            const size_t candidate = table[h];
+            table[h] = static_cast<uint32_t>(ip + 1);
+            if ((candidate == 0) || (ip + 1 - candidate > max_offset) ||
+                (read32(in + candidate - 1) != sequence)) {
+                ip += searches++ >> skip_trigger;
+                continue;
+            }
+
+            // Extend the match backwards over pending literals, then forwards
+            size_t match = candidate - 1;
+            while ((ip > anchor) && (match > 0) && (in[ip - 1] == in[match - 1])) {
+                ip--;
+                match--;
+            }
+            size_t length = min_match;
+            while ((ip + length < match_end) && (in[match + length] == in[ip + length])) {
+                length++;
+            }
+            op = write_sequence(op, src + anchor, ip - anchor, ip - match, length);
+            ip += length;
+            anchor = ip;
+            searches = size_t(1) << skip_trigger;
+            table[hash(read32(in + ip - 2))] = static_cast<uint32_t>(ip - 1);
+        }
+    }
+    op = write_sequence(op, src + anchor, size - anchor, 0, 0);
+    out.resize(static_cast<size_t>(op - out.data()));
+    return out;
+}
+
+
+/**
+ * @brief Decompresses a block, every length and offset is checked against the input and output
+ *      bounds such that a corrupt block raises an error rather than reading or writing out of
+ *      bounds.
+ *
+ * @param src Compressed block
+ * @param size Compressed size in bytes
+ * @param dst Output buffer
+ * @param raw_size Decompressed size in bytes
+ */
+void decompress(const char* src, size_t size, char* dst, size_t raw_size) {
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+    size_t ip = 0;
+    size_t op = 0;
+    while (true) {
+        if (ip >= size) {
+            throw std::runtime_error("Corrupt LZ4 block, sequence runs past the end.");
+        }
+        const unsigned char token = in[ip++];
+        size_t num_literals = token >> 4;
+        if (num_literals == 15) {
+            num_literals += read_length(in, size, ip);
+        }
+        if ((num_literals > size - ip) || (num_literals > raw_size - op)) {
+            throw std::runtime_error("Corrupt LZ4 block, literals run past the end.");
+        }
+        std::memcpy(dst + op, src + ip, num_literals);
+        ip += num_literals;
+        op += num_literals;
+        if (ip == size) {
+            break;  // last sequence has no match
+        }
+
+        if (size - ip < 2) {
+            throw std::runtime_error("Corrupt LZ4 block, match offset runs past the end.");
+        }
+        const size_t offset = in[ip] | (static_cast<size_t>(in[ip + 1]) << 8);
+        ip += 2;
+        size_t length = token & 0xF;
+        if (length == 15) {
+            length += read_length(in, size, ip);
+        }
+        length += min_match;
+        if ((offset == 0) || (offset > op) || (length > raw_size - op)) {
+            throw std::runtime_error("Corrupt LZ4 block, match is out of bounds.");
+        }
+        // Matches may overlap the bytes they produce, repeating the last offset bytes
+        char* out = dst + op;
+        const char* match = out - offset;
+        if (offset >= length) {
+            std::memcpy(out, match, length);
+        } else {
+            for (size_t i = 0; i < length; i++) {
+                out[i] = match[i];
+            }
+        }
+        op += length;
+    }
+    if (op != raw_size) {
+        throw std::runtime_error("Corrupt LZ4 block, decompressed size does not match.");
+    }
+}
+
+}  // namespace lz4
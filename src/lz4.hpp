@@ -0,0 +1,24 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef LZ4_HPP_
+#define LZ4_HPP_
+
+#include <cstddef>  // size_t
+#include <vector>   // std::vector
+
+/**
+ * @brief Compressor & decompressor of the LZ4 block format, such that blocks may also be read
+ *      with the reference LZ4 library. Blocks hold no size information, the decompressed size
+ *      is stored alongside each block by the caller.
+ */
+namespace lz4 {
+
+size_t compress_bound(size_t);
+std::vector<char> compress(const char *, size_t);
+void decompress(const char *, size_t, char *, size_t);
+
+}  // namespace lz4
+
+#endif  // LZ4_HPP_
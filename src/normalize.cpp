@@ -0,0 +1,155 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>  // std::min, std::max
+#include <cstring>    // std::memcpy
+#include <stdexcept>  // std::runtime_error
+
+#if defined(__SSE2__)
+#include <emmintrin.h>  // _mm_mul_ps, _mm_add_ps, _mm_max_ps, _mm_min_ps
+#endif
+
+#include "src/normalize.hpp"
+
+
+namespace normalize {
+
+namespace {
+
+/**
+ * @brief Normalizes the remaining elements after the vectorised loop
+ */
+template <typename T>
+void affine_clip_tail(char* data, size_t done, size_t count, T scale, T offset, T lo, T hi) {
+    for (size_t i = done; i < count; i++) {
+        T value;
+        std::memcpy(&value, data + (i * sizeof(T)), sizeof(T));
+        value = std::min(std::max((value * scale) + offset, lo), hi);
+        std::memcpy(data + (i * sizeof(T)), &value, sizeof(T));
+    }
+}
+
+}  // namespace
+
+
+template <>
+void affine_clip<float>(char* data, size_t count, double scale, double offset, double lo,
+                        double hi) {
+    const float s = static_cast<float>(scale);
+    const float o = static_cast<float>(offset);
+    const float l = static_cast<float>(lo);
+    const float h = static_cast<float>(hi);
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 vs = _mm_set1_ps(s);
+    const __m128 vo = _mm_set1_ps(o);
+    const __m128 vl = _mm_set1_ps(l);
+    const __m128 vh = _mm_set1_ps(h);
+    // Bounds are the first operand, such that NaN propagates as with np.clip
+    for (; i + 4 <= count; i += 4) {
+        float* ptr = reinterpret_cast<float*>(data + (i * 4));
+        __m128 value = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ptr), vs), vo);
+        _mm_storeu_ps(ptr, _mm_min_ps(vh, _mm_max_ps(vl, value)));
+    }
+#endif
+    affine_clip_tail<float>(data, i, count, s, o, l, h);
+}
+
+
+template <>
+void affine_clip<double>(char* data, size_t count, double scale, double offset, double lo,
+                         double hi) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128d vs = _mm_set1_pd(scale);
+    const __m128d vo = _mm_set1_pd(offset);
+    const __m128d vl = _mm_set1_pd(lo);
+    const __m128d vh = _mm_set1_pd(hi);
+    for (; i + 2 <= count; i += 2) {
+        double* ptr = reinterpret_cast<double*>(data + (i * 8));
+        __m128d value = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(ptr), vs), vo);
+        _mm_storeu_pd(ptr, _mm_min_pd(vh, _mm_max_pd(vl, value)));
+    }
+#endif
+    affine_clip_tail<double>(data, i, count, scale, offset, lo, hi);
+}
+
+
+/**
+ * @brief Construct a new Normalizer object
+ *
+ * @param scale Scale of each channel, or a single scale for all channels
+ * @param offset Offset of each channel, or a single offset for all channels
+ * @param lo Lower clip bound
+ * @param hi Upper clip bound
+ * @param fill_value Value of the constant padded regions, used by the patcher when filling
+ * @param channel_bytes Size of one channel of the patch in bytes
+ * @param elem_size Element size in bytes
+ * @param kernel Kernel normalizing elements of elem_size bytes
+ */
+Normalizer::Normalizer(const std::vector<double>& scale, const std::vector<double>& offset,
+                       double lo, double hi, double fill_value, size_t channel_bytes,
+                       size_t elem_size, Kernel kernel)
+    : scale(scale),
+      offset(offset),
+      lo(lo),
+      hi(hi),
+      fill_value(fill_value),
+      channel_bytes(channel_bytes),
+      elem_size(elem_size),
+      kernel(kernel) {
+    if (scale.empty() || (scale.size() != offset.size())) {
+        throw std::runtime_error("Normalization scale and offset must have the same length.");
+    }
+    if (lo > hi) {
+        throw std::runtime_error("Normalization lower clip bound is greater than upper bound.");
+    }
+}
+
+
+/**
+ * @brief Normalizes a span of the patch in place, split at channel boundaries such that each
+ *      part is normalized with the parameters of its channel.
+ *
+ * @param patch Patch buffer
+ * @param dest Byte offset of span within patch
+ * @param length Number of bytes
+ */
+void Normalizer::apply(char* patch, size_t dest, size_t length) const {
+    while (length > 0) {
+        size_t channel = dest / channel_bytes;
+        size_t n = std::min(length, ((channel + 1) * channel_bytes) - dest);
+        size_t c = (scale.size() == 1) ? 0 : channel;
+        kernel(patch + dest, n / elem_size, scale[c], offset[c], lo, hi);
+        dest += n;
+        length -= n;
+    }
+}
+
+
+const std::vector<double>& Normalizer::get_scale() const {
+    return scale;
+}
+
+
+const std::vector<double>& Normalizer::get_offset() const {
+    return offset;
+}
+
+
+double Normalizer::get_lo() const {
+    return lo;
+}
+
+
+double Normalizer::get_hi() const {
+    return hi;
+}
+
+
+double Normalizer::get_fill_value() const {
+    return fill_value;
+}
+
+}  // namespace normalize
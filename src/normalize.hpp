@@ -0,0 +1,74 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef NORMALIZE_HPP_
+#define NORMALIZE_HPP_
+
+#include <cstddef>  // size_t
+#include <vector>   // std::vector
+
+namespace normalize {
+
+// Scales, offsets and clips count elements in place, given scale, offset, lower & upper bound
+using Kernel = void (*)(char *, size_t, double, double, double, double);
+
+/**
+ * @brief Applies x * scale + offset, clipped to [lo, hi], to each element in place. The
+ *      arithmetic is done in the element type, such that results match NumPy.
+ *
+ * @tparam T element type, float or double
+ */
+template <typename T>
+void affine_clip(char *, size_t, double, double, double, double);
+
+template <>
+void affine_clip<float>(char *, size_t, double, double, double, double);
+template <>
+void affine_clip<double>(char *, size_t, double, double, double, double);
+
+/**
+ * @brief Per channel affine transform and clip of a patch, applied to each run of the patch
+ *      as it is copied, while still in cache. Constant padded regions are set to the fill
+ *      value instead.
+ */
+class Normalizer {
+  private:
+    std::vector<double> scale, offset;
+    double lo, hi, fill_value;
+    size_t channel_bytes, elem_size;
+    Kernel kernel;
+
+  public:
+    Normalizer(const std::vector<double> &, const std::vector<double> &, double, double, double,
+               size_t, size_t, Kernel);
+    void apply(char *, size_t, size_t) const;
+    const std::vector<double> &get_scale() const;
+    const std::vector<double> &get_offset() const;
+    double get_lo() const;
+    double get_hi() const;
+    double get_fill_value() const;
+};
+
+/**
+ * @brief Creates a normalizer for patches of type T
+ *
+ * @tparam T patch datatype, float or double
+ * @param scale Scale of each channel
+ * @param offset Offset of each channel, added after scaling
+ * @param lo Lower clip bound
+ * @param hi Upper clip bound
+ * @param fill_value Value of the constant padded regions
+ * @param channel_bytes Size of one channel of the patch in bytes
+ * @return Normalizer Normalizer
+ */
+template <typename T>
+Normalizer make_normalizer(const std::vector<double> &scale, const std::vector<double> &offset,
+                           double lo, double hi, double fill_value, size_t channel_bytes) {
+    return Normalizer(scale, offset, lo, hi, fill_value, channel_bytes, sizeof(T),
+                      &affine_clip<T>);
+}
+
+}  // namespace normalize
+
+#endif  // NORMALIZE_HPP_
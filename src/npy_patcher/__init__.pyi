@@ -1,7 +1,65 @@
 '''NumPy Patcher'''
-from typing import List, Tuple, Union
+from enum import Enum
+from typing import Dict, Iterable, List, Optional, Sequence, Tuple, Union
 
-from numpy import double, float32, int32, int64, ndarray
+from numpy import ndarray
+
+class ReadMode(Enum):
+    stream: int
+    mmap: int
+    pread: int
+    cached: int
+    uring: int
+    direct: int
+
+class AccessHint(Enum):
+    '''Expected access pattern, see set_access_hint. With ReadMode.stream, sequential & random
+    do not change the readahead of the stream, only willneed & the byte ranges of batches take
+    effect.
+    ReadMode.direct bypasses the page cache and ignores hints.'''
+
+    normal: int
+    sequential: int
+    random: int
+    willneed: int
+
+class PadMode(Enum):
+    constant: int
+    edge: int
+    reflect: int
+    symmetric: int
+    wrap: int
+
+class CachePolicy(Enum):
+    lru: int
+    clock: int
+
+def io_uring_available() -> bool: ...
+def get_header_cache_stats() -> Dict[str, int]: ...
+def set_header_cache_capacity(capacity: int) -> None: ...
+def clear_header_cache() -> None: ...
+def set_block_cache(
+    budget: int, block_size: int = 65536, policy: CachePolicy = CachePolicy.lru
+) -> None: ...
+def get_block_cache_stats() -> Dict[str, int]: ...
+def clear_block_cache() -> None: ...
+def convert_to_chunk_store(
+    fpath: str,
+    store_fpath: str,
+    chunk_shape: Union[Tuple[int, ...], List[int], ndarray],
+    chunk_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+    shuffle: bool = True,
+) -> None: ...
+def set_chunk_cache(budget: int) -> None: ...
+def get_chunk_cache_stats() -> Dict[str, int]: ...
+def clear_chunk_cache() -> None: ...
+def convert_to_patch_major(
+    session: Union[
+        PatcherSessionDouble, PatcherSessionFloat, PatcherSessionInt, PatcherSessionLong
+    ],
+    fpath: str,
+    num_threads: int = 1,
+) -> None: ...
 
 class PatcherDouble:
     def __init__(self) -> None: ...
@@ -14,7 +72,17 @@ class PatcherDouble:
         pnum: int,
         padding: Union[Tuple[int, ...], List[int], ndarray] = (),
         pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
-    ) -> List[double]: ...
+    ) -> ndarray: ...
+    def get_patches(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        pnums: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+    ) -> ndarray: ...
     def get_patch_size(self) -> List[int]: ...
     def get_padding(self) -> List[int]: ...
     def get_data_strides(self) -> List[int]: ...
@@ -34,7 +102,17 @@ class PatcherFloat:
         pnum: int,
         padding: Union[Tuple[int, ...], List[int], ndarray] = (),
         pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
-    ) -> List[float32]: ...
+    ) -> ndarray: ...
+    def get_patches(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        pnums: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+    ) -> ndarray: ...
     def get_patch_size(self) -> List[int]: ...
     def get_padding(self) -> List[int]: ...
     def get_data_strides(self) -> List[int]: ...
@@ -54,7 +132,17 @@ class PatcherInt:
         pnum: int,
         padding: Union[Tuple[int, ...], List[int], ndarray] = (),
         pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
-    ) -> List[int32]: ...
+    ) -> ndarray: ...
+    def get_patches(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        pnums: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+    ) -> ndarray: ...
     def get_patch_size(self) -> List[int]: ...
     def get_padding(self) -> List[int]: ...
     def get_data_strides(self) -> List[int]: ...
@@ -74,7 +162,17 @@ class PatcherLong:
         pnum: int,
         padding: Union[Tuple[int, ...], List[int], ndarray] = (),
         pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
-    ) -> List[int64]: ...
+    ) -> ndarray: ...
+    def get_patches(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        pnums: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+    ) -> ndarray: ...
     def get_patch_size(self) -> List[int]: ...
     def get_padding(self) -> List[int]: ...
     def get_data_strides(self) -> List[int]: ...
@@ -82,3 +180,616 @@ class PatcherLong:
     def get_num_patches(self) -> List[int]: ...
     def get_shift_lengths(self) -> List[int]: ...
     def get_patch_numbers(self) -> List[int]: ...
+
+class PatcherSessionDouble:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+        mode: ReadMode = ReadMode.stream,
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_plan_stats(self, pnum: int) -> Dict[str, int]: ...
+    def get_patch_offset(self, pnum: int) -> int: ...
+    def set_access_hint(self, hint: AccessHint) -> None: ...
+    def get_access_hint(self) -> AccessHint: ...
+    def set_normalization(
+        self,
+        scale: Sequence[float],
+        offset: Sequence[float],
+        clip_min: float = ...,
+        clip_max: float = ...,
+        fill_value: float = 0.0,
+    ) -> None: ...
+    def clear_normalization(self) -> None: ...
+    def get_normalization(
+        self,
+    ) -> Optional[Tuple[List[float], List[float], float, float, float]]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_data_strides(self) -> List[int]: ...
+    def get_patch_strides(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class PatcherSessionFloat:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+        mode: ReadMode = ReadMode.stream,
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_plan_stats(self, pnum: int) -> Dict[str, int]: ...
+    def get_patch_offset(self, pnum: int) -> int: ...
+    def set_access_hint(self, hint: AccessHint) -> None: ...
+    def get_access_hint(self) -> AccessHint: ...
+    def set_normalization(
+        self,
+        scale: Sequence[float],
+        offset: Sequence[float],
+        clip_min: float = ...,
+        clip_max: float = ...,
+        fill_value: float = 0.0,
+    ) -> None: ...
+    def clear_normalization(self) -> None: ...
+    def get_normalization(
+        self,
+    ) -> Optional[Tuple[List[float], List[float], float, float, float]]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_data_strides(self) -> List[int]: ...
+    def get_patch_strides(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class PatcherSessionInt:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+        mode: ReadMode = ReadMode.stream,
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_plan_stats(self, pnum: int) -> Dict[str, int]: ...
+    def get_patch_offset(self, pnum: int) -> int: ...
+    def set_access_hint(self, hint: AccessHint) -> None: ...
+    def get_access_hint(self) -> AccessHint: ...
+    def set_normalization(
+        self,
+        scale: Sequence[float],
+        offset: Sequence[float],
+        clip_min: float = ...,
+        clip_max: float = ...,
+        fill_value: float = 0.0,
+    ) -> None: ...
+    def clear_normalization(self) -> None: ...
+    def get_normalization(
+        self,
+    ) -> Optional[Tuple[List[float], List[float], float, float, float]]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_data_strides(self) -> List[int]: ...
+    def get_patch_strides(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class PatcherSessionLong:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+        mode: ReadMode = ReadMode.stream,
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_plan_stats(self, pnum: int) -> Dict[str, int]: ...
+    def get_patch_offset(self, pnum: int) -> int: ...
+    def set_access_hint(self, hint: AccessHint) -> None: ...
+    def get_access_hint(self) -> AccessHint: ...
+    def set_normalization(
+        self,
+        scale: Sequence[float],
+        offset: Sequence[float],
+        clip_min: float = ...,
+        clip_max: float = ...,
+        fill_value: float = 0.0,
+    ) -> None: ...
+    def clear_normalization(self) -> None: ...
+    def get_normalization(
+        self,
+    ) -> Optional[Tuple[List[float], List[float], float, float, float]]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_data_strides(self) -> List[int]: ...
+    def get_patch_strides(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class GridIteratorDouble:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        mode: ReadMode = ReadMode.stream,
+    ) -> None: ...
+    def __iter__(self) -> GridIteratorDouble: ...
+    def __next__(self) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def reset(self) -> None: ...
+    def position(self) -> int: ...
+    def get_bytes_read(self) -> int: ...
+    def get_slab_bytes(self) -> int: ...
+    def set_normalization(
+        self,
+        scale: Sequence[float],
+        offset: Sequence[float],
+        clip_min: float = ...,
+        clip_max: float = ...,
+        fill_value: float = 0.0,
+    ) -> None: ...
+    def clear_normalization(self) -> None: ...
+    def get_normalization(
+        self,
+    ) -> Optional[Tuple[List[float], List[float], float, float, float]]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class GridIteratorFloat:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        mode: ReadMode = ReadMode.stream,
+    ) -> None: ...
+    def __iter__(self) -> GridIteratorFloat: ...
+    def __next__(self) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def reset(self) -> None: ...
+    def position(self) -> int: ...
+    def get_bytes_read(self) -> int: ...
+    def get_slab_bytes(self) -> int: ...
+    def set_normalization(
+        self,
+        scale: Sequence[float],
+        offset: Sequence[float],
+        clip_min: float = ...,
+        clip_max: float = ...,
+        fill_value: float = 0.0,
+    ) -> None: ...
+    def clear_normalization(self) -> None: ...
+    def get_normalization(
+        self,
+    ) -> Optional[Tuple[List[float], List[float], float, float, float]]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class GridIteratorInt:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        mode: ReadMode = ReadMode.stream,
+    ) -> None: ...
+    def __iter__(self) -> GridIteratorInt: ...
+    def __next__(self) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def reset(self) -> None: ...
+    def position(self) -> int: ...
+    def get_bytes_read(self) -> int: ...
+    def get_slab_bytes(self) -> int: ...
+    def set_normalization(
+        self,
+        scale: Sequence[float],
+        offset: Sequence[float],
+        clip_min: float = ...,
+        clip_max: float = ...,
+        fill_value: float = 0.0,
+    ) -> None: ...
+    def clear_normalization(self) -> None: ...
+    def get_normalization(
+        self,
+    ) -> Optional[Tuple[List[float], List[float], float, float, float]]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class GridIteratorLong:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        mode: ReadMode = ReadMode.stream,
+    ) -> None: ...
+    def __iter__(self) -> GridIteratorLong: ...
+    def __next__(self) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def reset(self) -> None: ...
+    def position(self) -> int: ...
+    def get_bytes_read(self) -> int: ...
+    def get_slab_bytes(self) -> int: ...
+    def set_normalization(
+        self,
+        scale: Sequence[float],
+        offset: Sequence[float],
+        clip_min: float = ...,
+        clip_max: float = ...,
+        fill_value: float = 0.0,
+    ) -> None: ...
+    def clear_normalization(self) -> None: ...
+    def get_normalization(
+        self,
+    ) -> Optional[Tuple[List[float], List[float], float, float, float]]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class PrefetcherDouble:
+    def __init__(
+        self,
+        session: PatcherSessionDouble,
+        pnums: Iterable[int],
+        depth: int = 8,
+        num_threads: int = 1,
+    ) -> None: ...
+    def __iter__(self) -> PrefetcherDouble: ...
+    def __next__(self) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def position(self) -> int: ...
+
+class PrefetcherFloat:
+    def __init__(
+        self,
+        session: PatcherSessionFloat,
+        pnums: Iterable[int],
+        depth: int = 8,
+        num_threads: int = 1,
+    ) -> None: ...
+    def __iter__(self) -> PrefetcherFloat: ...
+    def __next__(self) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def position(self) -> int: ...
+
+class PrefetcherInt:
+    def __init__(
+        self,
+        session: PatcherSessionInt,
+        pnums: Iterable[int],
+        depth: int = 8,
+        num_threads: int = 1,
+    ) -> None: ...
+    def __iter__(self) -> PrefetcherInt: ...
+    def __next__(self) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def position(self) -> int: ...
+
+class PrefetcherLong:
+    def __init__(
+        self,
+        session: PatcherSessionLong,
+        pnums: Iterable[int],
+        depth: int = 8,
+        num_threads: int = 1,
+    ) -> None: ...
+    def __iter__(self) -> PrefetcherLong: ...
+    def __next__(self) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def position(self) -> int: ...
+
+class PatchSamplerDouble:
+    def __init__(
+        self,
+        session: PatcherSessionDouble,
+        seed: int,
+        lower: Sequence[int] = ...,
+        upper: Sequence[int] = ...,
+        weights: Optional[Sequence[float]] = None,
+    ) -> None: ...
+    def set_epoch(self, epoch: int, worker: int = 0) -> None: ...
+    def sample(self, batch_size: int, num_threads: int = 1) -> Tuple[ndarray, ndarray]: ...
+    def sample_pnums(self, batch_size: int) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def get_seed(self) -> int: ...
+    def get_epoch(self) -> int: ...
+    def get_worker(self) -> int: ...
+
+class PatchSamplerFloat:
+    def __init__(
+        self,
+        session: PatcherSessionFloat,
+        seed: int,
+        lower: Sequence[int] = ...,
+        upper: Sequence[int] = ...,
+        weights: Optional[Sequence[float]] = None,
+    ) -> None: ...
+    def set_epoch(self, epoch: int, worker: int = 0) -> None: ...
+    def sample(self, batch_size: int, num_threads: int = 1) -> Tuple[ndarray, ndarray]: ...
+    def sample_pnums(self, batch_size: int) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def get_seed(self) -> int: ...
+    def get_epoch(self) -> int: ...
+    def get_worker(self) -> int: ...
+
+class PatchSamplerInt:
+    def __init__(
+        self,
+        session: PatcherSessionInt,
+        seed: int,
+        lower: Sequence[int] = ...,
+        upper: Sequence[int] = ...,
+        weights: Optional[Sequence[float]] = None,
+    ) -> None: ...
+    def set_epoch(self, epoch: int, worker: int = 0) -> None: ...
+    def sample(self, batch_size: int, num_threads: int = 1) -> Tuple[ndarray, ndarray]: ...
+    def sample_pnums(self, batch_size: int) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def get_seed(self) -> int: ...
+    def get_epoch(self) -> int: ...
+    def get_worker(self) -> int: ...
+
+class PatchSamplerLong:
+    def __init__(
+        self,
+        session: PatcherSessionLong,
+        seed: int,
+        lower: Sequence[int] = ...,
+        upper: Sequence[int] = ...,
+        weights: Optional[Sequence[float]] = None,
+    ) -> None: ...
+    def set_epoch(self, epoch: int, worker: int = 0) -> None: ...
+    def sample(self, batch_size: int, num_threads: int = 1) -> Tuple[ndarray, ndarray]: ...
+    def sample_pnums(self, batch_size: int) -> ndarray: ...
+    def __len__(self) -> int: ...
+    def get_seed(self) -> int: ...
+    def get_epoch(self) -> int: ...
+    def get_worker(self) -> int: ...
+
+class ChunkStoreSessionDouble:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_compressed_bytes(self) -> int: ...
+    def get_chunk_shape(self) -> List[int]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class ChunkStoreSessionFloat:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_compressed_bytes(self) -> int: ...
+    def get_chunk_shape(self) -> List[int]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class ChunkStoreSessionInt:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_compressed_bytes(self) -> int: ...
+    def get_chunk_shape(self) -> List[int]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class ChunkStoreSessionLong:
+    def __init__(
+        self,
+        fpath: str,
+        qidx: Union[Tuple[int, ...], List[int], ndarray],
+        pshape: Union[Tuple[int, ...], List[int], ndarray],
+        pstride: Union[Tuple[int, ...], List[int], ndarray],
+        padding: Union[Tuple[int, ...], List[int], ndarray] = (),
+        pnum_offset: Union[Tuple[int, ...], List[int], ndarray] = (),
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_compressed_bytes(self) -> int: ...
+    def get_chunk_shape(self) -> List[int]: ...
+    def set_padding_mode(self, mode: PadMode, constant_value: float = 0.0) -> None: ...
+    def get_padding_mode(self) -> PadMode: ...
+    def get_padding_value(self) -> float: ...
+    def get_patch_size(self) -> int: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class PatchMajorReaderDouble:
+    def __init__(
+        self, fpath: str, qidx: Union[Tuple[int, ...], List[int], ndarray] = ()
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_patch_offset(self, pnum: int) -> int: ...
+    def get_num_reads(self) -> int: ...
+    def get_patch_size(self) -> int: ...
+    def get_qidx(self) -> List[int]: ...
+    def get_stored_qidx(self) -> List[int]: ...
+    def get_pshape(self) -> List[int]: ...
+    def get_pstride(self) -> List[int]: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class PatchMajorReaderFloat:
+    def __init__(
+        self, fpath: str, qidx: Union[Tuple[int, ...], List[int], ndarray] = ()
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_patch_offset(self, pnum: int) -> int: ...
+    def get_num_reads(self) -> int: ...
+    def get_patch_size(self) -> int: ...
+    def get_qidx(self) -> List[int]: ...
+    def get_stored_qidx(self) -> List[int]: ...
+    def get_pshape(self) -> List[int]: ...
+    def get_pstride(self) -> List[int]: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class PatchMajorReaderInt:
+    def __init__(
+        self, fpath: str, qidx: Union[Tuple[int, ...], List[int], ndarray] = ()
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_patch_offset(self, pnum: int) -> int: ...
+    def get_num_reads(self) -> int: ...
+    def get_patch_size(self) -> int: ...
+    def get_qidx(self) -> List[int]: ...
+    def get_stored_qidx(self) -> List[int]: ...
+    def get_pshape(self) -> List[int]: ...
+    def get_pstride(self) -> List[int]: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class PatchMajorReaderLong:
+    def __init__(
+        self, fpath: str, qidx: Union[Tuple[int, ...], List[int], ndarray] = ()
+    ) -> None: ...
+    def get_patch(self, pnum: int) -> ndarray: ...
+    def get_patches(
+        self, pnums: Union[Tuple[int, ...], List[int], ndarray], num_threads: int = 1
+    ) -> ndarray: ...
+    def get_patch_offset(self, pnum: int) -> int: ...
+    def get_num_reads(self) -> int: ...
+    def get_patch_size(self) -> int: ...
+    def get_qidx(self) -> List[int]: ...
+    def get_stored_qidx(self) -> List[int]: ...
+    def get_pshape(self) -> List[int]: ...
+    def get_pstride(self) -> List[int]: ...
+    def get_data_shape(self) -> List[int]: ...
+    def get_padding(self) -> List[int]: ...
+    def get_num_patches(self) -> List[int]: ...
+
+class LocalShuffle:
+    def __init__(
+        self,
+        session: Union[
+            PatcherSessionDouble, PatcherSessionFloat, PatcherSessionInt, PatcherSessionLong
+        ],
+        seed: int,
+        partition_size: int = 64,
+        window: int = 8,
+    ) -> None: ...
+    def get_epoch(self, epoch: int, worker: int = 0, num_workers: int = 1) -> ndarray: ...
+    def bytes_seeked(self, pnums: Sequence[int]) -> int: ...
+    def expected_bytes_seeked(self, num_epochs: int = 4) -> float: ...
+    def __len__(self) -> int: ...
+    def get_partition_size(self) -> int: ...
+    def get_window(self) -> int: ...
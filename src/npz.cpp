@@ -0,0 +1,295 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <sys/stat.h>  // stat
+
+#include <algorithm>      // std::min
+#include <cstdint>        // uint16_t, uint32_t, uint64_t
+#include <fstream>        // std::ifstream
+#include <map>            // std::map
+#include <memory>         // std::shared_ptr
+#include <mutex>          // std::mutex, std::lock_guard
+#include <sstream>        // std::ostringstream
+#include <stdexcept>      // std::runtime_error
+#include <tuple>          // std::tie
+#include <unordered_map>  // std::unordered_map
+#include <utility>        // std::move
+#include <vector>         // std::vector
+
+#include "src/file_stamp.hpp"
+#include "src/le_bytes.hpp"
+#include "src/npz.hpp"
+
+
+namespace npz {
+
+namespace {
+
+constexpr uint32_t local_signature = 0x04034b50;
+constexpr uint32_t central_signature = 0x02014b50;
+constexpr uint32_t end_signature = 0x06054b50;
+constexpr uint32_t zip64_end_signature = 0x06064b50;
+constexpr uint32_t zip64_locator_signature = 0x07064b50;
+constexpr uint16_t zip64_extra_id = 0x0001;
+constexpr uint16_t stored_method = 0;
+constexpr size_t local_header_size = 30;
+constexpr size_t central_header_size = 46;
+constexpr size_t end_size = 22;
+constexpr size_t zip64_locator_size = 20;
+constexpr size_t zip64_end_size = 56;
+constexpr size_t max_comment_size = 65535;
+
+// Maximum number of archives with a cached central directory
+constexpr size_t max_archives = 64;
+
+// Identifies an archive, such that a replaced or modified archive is scanned again
+struct Key {
+    std::string path;
+    file_stamp::Stamp stamp;
+
+    bool operator<(const Key& other) const {
+        return std::tie(path, stamp) < std::tie(other.path, other.stamp);
+    }
+};
+
+// Central directory entry of a member
+struct Member {
+    uint16_t method, flags;
+    uint64_t local_offset;
+    uint64_t data_offset = 0;  // resolved from the local header on first use
+};
+
+struct Directory {
+    std::mutex mutex;
+    std::unordered_map<std::string, Member> members;
+};
+
+struct Cache {
+    std::mutex mutex;
+    std::map<Key, std::shared_ptr<Directory>> archives;
+};
+
+
+Cache& get_cache() {
+    static Cache cache;
+    return cache;
+}
+
+
+std::vector<char> read_at(std::ifstream& stream, const std::string& path, uint64_t offset,
+                          size_t length) {
+    std::vector<char> buf(length);
+    stream.seekg(static_cast<std::streamoff>(offset));
+    stream.read(buf.data(), static_cast<std::streamsize>(length));
+    if (!stream) {
+        throw std::runtime_error("IO Error: failed to read zip archive " + path);
+    }
+    return buf;
+}
+
+
+/**
+ * @brief Reads the central directory of a zip archive, following the zip64 end of central
+ *      directory record when the archive has too many members, or is too large, for the
+ *      standard record.
+ *
+ * @param path Archive filepath
+ * @param file_size Archive size in bytes
+ * @return std::shared_ptr<Directory> Members of the archive by name
+ */
+std::shared_ptr<Directory> read_directory(const std::string& path, uint64_t file_size) {
+    std::ifstream stream(path, std::ifstream::binary);
+    if (!stream) {
+        throw std::runtime_error("IO Error: failed to open " + path);
+    }
+    if (file_size < end_size) {
+        throw std::runtime_error("Not a zip archive: " + path);
+    }
+
+    // End of central directory record is followed by a comment of up to 64 KiB
+    const uint64_t tail_size = std::min<uint64_t>(file_size, end_size + max_comment_size);
+    const uint64_t tail_offset = file_size - tail_size;
+    std::vector<char> tail = read_at(stream, path, tail_offset, tail_size);
+    size_t end = tail_size - end_size + 1;
+    do {
+        end--;
+    } while ((end > 0) && (le_bytes::load(&tail[end], 4) != end_signature));
+    if (le_bytes::load(&tail[end], 4) != end_signature) {
+        throw std::runtime_error("Not a zip archive, end of central directory not found: " + path);
+    }
+    uint64_t num_entries = le_bytes::load(&tail[end + 10], 2);
+    uint64_t directory_size = le_bytes::load(&tail[end + 12], 4);
+    uint64_t directory_offset = le_bytes::load(&tail[end + 16], 4);
+
+    if ((num_entries == 0xFFFF) || (directory_size == 0xFFFFFFFF) ||
+        (directory_offset == 0xFFFFFFFF)) {
+        const uint64_t locator_offset = tail_offset + end - zip64_locator_size;
+        std::vector<char> locator = read_at(stream, path, locator_offset, zip64_locator_size);
+        if (le_bytes::load(locator.data(), 4) != zip64_locator_signature) {
+            throw std::runtime_error("Zip64 end of central directory not found: " + path);
+        }
+        std::vector<char> record =
+            read_at(stream, path, le_bytes::load(&locator[8], 8), zip64_end_size);
+        if (le_bytes::load(record.data(), 4) != zip64_end_signature) {
+            throw std::runtime_error("Zip64 end of central directory not found: " + path);
+        }
+        num_entries = le_bytes::load(&record[32], 8);
+        directory_size = le_bytes::load(&record[40], 8);
+        directory_offset = le_bytes::load(&record[48], 8);
+    }
+
+    // Scan the directory once, keeping the offset of each member's local header
+    std::vector<char> dir = read_at(stream, path, directory_offset, directory_size);
+    auto directory = std::make_shared<Directory>();
+    size_t pos = 0;
+    for (uint64_t i = 0; i < num_entries; i++) {
+        if ((pos + central_header_size > dir.size()) ||
+            (le_bytes::load(&dir[pos], 4) != central_signature)) {
+            throw std::runtime_error("Zip archive central directory is corrupt: " + path);
+        }
+        const size_t name_length = le_bytes::load(&dir[pos + 28], 2);
+        const size_t extra_length = le_bytes::load(&dir[pos + 30], 2);
+        const size_t comment_length = le_bytes::load(&dir[pos + 32], 2);
+        const size_t next = pos + central_header_size + name_length + extra_length +
+                            comment_length;
+        if (next > dir.size()) {
+            throw std::runtime_error("Zip archive central directory is corrupt: " + path);
+        }
+        Member member;
+        member.flags = static_cast<uint16_t>(le_bytes::load(&dir[pos + 8], 2));
+        member.method = static_cast<uint16_t>(le_bytes::load(&dir[pos + 10], 2));
+        member.local_offset = le_bytes::load(&dir[pos + 42], 4);
+
+        // Zip64 extra field holds, in order, only the sizes & offset that overflowed
+        if (member.local_offset == 0xFFFFFFFF) {
+            const uint64_t uncompressed = le_bytes::load(&dir[pos + 24], 4);
+            const uint64_t compressed = le_bytes::load(&dir[pos + 20], 4);
+            size_t extra = pos + central_header_size + name_length;
+            const size_t extra_end = extra + extra_length;
+            while (extra + 4 <= extra_end) {
+                const uint16_t id = static_cast<uint16_t>(le_bytes::load(&dir[extra], 2));
+                const size_t size = le_bytes::load(&dir[extra + 2], 2);
+                if (id == zip64_extra_id) {
+                    size_t field = extra + 4 + ((uncompressed == 0xFFFFFFFF) ? 8 : 0) +
+                                   ((compressed == 0xFFFFFFFF) ? 8 : 0);
+                    if (field + 8 > extra_end) {
+                        throw std::runtime_error("Zip64 extra field is corrupt: " + path);
+                    }
+                    member.local_offset = le_bytes::load(&dir[field], 8);
+                    break;
+                }
+                extra += 4 + size;
+            }
+        }
+        std::string name(&dir[pos + central_header_size], name_length);
+        directory->members.emplace(std::move(name), member);
+        pos = next;
+    }
+    return directory;
+}
+
+
+/**
+ * @brief Gets the central directory of an archive, scanning it only if not already cached
+ */
+std::shared_ptr<Directory> get_directory(const std::string& path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        throw std::runtime_error("IO Error: failed to stat " + path);
+    }
+    Key key{path, file_stamp::from_stat(st)};
+
+    Cache& cache = get_cache();
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.archives.find(key);
+        if (it != cache.archives.end()) {
+            return it->second;
+        }
+    }
+    std::shared_ptr<Directory> directory = read_directory(path, st.st_size);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.archives.size() >= max_archives) {
+        cache.archives.erase(cache.archives.begin());
+    }
+    cache.archives.emplace(key, directory);
+    return directory;
+}
+
+
+bool is_regular_file(const std::string& path) {
+    struct stat st;
+    return (::stat(path.c_str(), &st) == 0) && S_ISREG(st.st_mode);
+}
+
+}  // namespace
+
+
+/**
+ * @brief Resolves a filepath into the file holding the npy data. Paths of the form
+ *      archive.npz/member refer to a member of an npz archive, e.g. data.npz/arr_0, other paths
+ *      refer to an npy file.
+ *
+ * @param path Filepath of an npy file, or of an npz archive member
+ * @return Location File to read, and the offset of the npy file within it
+ */
+Location resolve(const std::string& path) {
+    const std::string suffix = ".npz/";
+    size_t pos = path.find(suffix);
+    while (pos != std::string::npos) {
+        std::string archive = path.substr(0, pos + suffix.size() - 1);
+        if (is_regular_file(archive)) {
+            return {archive, find_member(archive, path.substr(pos + suffix.size()))};
+        }
+        pos = path.find(suffix, pos + 1);
+    }
+    return {path, 0};
+}
+
+
+/**
+ * @brief Finds the offset of a member within an npz archive. The central directory is scanned
+ *      once per archive, after which each member is found with a hash lookup, and one read of
+ *      its local header, as the local extra field may differ from the central one.
+ *
+ * @param archive Filepath of the npz archive
+ * @param name Member name, the .npy extension may be omitted
+ * @return size_t Byte offset of the member data within the archive
+ */
+size_t find_member(const std::string& archive, const std::string& name) {
+    std::shared_ptr<Directory> directory = get_directory(archive);
+    std::lock_guard<std::mutex> lock(directory->mutex);
+    auto it = directory->members.find(name);
+    if (it == directory->members.end()) {
+        it = directory->members.find(name + ".npy");
+    }
+    if (it == directory->members.end()) {
+        throw std::runtime_error("Member " + name + " not found in " + archive);
+    }
+    Member& member = it->second;
+    if (member.method != stored_method) {
+        std::ostringstream oss;
+        oss << "Member " << it->first << " of " << archive << " is compressed (method "
+            << member.method << "), only stored members can be read. Save with np.savez "
+            << "rather than np.savez_compressed.";
+        throw std::runtime_error(oss.str());
+    }
+    if ((member.flags & 0x1) != 0) {
+        throw std::runtime_error("Member " + it->first + " of " + archive + " is encrypted.");
+    }
+    if (member.data_offset == 0) {
+        std::ifstream stream(archive, std::ifstream::binary);
+        std::vector<char> header = read_at(stream, archive, member.local_offset,
+                                           local_header_size);
+        if (le_bytes::load(header.data(), 4) != local_signature) {
+            throw std::runtime_error("Zip archive local header is corrupt: " + archive);
+        }
+        member.data_offset = member.local_offset + local_header_size +
+                             le_bytes::load(&header[26], 2) + le_bytes::load(&header[28], 2);
+    }
+    return member.data_offset;
+}
+
+
+}  // namespace npz
@@ -0,0 +1,24 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef NPZ_HPP_
+#define NPZ_HPP_
+
+#include <cstddef>  // size_t
+#include <string>   // std::string
+
+namespace npz {
+
+// File holding the npy data, and the byte offset of the npy file within it
+struct Location {
+    std::string path;
+    size_t offset;
+};
+
+Location resolve(const std::string &);
+size_t find_member(const std::string &, const std::string &);
+
+}  // namespace npz
+
+#endif  // NPZ_HPP_
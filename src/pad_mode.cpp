@@ -0,0 +1,62 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>  // std::min, std::max
+#include <stdexcept>  // std::runtime_error
+
+#include "src/pad_mode.hpp"
+
+
+namespace pad_mode {
+
+namespace {
+
+/**
+ * @brief Gets the non-negative remainder of index divided by period
+ */
+size_t wrap_index(std::ptrdiff_t index, size_t period) {
+    std::ptrdiff_t out = index % static_cast<std::ptrdiff_t>(period);
+    return static_cast<size_t>((out < 0) ? out + static_cast<std::ptrdiff_t>(period) : out);
+}
+
+}  // namespace
+
+
+/**
+ * @brief Gets the index within the data that a padded index is copied from. Reflections
+ *      continue periodically for padding wider than the data, which matches np.pad whenever
+ *      the padding is no wider than the data, or is equal either side.
+ *
+ * @param mode Padding mode, other than constant
+ * @param index Index along a dimension, negative before the data, >= size after it
+ * @param size Size of the dimension
+ * @return size_t Index within [0, size)
+ */
+size_t source_index(Mode mode, std::ptrdiff_t index, size_t size) {
+    switch (mode) {
+        case Mode::edge: {
+            const std::ptrdiff_t last = static_cast<std::ptrdiff_t>(size) - 1;
+            return static_cast<size_t>(std::min(std::max(index, std::ptrdiff_t(0)), last));
+        }
+        case Mode::reflect: {
+            // Edge is not repeated, period of 2 * (size - 1)
+            if (size == 1) {
+                return 0;
+            }
+            size_t i = wrap_index(index, 2 * (size - 1));
+            return (i < size) ? i : (2 * (size - 1)) - i;
+        }
+        case Mode::symmetric: {
+            // Edge is repeated, period of 2 * size
+            size_t i = wrap_index(index, 2 * size);
+            return (i < size) ? i : (2 * size) - 1 - i;
+        }
+        case Mode::wrap:
+            return wrap_index(index, size);
+        default:
+            throw std::runtime_error("Constant padding has no source index.");
+    }
+}
+
+}  // namespace pad_mode
@@ -0,0 +1,19 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef PAD_MODE_HPP_
+#define PAD_MODE_HPP_
+
+#include <cstddef>  // size_t, std::ptrdiff_t
+
+namespace pad_mode {
+
+// How padded regions are filled, matching the modes of np.pad
+enum class Mode { constant, edge, reflect, symmetric, wrap };
+
+size_t source_index(Mode, std::ptrdiff_t, size_t);
+
+}  // namespace pad_mode
+
+#endif  // PAD_MODE_HPP_
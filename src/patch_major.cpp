@@ -0,0 +1,173 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <sys/stat.h>  // stat
+
+#include <cstdint>    // uint64_t
+#include <cstring>    // std::memcmp, std::memcpy
+#include <sstream>    // std::ostringstream
+#include <stdexcept>  // std::runtime_error
+
+#include "src/le_bytes.hpp"
+#include "src/patch_major.hpp"
+
+
+namespace patch_major {
+
+namespace {
+
+// Layout of the fixed size start of the header, followed by the data shape, qspace indices,
+// patch shape, patch stride, padding and number of patches, each as a count and then values,
+// all as 8 byte little endian integers. Patch data starts at an aligned offset after these.
+constexpr char magic[] = "NPYPATCH";
+constexpr size_t magic_length = 8;
+constexpr uint64_t version = 1;
+constexpr size_t prefix_size = 32;
+constexpr size_t data_alignment = 64;
+constexpr size_t num_arrays = 6;
+constexpr size_t max_array_length = 1 << 16;
+
+
+std::vector<std::vector<size_t>*> get_arrays(Header& header) {
+    return {&header.data_shape, &header.qidx,    &header.pshape,
+            &header.pstride,    &header.padding, &header.num_patches};
+}
+
+}  // namespace
+
+
+/**
+ * @brief Encodes the header of a patch-major file, padded to the start of the patch data.
+ *      Sets the data offset of the header.
+ *
+ * @param header Header to encode
+ * @return std::vector<char> Encoded header
+ */
+std::vector<char> encode_header(Header& header) {
+    size_t size = prefix_size;
+    for (const std::vector<size_t>* array : get_arrays(header)) {
+        size += (array->size() + 1) * 8;
+    }
+    header.data_offset = ((size + data_alignment - 1) / data_alignment) * data_alignment;
+
+    std::vector<char> out(header.data_offset, 0);
+    std::memcpy(out.data(), magic, magic_length);
+    le_bytes::store(&out[8], version, 4);
+    out[12] = header.kind;
+    out[13] = header.byteorder;
+    le_bytes::store(&out[16], header.itemsize, 8);
+    le_bytes::store(&out[24], header.data_offset, 8);
+    size_t pos = prefix_size;
+    for (const std::vector<size_t>* array : get_arrays(header)) {
+        le_bytes::store(&out[pos], array->size(), 8);
+        pos += 8;
+        for (size_t value : *array) {
+            le_bytes::store(&out[pos], value, 8);
+            pos += 8;
+        }
+    }
+    return out;
+}
+
+
+/**
+ * @brief Reads and validates the header of a patch-major file, including that the file holds
+ *      every patch.
+ *
+ * @param file Reader of the file
+ * @param path Filepath, used to stat the file & in error messages
+ * @return Header Header of the file
+ */
+Header read_header(reader::Reader& file, const std::string& path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        throw std::runtime_error("IO Error: failed to stat " + path);
+    }
+    const uint64_t file_size = static_cast<uint64_t>(st.st_size);
+
+    char prefix[prefix_size];
+    if (file_size < prefix_size) {
+        throw std::runtime_error("Not a patch-major file: " + path);
+    }
+    file.read(prefix, 0, prefix_size);
+    if (std::memcmp(prefix, magic, magic_length) != 0) {
+        throw std::runtime_error("Not a patch-major file: " + path);
+    }
+    if (le_bytes::load(&prefix[8], 4) != version) {
+        std::ostringstream oss;
+        oss << "Patch-major version " << le_bytes::load(&prefix[8], 4)
+            << " is not supported: " << path;
+        throw std::runtime_error(oss.str());
+    }
+    Header header;
+    header.kind = prefix[12];
+    header.byteorder = prefix[13];
+    header.itemsize = le_bytes::load(&prefix[16], 8);
+    header.data_offset = le_bytes::load(&prefix[24], 8);
+    const size_t max_offset = prefix_size + (num_arrays * (max_array_length + 1) * 8) +
+                              data_alignment;
+    if ((header.itemsize == 0) || (header.data_offset > file_size) ||
+        (header.data_offset < prefix_size) || (header.data_offset > max_offset)) {
+        throw std::runtime_error("Patch-major header is corrupt: " + path);
+    }
+
+    std::vector<char> buf(header.data_offset - prefix_size);
+    file.read(buf.data(), prefix_size, buf.size());
+    size_t pos = 0;
+    for (std::vector<size_t>* array : get_arrays(header)) {
+        if (pos + 8 > buf.size()) {
+            throw std::runtime_error("Patch-major header is corrupt: " + path);
+        }
+        const size_t length = le_bytes::load(&buf[pos], 8);
+        pos += 8;
+        if ((length > max_array_length) || (length * 8 > buf.size() - pos)) {
+            throw std::runtime_error("Patch-major header is corrupt: " + path);
+        }
+        array->resize(length);
+        for (size_t& value : *array) {
+            value = le_bytes::load(&buf[pos], 8);
+            pos += 8;
+        }
+    }
+    const size_t ndim = header.pshape.size();
+    if ((ndim == 0) || header.qidx.empty() || (header.data_shape.size() != ndim + 1) ||
+        (header.pstride.size() != ndim) || (header.padding.size() != 2 * ndim) ||
+        (header.num_patches.size() != ndim)) {
+        throw std::runtime_error("Patch-major header is corrupt: " + path);
+    }
+    const uint64_t patch_bytes = get_channel_size(header) * header.qidx.size() * header.itemsize;
+    if (patch_bytes == 0) {
+        throw std::runtime_error("Patch-major header is corrupt: " + path);
+    }
+    if ((file_size - header.data_offset) / patch_bytes < get_num_patches(header)) {
+        throw std::runtime_error("Patch-major file is truncated: " + path);
+    }
+    return header;
+}
+
+
+/**
+ * @brief Gets the number of elements of one qspace index of a patch
+ */
+size_t get_channel_size(const Header& header) {
+    size_t size = 1;
+    for (size_t length : header.pshape) {
+        size *= length;
+    }
+    return size;
+}
+
+
+/**
+ * @brief Gets the number of patches stored in the file
+ */
+size_t get_num_patches(const Header& header) {
+    size_t num = 1;
+    for (size_t length : header.num_patches) {
+        num *= length;
+    }
+    return num;
+}
+
+}  // namespace patch_major
@@ -0,0 +1,373 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef PATCH_MAJOR_HPP_
+#define PATCH_MAJOR_HPP_
+
+#include <algorithm>  // std::find, std::max, std::min
+#include <cstddef>    // size_t
+#include <fstream>    // std::ofstream
+#include <memory>     // std::unique_ptr
+#include <mutex>      // std::mutex, std::lock_guard
+#include <numeric>    // std::iota
+#include <sstream>    // std::ostringstream
+#include <stdexcept>  // std::runtime_error
+#include <string>     // std::string
+#include <thread>     // std::thread
+#include <vector>     // std::vector
+
+#include "src/byte_swap.hpp"
+#include "src/npy_header.hpp"
+#include "src/reader.hpp"
+#include "src/session.hpp"
+#include "src/thread_pool.hpp"
+
+namespace patch_major {
+
+// Number of patches extracted per write during conversion
+constexpr size_t batch_size = 256;
+
+// Datatype & patch geometry of a patch-major file, in natural order. Patches are stored in patch
+// number order, each holding the channels of qidx one after another, already padded.
+struct Header {
+    char kind, byteorder;
+    size_t itemsize, data_offset;
+    std::vector<size_t> data_shape, qidx, pshape, pstride, padding, num_patches;
+};
+
+// Contiguous channels of a patch, read with one positional read
+struct Run {
+    size_t file_offset, out_offset, length;
+};
+
+std::vector<char> encode_header(Header &);
+Header read_header(reader::Reader &, const std::string &);
+size_t get_channel_size(const Header &);
+size_t get_num_patches(const Header &);
+
+/**
+ * @brief Writes every patch of a session into a patch-major file. The geometry, padding mode
+ *      and normalization of the session are applied once here, rather than on every read.
+ *
+ * @tparam T datatype of the patches
+ * @param session session to extract patches with
+ * @param fpath filepath of the patch-major file to write
+ * @param num_threads number of worker threads, 0 uses the number of hardware threads
+ */
+template <typename T>
+void convert(PatcherSession<T> &session, const std::string &fpath, size_t num_threads = 1) {
+    for (size_t offset : session.get_pnum_offset()) {
+        if (offset != 0) {
+            throw std::runtime_error("Patch-major files do not support a patch number offset.");
+        }
+    }
+    const npy_header::dtype_t &dtype = npy_header::has_typestring<T>::dtype;
+    Header header;
+    header.kind = dtype.kind;
+    header.byteorder = (dtype.itemsize == 1) ? npy_header::no_endian_char : dtype.byteorder;
+    header.itemsize = dtype.itemsize;
+    header.data_shape = session.get_data_shape();
+    header.qidx = session.get_qidx();
+    header.pshape = session.get_pshape();
+    header.pstride = session.get_pstride();
+    header.padding = session.get_padding();
+    header.num_patches = session.get_num_patches();
+    std::vector<char> prefix = encode_header(header);
+
+    std::ofstream out(fpath, std::ofstream::binary | std::ofstream::trunc);
+    if (!out) {
+        throw std::runtime_error("IO Error: failed to open " + fpath);
+    }
+    out.write(prefix.data(), static_cast<std::streamsize>(prefix.size()));
+    const size_t num_patches = get_num_patches(header);
+    const size_t patch_size = session.get_patch_size();
+    std::vector<T> patches(patch_size * std::min(batch_size, num_patches));
+    std::vector<size_t> pnums;
+    for (size_t start = 0; start < num_patches; start += batch_size) {
+        pnums.resize(std::min(batch_size, num_patches - start));
+        std::iota(pnums.begin(), pnums.end(), start);
+        session.get_patches_into(pnums, patches.data(), num_threads);
+        out.write(reinterpret_cast<const char *>(patches.data()),
+                  static_cast<std::streamsize>(pnums.size() * patch_size * sizeof(T)));
+    }
+    out.close();
+    if (!out) {
+        throw std::runtime_error("IO Error: failed to write " + fpath);
+    }
+}
+
+}  // namespace patch_major
+
+/**
+ * @brief Reads patches from a patch-major file. Each patch is stored contiguously and already
+ *      padded, such that reading a patch is one positional read straight into the output
+ *      buffer. A subset of the stored channels is read with one read per run of channels that
+ *      are consecutive within the file.
+ *
+ * @tparam T datatype of the patches, must match the datatype of the file
+ */
+template <typename T>
+class PatchMajorReader {
+  private:
+    const std::string fpath_arg;
+    const std::vector<size_t> qidx_arg;
+    reader::PreadReader file;
+    patch_major::Header header;
+    std::vector<size_t> qidx;
+    std::vector<patch_major::Run> runs;
+    size_t patch_size, patch_bytes, num_patches, swap_size = 0;
+    std::mutex pool_mutex;
+    std::unique_ptr<ThreadPool> pool;
+    void check_pnum(size_t) const;
+
+  public:
+    PatchMajorReader(const std::string &, const std::vector<size_t> & = {});
+    std::vector<T> get_patch(size_t);
+    void get_patch_into(size_t, T *);
+    std::vector<T> get_patches(const std::vector<size_t> &, size_t = 1);
+    void get_patches_into(const std::vector<size_t> &, T *, size_t = 1);
+    size_t get_patch_offset(size_t) const;
+    size_t get_patch_size() const;
+    size_t get_num_reads() const;
+    const std::string &get_filepath() const;
+    const std::vector<size_t> &get_qidx_arg() const;
+    const std::vector<size_t> &get_qidx() const;
+    const std::vector<size_t> &get_stored_qidx() const;
+    const std::vector<size_t> &get_pshape() const;
+    const std::vector<size_t> &get_pstride() const;
+    const std::vector<size_t> &get_padding() const;
+    const std::vector<size_t> &get_data_shape() const;
+    const std::vector<size_t> &get_num_patches() const;
+};
+
+/**
+ * @brief Construct a new PatchMajorReader object, reads the header and plans the reads of the
+ *      requested channels.
+ *
+ * @tparam T datatype of the patches, must match the datatype of the file
+ * @param fpath filepath of the patch-major file
+ * @param qidx_subset qspace indices to read, each stored in the file, empty for all
+ */
+template <typename T>
+PatchMajorReader<T>::PatchMajorReader(const std::string &fpath,
+                                      const std::vector<size_t> &qidx_subset)
+    : fpath_arg(fpath), qidx_arg(qidx_subset), file(fpath) {
+    header = patch_major::read_header(file, fpath);
+    const npy_header::dtype_t &dtype = npy_header::has_typestring<T>::dtype;
+    if ((header.kind != dtype.kind) || (header.itemsize != dtype.itemsize)) {
+        throw std::runtime_error("Type mismatch between class and file.");
+    }
+    if ((header.byteorder != npy_header::no_endian_char) &&
+        (header.byteorder != npy_header::host_endian_char) && (header.itemsize > 1)) {
+        swap_size = (header.kind == 'c') ? header.itemsize / 2 : header.itemsize;
+        if (!byte_swap::is_supported(swap_size)) {
+            throw std::runtime_error("Byte swapping is not supported for the type in file.");
+        }
+    }
+
+    // Position of each requested channel within a stored patch, merged into runs
+    qidx = qidx_subset.empty() ? header.qidx : qidx_subset;
+    const size_t channel_bytes = patch_major::get_channel_size(header) * sizeof(T);
+    for (size_t i = 0; i < qidx.size(); i++) {
+        auto it = std::find(header.qidx.begin(), header.qidx.end(), qidx[i]);
+        if (it == header.qidx.end()) {
+            std::ostringstream oss;
+            oss << "qspace index " << qidx[i] << " is not stored in " << fpath << ".";
+            throw std::runtime_error(oss.str());
+        }
+        const size_t file_offset = static_cast<size_t>(it - header.qidx.begin()) * channel_bytes;
+        if (!runs.empty() &&
+            (runs.back().file_offset + runs.back().length == file_offset)) {
+            runs.back().length += channel_bytes;
+        } else {
+            runs.push_back({file_offset, i * channel_bytes, channel_bytes});
+        }
+    }
+    patch_size = patch_major::get_channel_size(header) * qidx.size();
+    patch_bytes = patch_major::get_channel_size(header) * header.qidx.size() * sizeof(T);
+    num_patches = patch_major::get_num_patches(header);
+}
+
+template <typename T>
+void PatchMajorReader<T>::check_pnum(size_t pnum) const {
+    if (pnum >= num_patches) {
+        std::ostringstream oss;
+        oss << "Max patch index: " << num_patches - 1 << ", " << pnum << " given.";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+/**
+ * @brief Reads a patch.
+ *
+ * @tparam T datatype of the patches
+ * @param pnum patch number
+ * @return std::vector<T> Patch data
+ */
+template <typename T>
+std::vector<T> PatchMajorReader<T>::get_patch(size_t pnum) {
+    std::vector<T> patch(patch_size);
+    get_patch_into(pnum, patch.data());
+    return patch;
+}
+
+/**
+ * @brief Reads a patch into an output buffer, one positional read per run of channels. Safe to
+ *      call from multiple threads.
+ *
+ * @tparam T datatype of the patches
+ * @param pnum patch number
+ * @param out output buffer, must hold get_patch_size() elements
+ */
+template <typename T>
+void PatchMajorReader<T>::get_patch_into(size_t pnum, T *out) {
+    check_pnum(pnum);
+    char *buf = reinterpret_cast<char *>(out);
+    const size_t start = get_patch_offset(pnum);
+    for (const patch_major::Run &run : runs) {
+        file.read(buf + run.out_offset, start + run.file_offset, run.length);
+    }
+    if (swap_size != 0) {
+        byte_swap::swap_in_place(buf, patch_size * sizeof(T), swap_size);
+    }
+}
+
+/**
+ * @brief Reads a batch of patches.
+ *
+ * @tparam T datatype of the patches
+ * @param pnums patch numbers
+ * @param num_threads number of worker threads, 0 uses the number of hardware threads
+ * @return std::vector<T> Patch data, contiguous patches in order of pnums
+ */
+template <typename T>
+std::vector<T> PatchMajorReader<T>::get_patches(const std::vector<size_t> &pnums,
+                                                size_t num_threads) {
+    std::vector<T> patches(patch_size * pnums.size());
+    get_patches_into(pnums, patches.data(), num_threads);
+    return patches;
+}
+
+/**
+ * @brief Reads a batch of patches into an output buffer. When every stored channel is read,
+ *      consecutive patch numbers are contiguous in the file and are read together, such that a
+ *      sweep over the grid is one read per batch.
+ *
+ * @tparam T datatype of the patches
+ * @param pnums patch numbers
+ * @param out output buffer, must hold pnums.size() * get_patch_size() elements
+ * @param num_threads number of worker threads, 0 uses the number of hardware threads
+ */
+template <typename T>
+void PatchMajorReader<T>::get_patches_into(const std::vector<size_t> &pnums, T *out,
+                                           size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    if ((num_threads > 1) && (pnums.size() > 1)) {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (!pool || (pool->size() != num_threads)) {
+            pool = std::make_unique<ThreadPool>(num_threads);
+        }
+        pool->parallel_for(pnums.size(), [&](size_t, size_t i) {
+            get_patch_into(pnums[i], out + (i * patch_size));
+        });
+        return;
+    }
+    const bool whole = (runs.size() == 1) && (runs[0].length == patch_bytes);
+    size_t i = 0;
+    while (i < pnums.size()) {
+        size_t count = 1;
+        while (whole && (i + count < pnums.size()) && (pnums[i + count] == pnums[i] + count)) {
+            count++;
+        }
+        if (count == 1) {
+            get_patch_into(pnums[i], out + (i * patch_size));
+        } else {
+            check_pnum(pnums[i] + count - 1);
+            char *buf = reinterpret_cast<char *>(out + (i * patch_size));
+            file.read(buf, get_patch_offset(pnums[i]), count * patch_bytes);
+            if (swap_size != 0) {
+                byte_swap::swap_in_place(buf, count * patch_bytes, swap_size);
+            }
+        }
+        i += count;
+    }
+}
+
+/**
+ * @brief Gets the file offset of a patch
+ *
+ * @tparam T datatype of the patches
+ * @param pnum patch number
+ * @return size_t Byte offset within the file
+ */
+template <typename T>
+size_t PatchMajorReader<T>::get_patch_offset(size_t pnum) const {
+    return header.data_offset + (pnum * patch_bytes);
+}
+
+template <typename T>
+size_t PatchMajorReader<T>::get_patch_size() const {
+    return patch_size;
+}
+
+/**
+ * @brief Gets the number of positional reads per patch, 1 unless the requested channels are
+ *      not consecutive within the file
+ *
+ * @tparam T datatype of the patches
+ * @return size_t Number of reads
+ */
+template <typename T>
+size_t PatchMajorReader<T>::get_num_reads() const {
+    return runs.size();
+}
+
+template <typename T>
+const std::string &PatchMajorReader<T>::get_filepath() const {
+    return fpath_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &PatchMajorReader<T>::get_qidx_arg() const {
+    return qidx_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &PatchMajorReader<T>::get_qidx() const {
+    return qidx;
+}
+
+template <typename T>
+const std::vector<size_t> &PatchMajorReader<T>::get_stored_qidx() const {
+    return header.qidx;
+}
+
+template <typename T>
+const std::vector<size_t> &PatchMajorReader<T>::get_pshape() const {
+    return header.pshape;
+}
+
+template <typename T>
+const std::vector<size_t> &PatchMajorReader<T>::get_pstride() const {
+    return header.pstride;
+}
+
+template <typename T>
+const std::vector<size_t> &PatchMajorReader<T>::get_padding() const {
+    return header.padding;
+}
+
+template <typename T>
+const std::vector<size_t> &PatchMajorReader<T>::get_data_shape() const {
+    return header.data_shape;
+}
+
+template <typename T>
+const std::vector<size_t> &PatchMajorReader<T>::get_num_patches() const {
+    return header.num_patches;
+}
+
+#endif  // PATCH_MAJOR_HPP_
@@ -5,18 +5,30 @@
 #ifndef PATCHER_HPP_
 #define PATCHER_HPP_
 
-#include <fstream>  // std::ifstream
-#include <sstream>  // std::ostringstream
-#include <string>   // std::string
-#include <vector>   // std::vector
+#include <algorithm>      // std::reverse, std::sort, std::max, std::min_element, std::all_of
+#include <cstddef>        // std::ptrdiff_t
+#include <cstring>        // std::memset, std::memcpy
+#include <fstream>        // std::ifstream
+#include <memory>         // std::unique_ptr
+#include <mutex>          // std::unique_lock
+#include <shared_mutex>   // std::shared_mutex, std::shared_lock
+#include <sstream>        // std::ostringstream
+#include <string>         // std::string
+#include <type_traits>    // std::is_floating_point
+#include <unordered_map>  // std::unordered_map
+#include <utility>        // std::pair
+#include <vector>         // std::vector
 
+#include "src/byte_swap.hpp"
+#include "src/convert.hpp"
+#include "src/header_cache.hpp"
+#include "src/normalize.hpp"
 #include "src/npy_header.hpp"
-
-// TODO(m-lyon): Move to stateful reading of object, i.e. initialise with filepath & patch_shape.
-//                 then call get_patch with qspace_index & patch_num.
-//               Will need to ensure deconstructor closes the file.
-//               Should make filepath & patch_shape constants to ensure object is not
-//                 reused for different file.
+#include "src/npz.hpp"
+#include "src/pad_mode.hpp"
+#include "src/read_plan.hpp"
+#include "src/reader.hpp"
+#include "src/transpose.hpp"
 
 // TODO(m-lyon): Remove after debug
 template <typename T>
@@ -32,6 +44,18 @@ void print_vector(const std::vector<T> &data) {
     std::cout << data[data.size() - 1] << ")" << std::endl;
 }
 
+/**
+ * @brief Per patch read state. Kept separate from the patch geometry, such that
+ *      multiple patches can be read concurrently with the same geometry.
+ */
+struct ReadState {
+    std::vector<size_t> patch_num, shifts;
+    size_t start, pos, dest;
+    reader::Reader *reader;
+    read_plan::ReadPlan plan;
+    std::vector<char> scratch, box;
+};
+
 /**
  * @brief Patcher object
  *
@@ -39,40 +63,75 @@ void print_vector(const std::vector<T> &data) {
  */
 template <typename T>
 class Patcher {
-  private:
-    std::string filepath;
+  protected:
+    std::string filepath, data_path;
     std::ifstream stream;
+    std::unique_ptr<reader::Reader> reader;
     std::vector<T> patch;
-    std::vector<size_t> data_shape, qspace_index, patch_shape, patch_stride, patch_num;
-    std::vector<size_t> num_patches, padding, data_strides, patch_byte_strides, shifts;
+    std::vector<size_t> data_shape, qspace_index, patch_shape, patch_stride;
+    std::vector<size_t> num_patches, padding, data_strides, patch_byte_strides;
     std::vector<size_t> extra_padding;
-    std::vector<size_t> patch_num_offset;
-    size_t patch_size, start, pos;
-    bool has_run = false;
-    char *buf;
+    std::vector<size_t> patch_num_offset, patch_num_strides;
+    std::vector<size_t> qspace_columns;
+    size_t patch_size, data_offset, max_patch_num, qspace_min, qspace_span, swap_size = 0;
+    size_t file_size = sizeof(T);
+    convert::Kernel converter = nullptr;
+    std::unique_ptr<normalize::Normalizer> normalizer;
+    pad_mode::Mode padding_mode = pad_mode::Mode::constant;
+    double padding_value = 0;
+    std::vector<char> fill_bytes;
+    bool has_run = false, fortran_order = false;
+    ReadState state;
+    mutable std::shared_mutex plans_mutex;
+    mutable std::unordered_map<size_t, read_plan::ReadPlan> plans;
     void set_init_vars(const std::string &, const std::vector<size_t> &,
                        const std::vector<size_t> &, const std::vector<size_t> &,
                        const std::vector<size_t> &, const std::vector<size_t> &);
     void set_runtime_vars(size_t);
-    void set_patch_numbers(size_t);
+    void set_geometry();
+    void set_patch_numbers(size_t, ReadState &) const;
     void set_patch_size();
     void open_file();
+    void open_reader(reader::ReadMode);
     void set_padding();
     void set_strides();
-    void set_shift_lengths();
+    void set_shift_lengths(ReadState &) const;
     void set_num_of_patches();
-    void move_stream_to_start();
-    void read_patch();
-    void read_nd_slice(const unsigned int);
-    void read_slice();
+    void move_stream_to_start(ReadState &) const;
+    void plan_patch(ReadState &) const;
+    size_t get_patch_class(const ReadState &) const;
+    const read_plan::ReadPlan &get_read_plan(ReadState &) const;
+    void read_patch(ReadState &, char *) const;
+    void extract_patch(size_t, T *, reader::Reader *, ReadState &) const;
+    void extract_patches(const std::vector<size_t> &, T *, reader::Reader *, ReadState &) const;
+    void advise_patches(const std::vector<size_t> &, reader::Reader *, ReadState &) const;
+    void plan_nd_slice(ReadState &, const unsigned int) const;
+    void plan_slice(ReadState &) const;
+    void plan_fortran_box(ReadState &, size_t, size_t) const;
+    size_t get_source_offset(const ReadState &, size_t, size_t) const;
+    size_t get_box_count(const ReadState &, size_t) const;
+    read_plan::Transform get_transform() const;
+    void set_fill_bytes();
+    void transpose_box(ReadState &, char *) const;
     void set_extra_padding();
     void set_patch_num_offset();
     void sanity_check();
+    void set_normalization(const std::vector<double> &, const std::vector<double> &, double,
+                           double, double);
+    void clear_normalization();
+    const normalize::Normalizer *get_normalizer() const;
+    void set_padding_mode(pad_mode::Mode, double);
+    pad_mode::Mode get_padding_mode() const;
+    double get_padding_value() const;
 
   public:
     Patcher();
     std::vector<T> get_patch(const std::string &, const std::vector<size_t> &, std::vector<size_t>,
                              std::vector<size_t>, size_t, std::vector<size_t>, std::vector<size_t>);
+    std::vector<T> get_patches(const std::string &, const std::vector<size_t> &,
+                               std::vector<size_t>, std::vector<size_t>,
+                               const std::vector<size_t> &, std::vector<size_t>,
+                               std::vector<size_t>);
     void debug_vars(const std::string &, const std::vector<size_t> &, std::vector<size_t>,
                     std::vector<size_t>, size_t, std::vector<size_t>, std::vector<size_t>);
     size_t get_patch_size();
@@ -123,34 +182,75 @@ void Patcher<T>::set_init_vars(const std::string &fpath, const std::vector<size_
 }
 
 /**
- * @brief Opens npy file ready for data extraction. Reads and parses header.
+ * @brief Opens npy file ready for data extraction. The header is read and parsed only if
+ *      it is not found within the process wide header cache. Members of npz archives, given
+ *      as archive.npz/member, are read in place from the archive.
  *
  * @tparam T datatype of data found within filepath
  */
 template <typename T>
 void Patcher<T>::open_file() {
-    // Open file
-    stream.open(filepath, std::ifstream::binary);
+    // Open file, or the archive holding it
+    npz::Location location = npz::resolve(filepath);
+    data_path = location.path;
+    stream.open(data_path, std::ifstream::binary);
+    if (!stream) {
+        throw std::runtime_error("IO Error: failed to open " + filepath);
+    }
 
-    // Read and parse header
-    std::string header_s = npy_header::read_header(stream);
-    start = stream.tellg();
-    npy_header::header_t header = npy_header::parse_header(header_s);
+    // Read and parse header, or get from cache
+    header_cache::Entry entry = header_cache::get_header(data_path, stream, location.offset);
+    const npy_header::header_t &header = entry.header;
+    data_offset = entry.data_offset;
+    state.start = data_offset;
     data_shape = header.shape;
     std::reverse(data_shape.begin(), data_shape.end());
 
     // Data validation
-    if (!stream) {
-        throw std::runtime_error("IO Error: failed to open " + filepath);
-    }
 
     static_assert(npy_header::has_typestring<T>::value, "Unrecognised datatype in file.");
-    if (header.dtype.tie() != npy_header::has_typestring<T>::dtype.tie()) {
-        throw std::runtime_error("Type mismatch between class and file.");
+    const npy_header::dtype_t &dtype = npy_header::has_typestring<T>::dtype;
+    file_size = header.dtype.itemsize;
+    converter = nullptr;
+    if ((header.dtype.kind != dtype.kind) || (header.dtype.itemsize != dtype.itemsize)) {
+        // Data is converted to T as it is read, complex data is never converted
+        if ((header.dtype.kind != 'c') && (dtype.kind != 'c')) {
+            converter = convert::get_kernel<T>(header.dtype.kind, header.dtype.itemsize);
+        }
+        if (converter == nullptr) {
+            throw std::runtime_error("Type mismatch between class and file.");
+        }
+    }
+
+    // Data in the opposite byte order is swapped as it is read, complex parts separately
+    swap_size = 0;
+    if ((header.dtype.byteorder != npy_header::no_endian_char) &&
+        (header.dtype.byteorder != npy_header::host_endian_char) && (file_size > 1)) {
+        swap_size = (header.dtype.kind == 'c') ? file_size / 2 : file_size;
+        if (!byte_swap::is_supported(swap_size)) {
+            throw std::runtime_error("Byte swapping is not supported for the type in file.");
+        }
     }
 
-    if (header.fortran_order) {
-        throw std::runtime_error("Fortran data order extraction not currently implemented.");
+    fortran_order = header.fortran_order;
+}
+
+/**
+ * @brief Opens the reader used to read patch data, must be called after open_file.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param mode Read backend
+ */
+template <typename T>
+void Patcher<T>::open_reader(reader::ReadMode mode) {
+    switch (mode) {
+        case reader::ReadMode::stream:
+            reader = std::make_unique<reader::StreamReader>(stream, data_path);
+            break;
+        default:
+            reader = reader::open_reader(data_path, mode);
+            stream.close();  // header has been read, reader holds its own descriptor
+            break;
     }
 }
 
@@ -319,20 +419,34 @@ size_t Patcher<T>::get_patch_size() {
 }
 
 /**
- * @brief Sets data_strides vector
+ * @brief Sets data_strides vector. For Fortran ordered data the qspace dimension moves
+ *      linearly, patches are then read as a box spanning the qspace indices, and transposed.
  *
  * @tparam T datatype of data found within filepath
  */
 template <typename T>
 void Patcher<T>::set_strides() {
     data_strides.resize(patch_shape.size() + 1, 0);
-    data_strides[0] = sizeof(T);  // 0th dimension moves linearly
-    for (size_t i = 1; i <= patch_shape.size(); i++) {
-        data_strides[i] = data_shape[i - 1] * data_strides[i - 1];
+    if (fortran_order) {
+        data_strides[patch_shape.size()] = file_size;
+        for (size_t i = patch_shape.size(); i > 0; i--) {
+            data_strides[i - 1] = data_shape[i] * data_strides[i];
+        }
+        qspace_min = *std::min_element(qspace_index.begin(), qspace_index.end());
+        qspace_span = *std::max_element(qspace_index.begin(), qspace_index.end()) + 1 - qspace_min;
+        qspace_columns.clear();
+        for (size_t q : qspace_index) {
+            qspace_columns.push_back(q - qspace_min);
+        }
+    } else {
+        data_strides[0] = file_size;  // 0th dimension moves linearly
+        for (size_t i = 1; i <= patch_shape.size(); i++) {
+            data_strides[i] = data_shape[i - 1] * data_strides[i - 1];
+        }
     }
 
     patch_byte_strides.resize(patch_shape.size(), 0);
-    patch_byte_strides[0] = data_strides[0];
+    patch_byte_strides[0] = sizeof(T);
     for (size_t i = 1; i < patch_shape.size(); i++) {
         patch_byte_strides[i] = patch_shape[i - 1] * patch_byte_strides[i - 1];
     }
@@ -383,6 +497,13 @@ void Patcher<T>::set_num_of_patches() {
                 1;
         }
     }
+
+    // Get patch number strides
+    patch_num_strides.assign(num_patches.size(), 1);
+    for (size_t i = 1; i < num_patches.size(); i++) {
+        patch_num_strides[i] = patch_num_strides[i - 1] * num_patches[i - 1];
+    }
+    max_patch_num = patch_num_strides.back() * num_patches.back();
 }
 
 /**
@@ -390,13 +511,10 @@ void Patcher<T>::set_num_of_patches() {
  *
  * @tparam T datatype of data found within filepath
  * @param pnum Patch number to be converted to patch num in each dimension
+ * @param state Read state to set patch numbers in
  */
 template <typename T>
-void Patcher<T>::set_patch_numbers(size_t pnum) {
-    size_t max_patch_num = 1;
-    for (size_t i = 0; i < num_patches.size(); i++) {
-        max_patch_num *= num_patches[i];
-    }
+void Patcher<T>::set_patch_numbers(size_t pnum, ReadState &state) const {
 
     // Patch number validation
     if (pnum >= max_patch_num) {
@@ -406,16 +524,8 @@ void Patcher<T>::set_patch_numbers(size_t pnum) {
     }
 
     // Reset state
-    if (has_run) {
-        patch_num.clear();
-    }
-    patch_num.resize(num_patches.size(), 0);
-
-    // Get patch number strides
-    std::vector<size_t> patch_num_strides(num_patches.size(), 1);
-    for (size_t i = 1; i < num_patches.size(); i++) {
-        patch_num_strides[i] = patch_num_strides[i - 1] * num_patches[i - 1];
-    }
+    std::vector<size_t> &patch_num = state.patch_num;
+    patch_num.assign(num_patches.size(), 0);
 
     // Increase pnum based on pnum_offset
     for (size_t i = 0; i < patch_num_offset.size() - 1; i++) {
@@ -446,56 +556,59 @@ void Patcher<T>::set_patch_numbers(size_t pnum) {
  */
 template <typename T>
 std::vector<size_t> Patcher<T>::get_patch_numbers() {
-    std::vector<size_t> out(patch_num.size());
-    std::reverse_copy(patch_num.begin(), patch_num.end(), out.begin());
+    std::vector<size_t> out(state.patch_num.size());
+    std::reverse_copy(state.patch_num.begin(), state.patch_num.end(), out.begin());
     return out;
 }
 
 /**
- * @brief Moves stream pointer to start of patch
+ * @brief Sets stream position to start of patch
  *
  * @tparam T datatype of data found within filepath
+ * @param state Read state to set position in
  */
 template <typename T>
-void Patcher<T>::move_stream_to_start() {
+void Patcher<T>::move_stream_to_start(ReadState &state) const {
     size_t i = 0;
-    pos = 0;
+    size_t pos = 0;
     // get relative position of patched dims
     for (; i < patch_shape.size(); i++) {
-        if (patch_num[i] != 0) {
+        if (state.patch_num[i] != 0) {
             // shift minus the padding
-            pos += (data_strides[i] * patch_num[i] * patch_stride[i]) -
+            pos += (data_strides[i] * state.patch_num[i] * patch_stride[i]) -
                    (data_strides[i] * padding[2 * i]);
         }
     }
-    pos += (qspace_index[0] * data_strides[i]);  // qdim
-    pos += start;
-    start = pos;  // update to patch start position
-    stream.seekg(pos, stream.beg);
+    pos += ((fortran_order ? qspace_min : qspace_index[0]) * data_strides[i]);  // qdim
+    pos += data_offset;
+    state.pos = pos;
+    state.start = pos;  // update to patch start position
 }
 
 template <typename T>
 size_t Patcher<T>::get_stream_start() {
-    return start;
+    return state.start;
 }
 
 /**
  * @brief Sets actual byte shift lengths for stream/buffer
  *
  * @tparam T datatype of data found within filepath
+ * @param state Read state to set shift lengths in
  */
 template <typename T>
-void Patcher<T>::set_shift_lengths() {
+void Patcher<T>::set_shift_lengths(ReadState &state) const {
+    std::vector<size_t> &shifts = state.shifts;
     shifts.resize(patch_shape.size(), 0);
 
     for (size_t i = 0; i < shifts.size(); i++) {
         shifts[i] = data_strides[i] * patch_shape[i];
         // If start of patch
-        if (patch_num[i] == 0) {
+        if (state.patch_num[i] == 0) {
             shifts[i] -= data_strides[i] * padding[2 * i];
         }
         // If end of patch
-        if (patch_num[i] == num_patches[i] - 1) {
+        if (state.patch_num[i] == num_patches[i] - 1) {
             shifts[i] -= data_strides[i] * padding[(2 * i) + 1];
         }
     }
@@ -503,92 +616,582 @@ void Patcher<T>::set_shift_lengths() {
 
 template <typename T>
 std::vector<size_t> Patcher<T>::get_shift_lengths() {
-    std::vector<size_t> out(shifts.size());
-    std::reverse_copy(shifts.begin(), shifts.end(), out.begin());
+    std::vector<size_t> out(state.shifts.size());
+    std::reverse_copy(state.shifts.begin(), state.shifts.end(), out.begin());
     return out;
 }
 
 /**
- * @brief Sets variables and data after reading data header
+ * @brief Sets the patch geometry that only depends on the data header and patch
+ *      configuration, i.e. everything that is independent of the patch number.
  *
  * @tparam T datatype of data found within filepath
  */
 template <typename T>
-void Patcher<T>::set_runtime_vars(size_t pnum) {
+void Patcher<T>::set_geometry() {
     set_padding();
     set_strides();
     set_num_of_patches();
-    set_patch_numbers(pnum);
-    set_shift_lengths();
+    std::unique_lock<std::shared_mutex> lock(plans_mutex);
+    plans.clear();
 }
 
 /**
- * @brief Reads patch into patch vector
+ * @brief Sets variables and data after reading data header
  *
  * @tparam T datatype of data found within filepath
  */
 template <typename T>
-void Patcher<T>::read_patch() {
-    move_stream_to_start();
-    // get data pointer as char pointer
-    buf = reinterpret_cast<char *>(patch.data());
+void Patcher<T>::set_runtime_vars(size_t pnum) {
+    set_geometry();
+    set_patch_numbers(pnum, state);
+    set_shift_lengths(state);
+}
+
+/**
+ * @brief Builds the read plan of the patch given by the patch numbers in state, one run per
+ *      row of the patch that lies within the data. File offsets are relative to the patch
+ *      start, such that the plan is valid for every patch of the same class.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param state Read state, with patch numbers & shift lengths set
+ */
+template <typename T>
+void Patcher<T>::plan_patch(ReadState &state) const {
+    state.pos = 0;
+    state.dest = 0;
+    state.plan.clear();
     const unsigned int dim = patch_shape.size();
     for (size_t i = 0; i < qspace_index.size() - 1; i++) {
-        read_nd_slice(dim - 1);
-        pos -= shifts[dim - 1];
-        pos += ((qspace_index[i + 1] - qspace_index[i]) * data_strides.back());
-        stream.seekg(pos, stream.beg);
+        plan_nd_slice(state, dim - 1);
+        state.pos -= state.shifts[dim - 1];
+        state.pos += ((qspace_index[i + 1] - qspace_index[i]) * data_strides.back());
+    }
+    plan_nd_slice(state, dim - 1);  // last slice
+}
+
+/**
+ * @brief Gets the class of the patch given by the patch numbers in state. Patches of the same
+ *      class, i.e. interior or the same combination of leading & trailing edges, share the
+ *      same read plan relative to the patch start.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param state Read state, with patch numbers set
+ * @return size_t Patch class, two bits per dimension
+ */
+template <typename T>
+size_t Patcher<T>::get_patch_class(const ReadState &state) const {
+    size_t patch_class = 0;
+    for (size_t i = 0; i < num_patches.size(); i++) {
+        size_t edges = 0;
+        if (state.patch_num[i] == 0) {
+            edges |= 1;
+        }
+        if (state.patch_num[i] + 1 == num_patches[i]) {
+            edges |= 2;
+        }
+        patch_class |= edges << (2 * i);
+    }
+    return patch_class;
+}
+
+/**
+ * @brief Gets the read plan of the patch class given by the patch numbers in state, compiling
+ *      and memoizing the plan on first use. Plans are cleared when the geometry is set.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param state Read state, with patch numbers & reader set
+ * @return const read_plan::ReadPlan& Read plan, relative to the patch start
+ */
+template <typename T>
+const read_plan::ReadPlan &Patcher<T>::get_read_plan(ReadState &state) const {
+    const size_t patch_class = get_patch_class(state);
+    {
+        std::shared_lock<std::shared_mutex> lock(plans_mutex);
+        auto it = plans.find(patch_class);
+        if (it != plans.end()) {
+            return it->second;
+        }
+    }
+    set_shift_lengths(state);
+    state.plan.set_element_sizes(file_size, sizeof(T));
+    if (fortran_order) {
+        state.plan.clear();
+        state.dest = 0;
+        plan_fortran_box(state, 0, 0);
+    } else {
+        plan_patch(state);
+    }
+    state.plan.set_fills(fortran_order ? state.dest : patch_size * sizeof(T));
+    state.plan.coalesce(state.reader->max_gap());
+    std::unique_lock<std::shared_mutex> lock(plans_mutex);
+    return plans.emplace(patch_class, std::move(state.plan)).first->second;
+}
+
+/**
+ * @brief Reads patch into the output buffer, using the read plan of the patch class offset
+ *      by the patch start. Constant padded regions are filled with the fill value, other
+ *      padding modes read the padded regions as part of the plan.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param state Read state, with patch numbers & reader set
+ * @param out Output buffer, of patch_size elements
+ */
+template <typename T>
+void Patcher<T>::read_patch(ReadState &state, char *out) const {
+    move_stream_to_start(state);
+    const read_plan::ReadPlan &plan = get_read_plan(state);
+    if (!fortran_order) {
+        plan.execute(*state.reader, state.start, out, state.scratch, get_transform());
+        return;
+    }
+    set_shift_lengths(state);
+    size_t box_bytes = qspace_span * sizeof(T);
+    for (size_t i = 0; i < patch_shape.size(); i++) {
+        box_bytes *= get_box_count(state, i);
+    }
+    state.box.resize(box_bytes);
+    read_plan::Transform box_transform;
+    box_transform.swap_size = swap_size;
+    box_transform.kernel = converter;
+    plan.execute(*state.reader, state.start, state.box.data(), state.scratch, box_transform);
+    transpose_box(state, out);
+}
+
+/**
+ * @brief Transposes the box read from Fortran ordered data into the C ordered patch. The box
+ *      is split into 2D blocks of the outermost patch dimension by the qspace dimension, which
+ *      are the contiguous dimensions of the patch and the box respectively. When normalizing,
+ *      the rows of each block are normalized as they are written.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param state Read state, with the box read & shift lengths set
+ * @param out Output buffer, of patch_size elements
+ */
+template <typename T>
+void Patcher<T>::transpose_box(ReadState &state, char *out) const {
+    const size_t dim = patch_shape.size();
+    std::vector<size_t> counts(dim), box_strides(dim), index(dim, 0);
+    size_t stride = qspace_span * sizeof(T);
+    size_t box_size = 1;
+    for (size_t i = dim; i > 0; i--) {
+        counts[i - 1] = get_box_count(state, i - 1);
+        box_strides[i - 1] = stride;
+        stride *= counts[i - 1];
+        box_size *= counts[i - 1];
+    }
+    if (box_size * qspace_index.size() < patch_size) {
+        // fill constant padded region
+        if (fill_bytes.empty()) {
+            std::memset(out, 0, patch_size * sizeof(T));
+        } else {
+            for (size_t i = 0; i < patch_size; i++) {
+                std::memcpy(out + (i * sizeof(T)), fill_bytes.data(), sizeof(T));
+            }
+        }
+    }
+    if (box_size == 0) {
+        return;
+    }
+    size_t lead = 0;
+    for (size_t i = 0; (i < dim) && (padding_mode == pad_mode::Mode::constant); i++) {
+        if (state.patch_num[i] == 0) {
+            lead += padding[2 * i] * patch_byte_strides[i];
+        }
+    }
+    const size_t channel_bytes = patch_byte_strides[dim - 1] * patch_shape[dim - 1];
+
+    // Iterate over all but the outermost dimension, transposing a block at each position
+    while (true) {
+        size_t src = 0;
+        size_t dest = lead;
+        for (size_t i = 1; i < dim; i++) {
+            src += index[i] * box_strides[i];
+            dest += index[i] * patch_byte_strides[i];
+        }
+        transpose::gather_transpose(state.box.data() + src, out + dest, counts[0], box_strides[0],
+                                    qspace_columns, channel_bytes, sizeof(T));
+        if (normalizer) {
+            for (size_t c = 0; c < qspace_columns.size(); c++) {
+                normalizer->apply(out, dest + (c * channel_bytes), counts[0] * sizeof(T));
+            }
+        }
+        size_t i = dim - 1;
+        for (; i > 0; i--) {
+            if (++index[i] < counts[i]) {
+                break;
+            }
+            index[i] = 0;
+        }
+        if (i == 0) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Extracts a single patch, once the file is opened and the geometry is set. Only
+ *      modifies the read plan cache, which is guarded, therefore can be called concurrently
+ *      given separate read states and thread safe readers. The output buffer need not be
+ *      initialised.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param pnum patch number
+ * @param out Output buffer, of patch_size elements
+ * @param rdr Reader to read patch data with
+ * @param state Read state used during extraction
+ */
+template <typename T>
+void Patcher<T>::extract_patch(size_t pnum, T *out, reader::Reader *rdr, ReadState &state) const {
+    set_patch_numbers(pnum, state);
+    state.reader = rdr;
+    read_patch(state, reinterpret_cast<char *>(out));
+}
+
+/**
+ * @brief Extracts a batch of patches. For batched readers (io_uring) the reads of all patches
+ *      are passed to the reader at once, such that they are submitted together, otherwise
+ *      each patch is extracted in turn. Patches that are transposed, converted or normalized
+ *      after reading are also extracted in turn.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param pnums patch numbers
+ * @param out Output buffer, of pnums.size() * patch_size elements
+ * @param rdr Reader to read patch data with
+ * @param state Read state used during extraction
+ */
+template <typename T>
+void Patcher<T>::extract_patches(const std::vector<size_t> &pnums, T *out, reader::Reader *rdr,
+                                 ReadState &state) const {
+    if (!rdr->is_batched() || fortran_order || (converter != nullptr) || normalizer) {
+        for (size_t i = 0; i < pnums.size(); i++) {
+            extract_patch(pnums[i], out + (i * patch_size), rdr, state);
+        }
+        return;
+    }
+    std::vector<reader::ReadRequest> requests;
+    std::vector<const read_plan::ReadPlan *> patch_plans;
+    state.reader = rdr;
+    for (size_t i = 0; i < pnums.size(); i++) {
+        char *patch_out = reinterpret_cast<char *>(out + (i * patch_size));
+        set_patch_numbers(pnums[i], state);
+        move_stream_to_start(state);
+        patch_plans.push_back(&get_read_plan(state));
+        patch_plans.back()->add_requests(state.start, patch_out, requests);
+    }
+    rdr->read_many(requests);
+    if (swap_size > 0) {
+        byte_swap::swap_in_place(reinterpret_cast<char *>(out),
+                                 pnums.size() * patch_size * sizeof(T), swap_size);
+    }
+    // Filled once swapped, such that the fill value is kept in native byte order
+    const read_plan::Transform transform = get_transform();
+    for (size_t i = 0; i < pnums.size(); i++) {
+        patch_plans[i]->fill(reinterpret_cast<char *>(out + (i * patch_size)), transform);
+    }
+}
+
+/**
+ * @brief Advises the reader that the patches will be read soon, such that readahead covers
+ *      the byte ranges actually read. Overlapping & adjacent ranges of the patches are merged
+ *      before advising.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param pnums patch numbers
+ * @param rdr Reader to advise
+ * @param state Read state used during planning
+ */
+template <typename T>
+void Patcher<T>::advise_patches(const std::vector<size_t> &pnums, reader::Reader *rdr,
+                                ReadState &state) const {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    state.reader = rdr;
+    for (size_t pnum : pnums) {
+        set_patch_numbers(pnum, state);
+        move_stream_to_start(state);
+        for (const read_plan::Read &read : get_read_plan(state).get_reads()) {
+            ranges.emplace_back(state.start + read.offset, state.start + read.offset + read.length);
+        }
+    }
+    std::sort(ranges.begin(), ranges.end());
+    size_t i = 0;
+    while (i < ranges.size()) {
+        size_t lo = ranges[i].first;
+        size_t hi = ranges[i].second;
+        for (i++; (i < ranges.size()) && (ranges[i].first <= hi); i++) {
+            hi = std::max(hi, ranges[i].second);
+        }
+        rdr->will_need(lo, hi - lo);
     }
-    read_nd_slice(dim - 1);  // last slice
 }
 
+/**
+ * @brief Plans a row of the patch. Padded elements of the row are skipped for constant
+ *      padding, otherwise each is read from the element of the row it is copied from.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param state Read state
+ */
 template <typename T>
-void Patcher<T>::read_slice() {
+void Patcher<T>::plan_slice(ReadState &state) const {
+    const size_t base = state.pos;
     // If in first patch, and left padded region
-    if ((patch_num[0] == 0) && (padding[0] > 0)) {
-        buf += patch_byte_strides[0] * padding[0];
+    if ((state.patch_num[0] == 0) && (padding[0] > 0)) {
+        if (padding_mode == pad_mode::Mode::constant) {
+            state.dest += patch_byte_strides[0] * padding[0];
+        } else {
+            for (size_t i = 0; i < padding[0]; i++) {
+                state.plan.add_run(base + get_source_offset(state, 0, i), data_strides[0],
+                                   state.dest);
+                state.dest += patch_byte_strides[0];
+            }
+        }
     }
-    if (shifts[0] > 0) {
-        // Read and shift pointers
-        stream.read(buf, shifts[0]);
-        buf += shifts[0];
-        pos += shifts[0];
+    if (state.shifts[0] > 0) {
+        // Add row to plan and shift positions
+        state.plan.add_run(state.pos, state.shifts[0], state.dest);
+        state.dest += (state.shifts[0] / data_strides[0]) * patch_byte_strides[0];
+        state.pos += state.shifts[0];
     }
     // If in last patch, and right padded region
-    if ((patch_num[0] + 1 == num_patches[0]) && (padding[1] > 0)) {
-        buf += patch_byte_strides[0] * padding[1];
+    if ((state.patch_num[0] + 1 == num_patches[0]) && (padding[1] > 0)) {
+        if (padding_mode == pad_mode::Mode::constant) {
+            state.dest += patch_byte_strides[0] * padding[1];
+        } else {
+            for (size_t i = patch_shape[0] - padding[1]; i < patch_shape[0]; i++) {
+                state.plan.add_run(base + get_source_offset(state, 0, i), data_strides[0],
+                                   state.dest);
+                state.dest += patch_byte_strides[0];
+            }
+        }
     }
 }
 
 /**
- * @brief Reads N-dimensional slice, intended to be used recursively.
+ * @brief Plans the box of Fortran ordered data covering the patch, intended to be used
+ *      recursively. The box spans the qspace indices and the rows of the patch within the
+ *      data, one run per position of the innermost patch dimension. Runs are added in file
+ *      order, such that the box is read densely with the qspace dimension moving linearly.
  *
  * @tparam T datatype of data found within filepath
+ * @param state Read state, with shift lengths set
+ * @param dim Dimension of box, starting at 0, the outermost in file
+ * @param pos Position of box row relative to the patch start
+ */
+template <typename T>
+void Patcher<T>::plan_fortran_box(ReadState &state, size_t dim, size_t pos) const {
+    const size_t count = get_box_count(state, dim);
+    const size_t row = qspace_span * data_strides.back();
+    for (size_t i = 0; i < count; i++) {
+        size_t row_pos = pos + (i * data_strides[dim]);
+        if (padding_mode != pad_mode::Mode::constant) {
+            row_pos = pos + get_source_offset(state, dim, i);
+        }
+        if (dim + 1 == patch_shape.size()) {
+            state.plan.add_run(row_pos, row, state.dest);
+            state.dest += qspace_span * sizeof(T);
+        } else {
+            plan_fortran_box(state, dim + 1, row_pos);
+        }
+    }
+}
+
+/**
+ * @brief Gets the number of positions of the Fortran box in a dimension. For constant
+ *      padding the box spans the patch rows within the data, otherwise every patch row,
+ *      padded rows being read from the rows they are copied from.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param state Read state, with shift lengths set
+ * @param dim Dimension of box
+ * @return size_t Number of positions
+ */
+template <typename T>
+size_t Patcher<T>::get_box_count(const ReadState &state, size_t dim) const {
+    if (padding_mode == pad_mode::Mode::constant) {
+        return state.shifts[dim] / data_strides[dim];
+    }
+    return patch_shape[dim];
+}
+
+/**
+ * @brief Gets the file offset of the data a patch index is copied from, relative to the
+ *      first row of the patch within the data. Padded indices are mapped into the data by
+ *      the padding mode, offsets before the first row wrap around.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param state Read state, with patch numbers set
+ * @param dim Dimension
+ * @param i Index within the patch
+ * @return size_t Relative byte offset
+ */
+template <typename T>
+size_t Patcher<T>::get_source_offset(const ReadState &state, size_t dim, size_t i) const {
+    const std::ptrdiff_t first = static_cast<std::ptrdiff_t>(state.patch_num[dim] *
+                                                             patch_stride[dim]) -
+                                 static_cast<std::ptrdiff_t>(padding[2 * dim]);
+    const std::ptrdiff_t index = first + static_cast<std::ptrdiff_t>(i);
+    size_t src = static_cast<size_t>(index);
+    if ((index < 0) || (src >= data_shape[dim])) {
+        src = pad_mode::source_index(padding_mode, index, data_shape[dim]);
+    }
+    const size_t start = (first < 0) ? 0 : static_cast<size_t>(first);
+    return (src - start) * data_strides[dim];
+}
+
+/**
+ * @brief Plans N-dimensional slice, intended to be used recursively. Padded slices are
+ *      skipped for constant padding, otherwise each is planned from the slice it is copied
+ *      from.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param state Read state
  * @param dim Dimensionality of slice, starting at 0.
  */
 template <typename T>
-void Patcher<T>::read_nd_slice(const unsigned int dim) {
+void Patcher<T>::plan_nd_slice(ReadState &state, const unsigned int dim) const {
     if (dim == 0) {
-        read_slice();
+        plan_slice(state);
     } else {
+        const size_t base = state.pos;
         // Iterate over dimension
         for (size_t i = 0; i < (patch_shape[dim]); i++) {
-            // If at first patch, and within left padded region
-            if ((patch_num[dim] == 0) && (i < padding[2 * dim])) {
-                buf += patch_byte_strides[dim];
-                // If at end patch, and within right padded region
-            } else if ((patch_num[dim] + 1 == num_patches[dim]) &&
-                       (i >= patch_shape[dim] - padding[(2 * dim) + 1])) {
-                buf += patch_byte_strides[dim];
+            // If at first patch and within left padded region, or at end patch and within
+            // right padded region
+            if (((state.patch_num[dim] == 0) && (i < padding[2 * dim])) ||
+                ((state.patch_num[dim] + 1 == num_patches[dim]) &&
+                 (i >= patch_shape[dim] - padding[(2 * dim) + 1]))) {
+                if (padding_mode == pad_mode::Mode::constant) {
+                    state.dest += patch_byte_strides[dim];
+                } else {
+                    const size_t pos = state.pos;
+                    state.pos = base + get_source_offset(state, dim, i);
+                    plan_nd_slice(state, dim - 1);
+                    state.pos = pos;
+                }
             } else {
-                read_nd_slice(dim - 1);
-                pos = pos - shifts[dim - 1] + data_strides[dim];  // Shift stream position.
-                stream.seekg(pos, stream.beg);
+                plan_nd_slice(state, dim - 1);
+                // Shift stream position.
+                state.pos = state.pos - state.shifts[dim - 1] + data_strides[dim];
             }
         }
     }
 }
 
+/**
+ * @brief Sets the per channel normalization applied to each row as it is copied into the
+ *      patch, x * scale + offset clipped to [lo, hi]. Constant padded regions are set to
+ *      fill_value, which is not normalized, in place of the padding value. Must be called
+ *      once the geometry is set, and not while patches are being extracted.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param scale Scale of each qspace index, or a single scale for all
+ * @param offset Offset of each qspace index, or a single offset for all
+ * @param lo Lower clip bound
+ * @param hi Upper clip bound
+ * @param fill_value Value of padded regions
+ */
+template <typename T>
+void Patcher<T>::set_normalization(const std::vector<double> &scale,
+                                   const std::vector<double> &offset, double lo, double hi,
+                                   double fill_value) {
+    if constexpr (std::is_floating_point<T>::value) {
+        if ((scale.size() != 1) && (scale.size() != qspace_index.size())) {
+            std::ostringstream oss;
+            oss << "Normalization requires 1 or " << qspace_index.size() << " channels, ";
+            oss << scale.size() << " given.";
+            throw std::runtime_error(oss.str());
+        }
+        const size_t channel_bytes = (patch_size / qspace_index.size()) * sizeof(T);
+        normalizer = std::make_unique<normalize::Normalizer>(
+            normalize::make_normalizer<T>(scale, offset, lo, hi, fill_value, channel_bytes));
+        set_fill_bytes();
+    } else {
+        throw std::runtime_error("Normalization requires a floating point patch datatype.");
+    }
+}
+
+/**
+ * @brief Removes the normalization, patches are then copied unchanged
+ *
+ * @tparam T datatype of data found within filepath
+ */
+template <typename T>
+void Patcher<T>::clear_normalization() {
+    normalizer.reset();
+    set_fill_bytes();
+}
+
+template <typename T>
+const normalize::Normalizer *Patcher<T>::get_normalizer() const {
+    return normalizer.get();
+}
+
+/**
+ * @brief Sets how padded regions are filled, as with np.pad. Constant padding is filled
+ *      with value, other modes copy the padded regions from the data, read as part of the
+ *      patch plan. Read plans are recompiled, so must not be called while patches are being
+ *      extracted.
+ *
+ * @tparam T datatype of data found within filepath
+ * @param mode Padding mode
+ * @param value Value of constant padded regions
+ */
+template <typename T>
+void Patcher<T>::set_padding_mode(pad_mode::Mode mode, double value) {
+    padding_mode = mode;
+    padding_value = value;
+    set_fill_bytes();
+    std::unique_lock<std::shared_mutex> lock(plans_mutex);
+    plans.clear();
+}
+
+template <typename T>
+pad_mode::Mode Patcher<T>::get_padding_mode() const {
+    return padding_mode;
+}
+
+template <typename T>
+double Patcher<T>::get_padding_value() const {
+    return padding_value;
+}
+
+/**
+ * @brief Sets the bytes constant padded regions are filled with, the normalization fill value
+ *      if normalizing, otherwise the padding value. Left empty when all bytes are zero, such
+ *      that padded regions are zeroed with memset.
+ *
+ * @tparam T datatype of data found within filepath
+ */
+template <typename T>
+void Patcher<T>::set_fill_bytes() {
+    const T value = static_cast<T>(normalizer ? normalizer->get_fill_value() : padding_value);
+    fill_bytes.assign(sizeof(T), 0);
+    std::memcpy(fill_bytes.data(), &value, sizeof(T));
+    if (std::all_of(fill_bytes.begin(), fill_bytes.end(), [](char b) { return b == 0; })) {
+        fill_bytes.clear();
+    }
+}
+
+/**
+ * @brief Gets the transforms applied as a read plan is executed
+ *
+ * @tparam T datatype of data found within filepath
+ * @return read_plan::Transform Byte swap, datatype conversion, normalization & fill value
+ */
+template <typename T>
+read_plan::Transform Patcher<T>::get_transform() const {
+    read_plan::Transform transform;
+    transform.swap_size = swap_size;
+    transform.kernel = converter;
+    transform.norm = normalizer.get();
+    if (!fill_bytes.empty()) {
+        transform.fill = fill_bytes.data();
+        transform.fill_size = fill_bytes.size();
+    }
+    return transform;
+}
+
 /**
  * @brief Gets data shape read from header in npy file
  *
@@ -620,14 +1223,48 @@ std::vector<T> Patcher<T>::get_patch(const std::string &fpath, const std::vector
                                      std::vector<size_t> pnum_offset) {
     set_init_vars(fpath, qidx, pshape, pstride, padding, pnum_offset);
     open_file();
+    open_reader(reader::ReadMode::stream);
     set_runtime_vars(pnum);
-    read_patch();
+    state.reader = reader.get();
+    read_patch(state, reinterpret_cast<char *>(patch.data()));
     sanity_check();
     has_run = true;
 
     return patch;
 }
 
+/**
+ * @brief Public method to extract a batch of patches, the file is opened and the patch
+ *      geometry is computed once for the whole batch.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param fpath filepath for .npy data file
+ * @param qidx qspace index (0th index in file)
+ * @param pshape patch shape
+ * @param pstride patch stride
+ * @param pnums patch numbers
+ * @return std::vector<T> Patch data, contiguous patches in order of pnums
+ */
+template <typename T>
+std::vector<T> Patcher<T>::get_patches(const std::string &fpath, const std::vector<size_t> &qidx,
+                                       std::vector<size_t> pshape, std::vector<size_t> pstride,
+                                       const std::vector<size_t> &pnums,
+                                       std::vector<size_t> padding,
+                                       std::vector<size_t> pnum_offset) {
+    set_init_vars(fpath, qidx, pshape, pstride, padding, pnum_offset);
+    open_file();
+    open_reader(reader::ReadMode::stream);
+    set_geometry();
+    std::vector<T> patches(patch_size * pnums.size());
+    for (size_t i = 0; i < pnums.size(); i++) {
+        extract_patch(pnums[i], patches.data() + (i * patch_size), reader.get(), state);
+    }
+    sanity_check();
+    has_run = true;
+
+    return patches;
+}
+
 template <typename T>
 void Patcher<T>::debug_vars(const std::string &fpath, const std::vector<size_t> &qidx,
                             std::vector<size_t> pshape, std::vector<size_t> pstride, size_t pnum,
@@ -635,7 +1272,7 @@ void Patcher<T>::debug_vars(const std::string &fpath, const std::vector<size_t>
     set_init_vars(fpath, qidx, pshape, pstride, padding, pnum_offset);
     open_file();
     set_runtime_vars(pnum);
-    move_stream_to_start();
+    move_stream_to_start(state);
     sanity_check();
     has_run = true;
 }
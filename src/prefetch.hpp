@@ -0,0 +1,190 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef PREFETCH_HPP_
+#define PREFETCH_HPP_
+
+#include <algorithm>           // std::min, std::max
+#include <condition_variable>  // std::condition_variable
+#include <exception>           // std::exception_ptr
+#include <mutex>               // std::mutex, std::unique_lock
+#include <stdexcept>           // std::runtime_error
+#include <thread>              // std::thread
+#include <utility>             // std::move
+#include <vector>              // std::vector
+
+#include "src/session.hpp"
+
+/**
+ * @brief Extracts a sequence of patches on background threads, keeping at most depth patches
+ *      in flight. Patches are returned in order of the given patch numbers, such that
+ *      extraction overlaps with the caller's processing of earlier patches.
+ *
+ * @tparam T datatype of data found within fpath
+ */
+template <typename T>
+class Prefetcher {
+  private:
+    PatcherSession<T> &session;
+    const std::vector<size_t> pnums;
+    const size_t depth;
+    std::vector<std::vector<T>> slots;
+    std::vector<std::exception_ptr> errors;
+    std::vector<bool> ready;
+    size_t next_issue = 0, next_consume = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::thread> workers;
+    void work();
+
+  public:
+    Prefetcher(PatcherSession<T> &, const std::vector<size_t> &, size_t = 8, size_t = 1);
+    ~Prefetcher();
+    Prefetcher(const Prefetcher &) = delete;
+    Prefetcher &operator=(const Prefetcher &) = delete;
+    bool next(std::vector<T> &);
+    size_t size() const;
+    size_t position();
+    const PatcherSession<T> &get_session() const;
+};
+
+/**
+ * @brief Construct a new Prefetcher object, and starts extracting the first patches.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param session session to extract patches with, must outlive the prefetcher
+ * @param pnums patch numbers, in the order patches are returned
+ * @param depth maximum number of patches extracted ahead of the consumer
+ * @param num_threads number of background threads, 0 uses the number of hardware threads
+ */
+template <typename T>
+Prefetcher<T>::Prefetcher(PatcherSession<T> &session, const std::vector<size_t> &pnums,
+                          size_t depth, size_t num_threads)
+    : session(session), pnums(pnums), depth(depth), slots(depth), errors(depth), ready(depth) {
+    if (depth == 0) {
+        throw std::runtime_error("Prefetch depth must be greater than 0.");
+    }
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    num_threads = std::min(num_threads, depth);
+    for (size_t i = 0; i < num_threads; i++) {
+        workers.emplace_back(&Prefetcher::work, this);
+    }
+}
+
+/**
+ * @brief Destroy the Prefetcher object, waits for patches being extracted to finish, no
+ *      further patches are started.
+ *
+ * @tparam T datatype of data found within fpath
+ */
+template <typename T>
+Prefetcher<T>::~Prefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Worker loop, extracts the next patch number into its slot whenever fewer than depth
+ *      patches are waiting to be consumed.
+ *
+ * @tparam T datatype of data found within fpath
+ */
+template <typename T>
+void Prefetcher<T>::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] {
+            return stopping ||
+                   ((next_issue < pnums.size()) && (next_issue - next_consume < depth));
+        });
+        if (stopping) {
+            return;
+        }
+        const size_t i = next_issue++;
+        const size_t slot = i % depth;
+        lock.unlock();
+
+        std::vector<T> patch(session.get_patch_size());
+        std::exception_ptr error;
+        try {
+            session.get_patch_into(pnums[i], patch.data());
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        slots[slot] = std::move(patch);
+        errors[slot] = error;
+        ready[slot] = true;
+        cv.notify_all();
+    }
+}
+
+/**
+ * @brief Gets the next patch, waiting until it has been extracted. Errors raised during
+ *      extraction are rethrown here, in order.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param out set to the patch data
+ * @return true If a patch was returned, false once all patches have been returned
+ */
+template <typename T>
+bool Prefetcher<T>::next(std::vector<T> &out) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (next_consume >= pnums.size()) {
+        return false;
+    }
+    const size_t slot = next_consume % depth;
+    cv.wait(lock, [this, slot] { return ready[slot]; });
+    out = std::move(slots[slot]);
+    std::exception_ptr error = errors[slot];
+    errors[slot] = nullptr;
+    ready[slot] = false;
+    next_consume++;
+    lock.unlock();
+    cv.notify_all();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the total number of patches
+ *
+ * @tparam T datatype of data found within fpath
+ * @return size_t Number of patches
+ */
+template <typename T>
+size_t Prefetcher<T>::size() const {
+    return pnums.size();
+}
+
+/**
+ * @brief Gets the number of patches returned so far
+ *
+ * @tparam T datatype of data found within fpath
+ * @return size_t Number of patches returned
+ */
+template <typename T>
+size_t Prefetcher<T>::position() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return next_consume;
+}
+
+template <typename T>
+const PatcherSession<T> &Prefetcher<T>::get_session() const {
+    return session;
+}
+
+#endif  // PREFETCH_HPP_
@@ -2,12 +2,720 @@
 // Use of this source code is governed by an MIT-style license that can be
 // found in the LICENSE file.
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <limits>     // std::numeric_limits
+#include <memory>     // std::unique_ptr
+#include <optional>   // std::optional
+#include <stdexcept>  // std::runtime_error
+#include <string>     // std::string
+#include <utility>    // std::move
+#include <vector>     // std::vector
+
+#include "src/block_cache.hpp"
+#include "src/chunk_store.hpp"
+#include "src/grid.hpp"
+#include "src/header_cache.hpp"
+#include "src/pad_mode.hpp"
+#include "src/patch_major.hpp"
 #include "src/patcher.hpp"
+#include "src/prefetch.hpp"
+#include "src/reader.hpp"
+#include "src/sampler.hpp"
+#include "src/session.hpp"
+#include "src/uring.hpp"
+
+/**
+ * @brief Gets the shape of a patch array, i.e. (len(qidx), *pshape)
+ *
+ * @param qidx qspace index
+ * @param pshape patch shape
+ * @return std::vector<size_t> Patch array shape
+ */
+std::vector<size_t> patch_array_shape(const std::vector<size_t> &qidx,
+                                      const std::vector<size_t> &pshape) {
+    std::vector<size_t> shape{qidx.size()};
+    shape.insert(shape.end(), pshape.begin(), pshape.end());
+    return shape;
+}
+
+/**
+ * @brief Moves vector into a NumPy array without copying, the array owns the vector.
+ *
+ * @tparam T datatype of vector
+ * @param data Vector to move
+ * @param shape Array shape
+ * @return pybind11::array_t<T> NumPy array
+ */
+template <typename T>
+pybind11::array_t<T> as_array(std::vector<T> &&data, const std::vector<size_t> &shape) {
+    auto *vec = new std::vector<T>(std::move(data));
+    pybind11::capsule owner(vec, [](void *v) { delete reinterpret_cast<std::vector<T> *>(v); });
+    return pybind11::array_t<T>(shape, vec->data(), owner);
+}
+
+/**
+ * @brief Patcher::get_patch returning a NumPy array of shape (len(qidx), *pshape). The GIL is
+ *      held as Patcher keeps its per call state as members.
+ */
+template <typename T>
+pybind11::array_t<T> get_patch_array(Patcher<T> &p, const std::string &fpath,
+                                     const std::vector<size_t> &qidx, std::vector<size_t> pshape,
+                                     std::vector<size_t> pstride, size_t pnum,
+                                     std::vector<size_t> padding,
+                                     std::vector<size_t> pnum_offset) {
+    std::vector<size_t> shape = patch_array_shape(qidx, pshape);
+    return as_array(p.get_patch(fpath, qidx, pshape, pstride, pnum, padding, pnum_offset), shape);
+}
+
+/**
+ * @brief Patcher::get_patches returning a NumPy array of shape (len(pnums), len(qidx), *pshape).
+ */
+template <typename T>
+pybind11::array_t<T> get_patches_array(Patcher<T> &p, const std::string &fpath,
+                                       const std::vector<size_t> &qidx,
+                                       std::vector<size_t> pshape, std::vector<size_t> pstride,
+                                       const std::vector<size_t> &pnums,
+                                       std::vector<size_t> padding,
+                                       std::vector<size_t> pnum_offset) {
+    std::vector<size_t> shape = patch_array_shape(qidx, pshape);
+    shape.insert(shape.begin(), pnums.size());
+    return as_array(p.get_patches(fpath, qidx, pshape, pstride, pnums, padding, pnum_offset),
+                    shape);
+}
+
+/**
+ * @brief PatcherSession::get_patch returning a NumPy array of shape (len(qidx), *pshape). The
+ *      patch is read directly into the array with the GIL released.
+ */
+template <typename T>
+pybind11::array_t<T> get_session_patch_array(PatcherSession<T> &s, size_t pnum) {
+    pybind11::array_t<T> out(patch_array_shape(s.get_qidx(), s.get_pshape()));
+    T *ptr = out.mutable_data();
+    {
+        pybind11::gil_scoped_release release;
+        s.get_patch_into(pnum, ptr);
+    }
+    return out;
+}
+
+/**
+ * @brief PatcherSession::get_patches returning a NumPy array of shape
+ *      (len(pnums), len(qidx), *pshape). The patches are read directly into the array with
+ *      the GIL released.
+ */
+template <typename T>
+pybind11::array_t<T> get_session_patches_array(PatcherSession<T> &s,
+                                               const std::vector<size_t> &pnums,
+                                               size_t num_threads) {
+    std::vector<size_t> shape = patch_array_shape(s.get_qidx(), s.get_pshape());
+    shape.insert(shape.begin(), pnums.size());
+    pybind11::array_t<T> out(shape);
+    T *ptr = out.mutable_data();
+    {
+        pybind11::gil_scoped_release release;
+        s.get_patches_into(pnums, ptr, num_threads);
+    }
+    return out;
+}
+
+/**
+ * @brief Gets the normalization of a session or grid iterator as a tuple of
+ *      (scale, offset, clip_min, clip_max, fill_value), None if patches are not normalized.
+ */
+template <typename P>
+pybind11::object get_normalization(const P &p) {
+    const normalize::Normalizer *norm = p.get_normalizer();
+    if (norm == nullptr) {
+        return pybind11::none();
+    }
+    return pybind11::make_tuple(norm->get_scale(), norm->get_offset(), norm->get_lo(),
+                                norm->get_hi(), norm->get_fill_value());
+}
+
+/**
+ * @brief Adds the normalization methods to a session or grid iterator class
+ */
+template <typename P>
+void declare_normalization(pybind11::class_<P> &c) {
+    c.def(
+         "set_normalization",
+         [](P &p, const std::vector<double> &scale, const std::vector<double> &offset,
+            double clip_min, double clip_max, double fill_value) {
+             p.set_normalization(scale, offset, clip_min, clip_max, fill_value);
+         },
+         pybind11::arg("scale"), pybind11::arg("offset"),
+         pybind11::arg("clip_min") = -std::numeric_limits<double>::infinity(),
+         pybind11::arg("clip_max") = std::numeric_limits<double>::infinity(),
+         pybind11::arg("fill_value") = 0.0,
+         "Normalize each qspace index as x * scale + offset, clipped to [clip_min, clip_max], "
+         "as rows are copied into the patch. Give one scale & offset per qspace index, or one "
+         "for all. Padded regions are set to fill_value. Requires a floating point datatype")
+        .def(
+            "clear_normalization", [](P &p) { p.clear_normalization(); },
+            "Remove the normalization, padded regions are then zero filled")
+        .def("get_normalization", &get_normalization<P>,
+             "Get the normalization as (scale, offset, clip_min, clip_max, fill_value), None if "
+             "patches are not normalized");
+}
+
+/**
+ * @brief Adds the padding mode methods to a session or grid iterator class
+ */
+template <typename P>
+void declare_padding_mode(pybind11::class_<P> &c) {
+    c.def(
+         "set_padding_mode",
+         [](P &p, pad_mode::Mode mode, double constant_value) {
+             p.set_padding_mode(mode, constant_value);
+         },
+         pybind11::arg("mode"), pybind11::arg("constant_value") = 0.0,
+         "Set how padded regions are filled, the padded elements are gathered from the data as "
+         "the patch is read. constant_value is used by PadMode.constant, unless normalizing")
+        .def(
+            "get_padding_mode", [](const P &p) { return p.get_padding_mode(); },
+            "Get the padding mode")
+        .def(
+            "get_padding_value", [](const P &p) { return p.get_padding_value(); },
+            "Get the constant padding value");
+}
+
+template <typename T>
+void declare_session(pybind11::module &m, const std::string &name) {
+    pybind11::class_<PatcherSession<T>> session(m, name.c_str());
+    session
+        .def(pybind11::init<const std::string &, const std::vector<size_t> &,
+                            const std::vector<size_t> &, const std::vector<size_t> &,
+                            const std::vector<size_t> &, const std::vector<size_t> &,
+                            reader::ReadMode>(),
+             pybind11::arg("fpath"), pybind11::arg("qidx"), pybind11::arg("pshape"),
+             pybind11::arg("pstride"), pybind11::arg("padding") = pybind11::tuple(),
+             pybind11::arg("pnum_offset") = pybind11::tuple(),
+             pybind11::arg("mode") = reader::ReadMode::stream,
+             "Open the npy file and compute the patch geometry once, padding is automatically "
+             "calculated to ensure valid extraction. Use padding parameter to add additional "
+             "padding to object")
+        .def("get_patch", &get_session_patch_array<T>, pybind11::arg("pnum"),
+             "Read a patch from the opened file")
+        .def("get_patches", &get_session_patches_array<T>, pybind11::arg("pnums"),
+             pybind11::arg("num_threads") = 1,
+             "Read a batch of patches from the opened file into one array. Use num_threads to "
+             "spread the batch over a pool of worker threads, 0 uses all hardware threads")
+        .def(
+            "get_plan_stats",
+            [](const PatcherSession<T> &s, size_t pnum) {
+                read_plan::PlanStats stats = s.get_plan_stats(pnum);
+                pybind11::dict out;
+                out["rows"] = stats.rows;
+                out["runs"] = stats.runs;
+                out["reads"] = stats.reads;
+                out["bytes"] = stats.bytes;
+                out["read_bytes"] = stats.read_bytes;
+                return out;
+            },
+            pybind11::arg("pnum"),
+            "Get the number of rows, merged runs and coalesced reads needed to read a patch, "
+            "along with the patch bytes and the bytes read from file")
+        .def("get_patch_offset", &PatcherSession<T>::get_patch_offset, pybind11::arg("pnum"),
+             "Get the file offset at which reading of a patch starts")
+        .def("set_access_hint", &PatcherSession<T>::set_access_hint, pybind11::arg("hint"),
+             "Advise the kernel of the expected access pattern. Unless normal, batches also "
+             "advise the kernel of the byte ranges of the patches before reading them. With "
+             "ReadMode.stream, sequential & random do not change the readahead of the stream, "
+             "only willneed & the byte ranges of batches take effect. ReadMode.direct ignores "
+             "hints")
+        .def("get_access_hint", &PatcherSession<T>::get_access_hint,
+             "Get the expected access pattern")
+        .def(
+            "get_patch_size", [](PatcherSession<T> &s) { return s.get_patch_size(); },
+            "Get the total patch size")
+        .def(
+            "get_data_shape", [](PatcherSession<T> &s) { return s.get_data_shape(); },
+            "Get the data shape")
+        .def(
+            "get_padding", [](PatcherSession<T> &s) { return s.get_padding(); },
+            "Get padding list")
+        .def(
+            "get_data_strides", [](PatcherSession<T> &s) { return s.get_data_strides(); },
+            "Get the data strides")
+        .def(
+            "get_patch_strides", [](PatcherSession<T> &s) { return s.get_patch_strides(); },
+            "Get the patch strides")
+        .def(
+            "get_num_patches", [](PatcherSession<T> &s) { return s.get_num_patches(); },
+            "Get the maximum number of patches in each dimension")
+        .def(pybind11::pickle(
+            [](const PatcherSession<T> &s) {
+                return pybind11::make_tuple(s.get_filepath(), s.get_qidx(), s.get_pshape(),
+                                            s.get_pstride(), s.get_extra_padding(),
+                                            s.get_pnum_offset(), s.get_read_mode(),
+                                            s.get_access_hint(), get_normalization(s),
+                                            pybind11::make_tuple(s.get_padding_mode(),
+                                                                 s.get_padding_value()));
+            },
+            [](pybind11::tuple t) {
+                auto s = std::make_unique<PatcherSession<T>>(
+                    t[0].cast<std::string>(), t[1].cast<std::vector<size_t>>(),
+                    t[2].cast<std::vector<size_t>>(), t[3].cast<std::vector<size_t>>(),
+                    t[4].cast<std::vector<size_t>>(), t[5].cast<std::vector<size_t>>(),
+                    t[6].cast<reader::ReadMode>());
+                if (t.size() > 7) {
+                    s->set_access_hint(t[7].cast<reader::AccessHint>());
+                }
+                if ((t.size() > 8) && !t[8].is_none()) {
+                    pybind11::tuple norm = t[8].cast<pybind11::tuple>();
+                    s->set_normalization(
+                        norm[0].cast<std::vector<double>>(), norm[1].cast<std::vector<double>>(),
+                        norm[2].cast<double>(), norm[3].cast<double>(), norm[4].cast<double>());
+                }
+                if (t.size() > 9) {
+                    pybind11::tuple pad = t[9].cast<pybind11::tuple>();
+                    s->set_padding_mode(pad[0].cast<pad_mode::Mode>(), pad[1].cast<double>());
+                }
+                return s;
+            }));
+    declare_normalization(session);
+    declare_padding_mode(session);
+}
+
+/**
+ * @brief Declares a GridIterator class. Iterating returns each patch in patch number order as a
+ *      NumPy array of shape (len(qidx), *pshape), read with the GIL released.
+ */
+template <typename T>
+void declare_grid(pybind11::module &m, const std::string &name) {
+    pybind11::class_<GridIterator<T>> grid(m, name.c_str());
+    grid
+        .def(pybind11::init<const std::string &, const std::vector<size_t> &,
+                            const std::vector<size_t> &, const std::vector<size_t> &,
+                            const std::vector<size_t> &, reader::ReadMode>(),
+             pybind11::arg("fpath"), pybind11::arg("qidx"), pybind11::arg("pshape"),
+             pybind11::arg("pstride"), pybind11::arg("padding") = pybind11::tuple(),
+             pybind11::arg("mode") = reader::ReadMode::stream,
+             "Iterate over every patch of the grid, reading the file in slabs along the "
+             "outermost patched dimension such that each byte is read once")
+        .def("__iter__", [](GridIterator<T> &g) -> GridIterator<T> & { return g; })
+        .def(
+            "__next__",
+            [](GridIterator<T> &g) {
+                pybind11::array_t<T> out(patch_array_shape(g.get_qidx(), g.get_pshape()));
+                T *ptr = out.mutable_data();
+                bool has_next;
+                {
+                    pybind11::gil_scoped_release release;
+                    has_next = g.next(ptr);
+                }
+                if (!has_next) {
+                    throw pybind11::stop_iteration();
+                }
+                return out;
+            })
+        .def("__len__", &GridIterator<T>::size)
+        .def("reset", &GridIterator<T>::reset, "Restart iteration from the first patch")
+        .def("position", &GridIterator<T>::position, "Get the number of patches visited")
+        .def("get_bytes_read", &GridIterator<T>::get_bytes_read,
+             "Get the number of bytes read from file since the last reset")
+        .def("get_slab_bytes", &GridIterator<T>::get_slab_bytes,
+             "Get the size of the slab ring buffer in bytes")
+        .def(
+            "get_patch_size", [](GridIterator<T> &g) { return g.get_patch_size(); },
+            "Get the total patch size")
+        .def(
+            "get_num_patches", [](GridIterator<T> &g) { return g.get_num_patches(); },
+            "Get the maximum number of patches in each dimension");
+    declare_normalization(grid);
+    declare_padding_mode(grid);
+}
+
+/**
+ * @brief Declares a Prefetcher class. Patch numbers may be given by any finite iterable, e.g.
+ *      the epoch of a LocalShuffle, and are consumed on construction, holding the GIL.
+ *      Iterating returns each patch as a NumPy array of shape (len(qidx), *pshape), waiting
+ *      with the GIL released.
+ */
+template <typename T>
+void declare_prefetcher(pybind11::module &m, const std::string &name) {
+    pybind11::class_<Prefetcher<T>>(m, name.c_str())
+        .def(pybind11::init([](PatcherSession<T> &s, pybind11::iterable pnums, size_t depth,
+                               size_t num_threads) {
+                 std::vector<size_t> pnums_v;
+                 for (pybind11::handle pnum : pnums) {
+                     pnums_v.push_back(pnum.cast<size_t>());
+                 }
+                 return std::make_unique<Prefetcher<T>>(s, pnums_v, depth, num_threads);
+             }),
+             pybind11::arg("session"), pybind11::arg("pnums"), pybind11::arg("depth") = 8,
+             pybind11::arg("num_threads") = 1, pybind11::keep_alive<1, 2>(),
+             "Extract patches of session on background threads, keeping at most depth patches "
+             "in flight. Patches are returned in order of pnums, a finite iterable of patch "
+             "numbers that is consumed on construction, e.g. LocalShuffle.get_epoch")
+        .def("__iter__", [](Prefetcher<T> &p) -> Prefetcher<T> & { return p; })
+        .def("__next__",
+             [](Prefetcher<T> &p) {
+                 const PatcherSession<T> &s = p.get_session();
+                 std::vector<T> patch;
+                 bool has_next;
+                 {
+                     pybind11::gil_scoped_release release;
+                     has_next = p.next(patch);
+                 }
+                 if (!has_next) {
+                     throw pybind11::stop_iteration();
+                 }
+                 return as_array(std::move(patch),
+                                 patch_array_shape(s.get_qidx(), s.get_pshape()));
+             })
+        .def("__len__", &Prefetcher<T>::size)
+        .def("position", &Prefetcher<T>::position, "Get the number of patches returned");
+}
+
+/**
+ * @brief Declares a PatchSampler class. Each call to sample draws a batch of patch numbers and
+ *      extracts the patches with the GIL released, returning both as NumPy arrays.
+ */
+template <typename T>
+void declare_sampler(pybind11::module &m, const std::string &name) {
+    pybind11::class_<PatchSampler<T>>(m, name.c_str())
+        .def(pybind11::init([](PatcherSession<T> &s, uint64_t seed,
+                               const std::vector<size_t> &lower, const std::vector<size_t> &upper,
+                               std::optional<std::vector<double>> weights) {
+                 if (!weights) {
+                     return std::make_unique<PatchSampler<T>>(s, seed, lower, upper);
+                 }
+                 if (!lower.empty() || !upper.empty()) {
+                     throw std::runtime_error("Sampler takes either bounds or weights, not both.");
+                 }
+                 return std::make_unique<PatchSampler<T>>(s, seed, *weights);
+             }),
+             pybind11::arg("session"), pybind11::arg("seed"),
+             pybind11::arg("lower") = pybind11::tuple(), pybind11::arg("upper") = pybind11::tuple(),
+             pybind11::arg("weights") = pybind11::none(), pybind11::keep_alive<1, 2>(),
+             "Sample patches of session uniformly, optionally within the patch index bounds "
+             "[lower, upper) of each dimension, or in proportion to a weight per patch")
+        .def("set_epoch", &PatchSampler<T>::set_epoch, pybind11::arg("epoch"),
+             pybind11::arg("worker") = 0,
+             "Restart the random stream, derived from the seed, epoch and worker id")
+        .def(
+            "sample",
+            [](PatchSampler<T> &s, size_t batch_size, size_t num_threads) {
+                const PatcherSession<T> &session = s.get_session();
+                std::vector<size_t> shape = patch_array_shape(session.get_qidx(),
+                                                              session.get_pshape());
+                shape.insert(shape.begin(), batch_size);
+                pybind11::array_t<T> out(shape);
+                T *ptr = out.mutable_data();
+                std::vector<size_t> pnums;
+                {
+                    pybind11::gil_scoped_release release;
+                    pnums = s.sample_into(batch_size, ptr, num_threads);
+                }
+                return pybind11::make_tuple(as_array(std::move(pnums), {batch_size}), out);
+            },
+            pybind11::arg("batch_size"), pybind11::arg("num_threads") = 1,
+            "Draw a batch of patch numbers and extract the patches, returns (pnums, patches)")
+        .def(
+            "sample_pnums",
+            [](PatchSampler<T> &s, size_t batch_size) {
+                return as_array(s.sample_pnums(batch_size), {batch_size});
+            },
+            pybind11::arg("batch_size"), "Draw a batch of patch numbers without extracting")
+        .def("__len__", &PatchSampler<T>::size)
+        .def("get_seed", &PatchSampler<T>::get_seed, "Get the random seed")
+        .def("get_epoch", &PatchSampler<T>::get_epoch, "Get the epoch number")
+        .def("get_worker", &PatchSampler<T>::get_worker, "Get the worker id");
+}
+
+/**
+ * @brief Adds a LocalShuffle constructor taking a session of type T
+ */
+template <typename T>
+void declare_local_shuffle_init(pybind11::class_<sampler::LocalShuffle> &c) {
+    c.def(pybind11::init([](PatcherSession<T> &s, uint64_t seed, size_t partition_size,
+                            size_t window) {
+              return sampler::make_local_shuffle(s, seed, partition_size, window);
+          }),
+          pybind11::arg("session"), pybind11::arg("seed"), pybind11::arg("partition_size") = 64,
+          pybind11::arg("window") = 8,
+          "Shuffle every patch of session, sorted by file offset into partitions of "
+          "partition_size neighbouring patches. Each epoch the partitions are shuffled, then "
+          "patches are shuffled within windows of window patches");
+}
+
+/**
+ * @brief Declares a ChunkStoreSession class, with the patch methods of PatcherSession
+ */
+template <typename T>
+void declare_chunk_store(pybind11::module &m, const std::string &name) {
+    pybind11::class_<ChunkStoreSession<T>> session(m, name.c_str());
+    session
+        .def(pybind11::init<const std::string &, const std::vector<size_t> &,
+                            const std::vector<size_t> &, const std::vector<size_t> &,
+                            const std::vector<size_t> &, const std::vector<size_t> &>(),
+             pybind11::arg("fpath"), pybind11::arg("qidx"), pybind11::arg("pshape"),
+             pybind11::arg("pstride"), pybind11::arg("padding") = pybind11::tuple(),
+             pybind11::arg("pnum_offset") = pybind11::tuple(),
+             "Open a chunked store written by convert_to_chunk_store, patches are equal to "
+             "those of a PatcherSession of the converted npy file")
+        .def(
+            "get_patch",
+            [](const ChunkStoreSession<T> &s, size_t pnum) {
+                pybind11::array_t<T> out(patch_array_shape(s.get_qidx(), s.get_pshape()));
+                T *ptr = out.mutable_data();
+                {
+                    pybind11::gil_scoped_release release;
+                    s.get_patch_into(pnum, ptr);
+                }
+                return out;
+            },
+            pybind11::arg("pnum"), "Read a patch, decompressing only the chunks it overlaps")
+        .def(
+            "get_patches",
+            [](ChunkStoreSession<T> &s, const std::vector<size_t> &pnums, size_t num_threads) {
+                std::vector<size_t> shape = patch_array_shape(s.get_qidx(), s.get_pshape());
+                shape.insert(shape.begin(), pnums.size());
+                pybind11::array_t<T> out(shape);
+                T *ptr = out.mutable_data();
+                {
+                    pybind11::gil_scoped_release release;
+                    s.get_patches_into(pnums, ptr, num_threads);
+                }
+                return out;
+            },
+            pybind11::arg("pnums"), pybind11::arg("num_threads") = 1,
+            "Read a batch of patches into one array. Use num_threads to decompress patches on "
+            "a pool of worker threads, 0 uses all hardware threads")
+        .def("get_compressed_bytes", &ChunkStoreSession<T>::get_compressed_bytes,
+             "Get the size of the compressed chunks of the store in bytes")
+        .def("get_chunk_shape", &ChunkStoreSession<T>::get_chunk_shape, "Get the chunk shape")
+        .def(
+            "get_patch_size", [](ChunkStoreSession<T> &s) { return s.get_patch_size(); },
+            "Get the total patch size")
+        .def(
+            "get_data_shape", [](ChunkStoreSession<T> &s) { return s.get_data_shape(); },
+            "Get the data shape")
+        .def(
+            "get_padding", [](ChunkStoreSession<T> &s) { return s.get_padding(); },
+            "Get padding list")
+        .def(
+            "get_num_patches", [](ChunkStoreSession<T> &s) { return s.get_num_patches(); },
+            "Get the maximum number of patches in each dimension")
+        .def(pybind11::pickle(
+            [](const ChunkStoreSession<T> &s) {
+                return pybind11::make_tuple(s.get_filepath(), s.get_qidx(), s.get_pshape(),
+                                            s.get_pstride(), s.get_extra_padding(),
+                                            s.get_pnum_offset(),
+                                            pybind11::make_tuple(s.get_padding_mode(),
+                                                                 s.get_padding_value()));
+            },
+            [](pybind11::tuple t) {
+                auto s = std::make_unique<ChunkStoreSession<T>>(
+                    t[0].cast<std::string>(), t[1].cast<std::vector<size_t>>(),
+                    t[2].cast<std::vector<size_t>>(), t[3].cast<std::vector<size_t>>(),
+                    t[4].cast<std::vector<size_t>>(), t[5].cast<std::vector<size_t>>());
+                pybind11::tuple pad = t[6].cast<pybind11::tuple>();
+                s->set_padding_mode(pad[0].cast<pad_mode::Mode>(), pad[1].cast<double>());
+                return s;
+            }));
+    declare_padding_mode(session);
+}
+
+/**
+ * @brief Declares a PatchMajorReader class
+ */
+template <typename T>
+void declare_patch_major(pybind11::module &m, const std::string &name) {
+    pybind11::class_<PatchMajorReader<T>>(m, name.c_str())
+        .def(pybind11::init<const std::string &, const std::vector<size_t> &>(),
+             pybind11::arg("fpath"), pybind11::arg("qidx") = pybind11::tuple(),
+             "Open a patch-major file written by convert_to_patch_major. qidx selects a subset "
+             "of the stored qspace indices, all are read when empty")
+        .def(
+            "get_patch",
+            [](PatchMajorReader<T> &r, size_t pnum) {
+                pybind11::array_t<T> out(patch_array_shape(r.get_qidx(), r.get_pshape()));
+                T *ptr = out.mutable_data();
+                {
+                    pybind11::gil_scoped_release release;
+                    r.get_patch_into(pnum, ptr);
+                }
+                return out;
+            },
+            pybind11::arg("pnum"),
+            "Read a patch, with one positional read per run of consecutive stored qspace indices")
+        .def(
+            "get_patches",
+            [](PatchMajorReader<T> &r, const std::vector<size_t> &pnums, size_t num_threads) {
+                std::vector<size_t> shape = patch_array_shape(r.get_qidx(), r.get_pshape());
+                shape.insert(shape.begin(), pnums.size());
+                pybind11::array_t<T> out(shape);
+                T *ptr = out.mutable_data();
+                {
+                    pybind11::gil_scoped_release release;
+                    r.get_patches_into(pnums, ptr, num_threads);
+                }
+                return out;
+            },
+            pybind11::arg("pnums"), pybind11::arg("num_threads") = 1,
+            "Read a batch of patches into one array, consecutive patch numbers are read together "
+            "when all stored qspace indices are read. Use num_threads to spread the batch over a "
+            "pool of worker threads, 0 uses all hardware threads")
+        .def("get_patch_offset", &PatchMajorReader<T>::get_patch_offset, pybind11::arg("pnum"),
+             "Get the file offset of a patch")
+        .def("get_num_reads", &PatchMajorReader<T>::get_num_reads,
+             "Get the number of positional reads per patch")
+        .def("get_patch_size", &PatchMajorReader<T>::get_patch_size, "Get the total patch size")
+        .def("get_qidx", &PatchMajorReader<T>::get_qidx, "Get the qspace indices read")
+        .def("get_stored_qidx", &PatchMajorReader<T>::get_stored_qidx,
+             "Get the qspace indices stored in the file")
+        .def("get_pshape", &PatchMajorReader<T>::get_pshape, "Get the patch shape")
+        .def("get_pstride", &PatchMajorReader<T>::get_pstride, "Get the patch stride")
+        .def("get_data_shape", &PatchMajorReader<T>::get_data_shape, "Get the data shape")
+        .def("get_padding", &PatchMajorReader<T>::get_padding, "Get padding list")
+        .def("get_num_patches", &PatchMajorReader<T>::get_num_patches,
+             "Get the maximum number of patches in each dimension")
+        .def(pybind11::pickle(
+            [](const PatchMajorReader<T> &r) {
+                return pybind11::make_tuple(r.get_filepath(), r.get_qidx_arg());
+            },
+            [](pybind11::tuple t) {
+                return std::make_unique<PatchMajorReader<T>>(t[0].cast<std::string>(),
+                                                             t[1].cast<std::vector<size_t>>());
+            }));
+    m.def(
+        "convert_to_patch_major",
+        [](PatcherSession<T> &session, const std::string &fpath, size_t num_threads) {
+            pybind11::gil_scoped_release release;
+            patch_major::convert(session, fpath, num_threads);
+        },
+        pybind11::arg("session"), pybind11::arg("fpath"), pybind11::arg("num_threads") = 1,
+        "Write every patch of session into a patch-major file, each patch stored contiguously "
+        "and already padded. The padding mode & normalization of session are applied once here");
+}
 
 PYBIND11_MODULE(npy_patcher, m) {
+    pybind11::enum_<reader::ReadMode>(m, "ReadMode", "Backend used to read patch data")
+        .value("stream", reader::ReadMode::stream, "Read via std::ifstream")
+        .value("mmap", reader::ReadMode::mmap, "Copy directly from a memory mapping of the file")
+        .value("pread", reader::ReadMode::pread,
+               "Positional reads on one descriptor, allows concurrent get_patch calls")
+        .value("cached", reader::ReadMode::cached,
+               "Read via the process wide block cache, shared by all sessions on the same file")
+        .value("uring", reader::ReadMode::uring,
+               "Submit the reads of a batch together with io_uring, falls back to pread if "
+               "io_uring is not available")
+        .value("direct", reader::ReadMode::direct,
+               "Direct I/O (O_DIRECT) bypassing the page cache, reads are aligned to 4 KiB");
+
+    pybind11::enum_<reader::AccessHint>(m, "AccessHint", "Expected access pattern of patch reads")
+        .value("normal", reader::AccessHint::normal, "Default kernel readahead")
+        .value("sequential", reader::AccessHint::sequential,
+               "Sweeps over the file, e.g. the grid iterator, readahead is increased")
+        .value("random", reader::AccessHint::random,
+               "Random patch sampling, readahead is disabled")
+        .value("willneed", reader::AccessHint::willneed,
+               "Read the whole file into the page cache ahead of time");
+
+    pybind11::enum_<pad_mode::Mode>(m, "PadMode", "How padded regions of a patch are filled")
+        .value("constant", pad_mode::Mode::constant, "Fill with a constant value")
+        .value("edge", pad_mode::Mode::edge, "Repeat the edge value of the data")
+        .value("reflect", pad_mode::Mode::reflect,
+               "Mirror the data about the edge value, as np.pad mode='reflect'")
+        .value("symmetric", pad_mode::Mode::symmetric,
+               "Mirror the data including the edge value, as np.pad mode='symmetric'")
+        .value("wrap", pad_mode::Mode::wrap, "Wrap around to the opposite edge of the data");
+
+    m.def("io_uring_available", &reader::uring_available,
+          "Check whether io_uring is supported, otherwise ReadMode.uring falls back to pread");
+
+    pybind11::enum_<block_cache::Policy>(m, "CachePolicy", "Block cache eviction policy")
+        .value("lru", block_cache::Policy::lru, "Evict the least recently used block")
+        .value("clock", block_cache::Policy::clock, "Evict using the CLOCK approximation of LRU");
+
+    m.def(
+        "get_header_cache_stats",
+        []() {
+            header_cache::CacheStats stats = header_cache::get_stats();
+            pybind11::dict out;
+            out["hits"] = stats.hits;
+            out["misses"] = stats.misses;
+            out["size"] = stats.size;
+            out["capacity"] = stats.capacity;
+            return out;
+        },
+        "Get the number of npy headers served from the process wide header cache (hits), "
+        "parsed from file (misses), currently cached, and the cache capacity");
+    m.def("set_header_cache_capacity", &header_cache::set_capacity, pybind11::arg("capacity"),
+          "Set the maximum number of cached npy headers, 0 disables the cache");
+    m.def("clear_header_cache", &header_cache::clear,
+          "Remove all cached npy headers and reset the statistics");
+
+    m.def(
+        "set_block_cache",
+        [](size_t budget, size_t block_size, block_cache::Policy policy) {
+            block_cache::get_cache().configure(budget, block_size, policy);
+        },
+        pybind11::arg("budget"), pybind11::arg("block_size") = block_cache::default_block_size,
+        pybind11::arg("policy") = block_cache::Policy::lru,
+        "Set the memory budget in bytes, block size and eviction policy of the block cache used "
+        "by ReadMode.cached, dropping all cached blocks. A budget of 0 disables the cache");
+    m.def(
+        "get_block_cache_stats",
+        []() {
+            block_cache::CacheStats stats = block_cache::get_cache().get_stats();
+            pybind11::dict out;
+            out["hits"] = stats.hits;
+            out["misses"] = stats.misses;
+            out["evictions"] = stats.evictions;
+            out["size"] = stats.size;
+            out["budget"] = stats.budget;
+            out["block_size"] = stats.block_size;
+            return out;
+        },
+        "Get the number of block reads served from the block cache (hits), read from file "
+        "(misses), evicted blocks, cached bytes, memory budget and block size");
+    m.def(
+        "clear_block_cache", []() { block_cache::get_cache().clear(); },
+        "Drop all cached blocks and reset the statistics");
+
+    m.def(
+        "convert_to_chunk_store",
+        [](const std::string &fpath, const std::string &store_fpath,
+           const std::vector<size_t> &chunk_shape, const std::vector<size_t> &chunk_offset,
+           bool shuffle) {
+            pybind11::gil_scoped_release release;
+            chunk_store::convert(fpath, store_fpath, chunk_shape, chunk_offset, shuffle);
+        },
+        pybind11::arg("fpath"), pybind11::arg("store_fpath"), pybind11::arg("chunk_shape"),
+        pybind11::arg("chunk_offset") = pybind11::tuple(), pybind11::arg("shuffle") = true,
+        "Convert an npy file into a chunked store, each qspace index is split into chunks of "
+        "chunk_shape compressed with LZ4. Chunk boundaries lie at multiples of chunk_shape minus "
+        "chunk_offset. shuffle groups the bytes of each element before compressing");
+    m.def(
+        "set_chunk_cache",
+        [](size_t budget) { chunk_store::get_cache().configure(budget); },
+        pybind11::arg("budget"),
+        "Set the memory budget in bytes of the decompressed chunk cache used by chunked stores, "
+        "evicting the least recently used chunks beyond it. A budget of 0 disables the cache");
+    m.def(
+        "get_chunk_cache_stats",
+        []() {
+            chunk_store::CacheStats stats = chunk_store::get_cache().get_stats();
+            pybind11::dict out;
+            out["hits"] = stats.hits;
+            out["misses"] = stats.misses;
+            out["evictions"] = stats.evictions;
+            out["size"] = stats.size;
+            out["budget"] = stats.budget;
+            return out;
+        },
+        "Get the number of chunks served from the chunk cache (hits), decompressed from file "
+        "(misses), evicted chunks, cached bytes and memory budget");
+    m.def(
+        "clear_chunk_cache", []() { chunk_store::get_cache().clear(); },
+        "Drop all cached chunks and reset the statistics");
+
     pybind11::class_<Patcher<double>>(m, "PatcherDouble")
         .def(pybind11::init<>())
         .def("get_data_shape", &Patcher<double>::get_data_shape, "Get the data shape")
@@ -15,12 +723,18 @@ PYBIND11_MODULE(npy_patcher, m) {
              pybind11::arg("qidx"), pybind11::arg("pshape"), pybind11::arg("pstride"),
              pybind11::arg("pnum"), pybind11::arg("padding") = pybind11::tuple(),
              pybind11::arg("pnum_offset") = pybind11::tuple(), "Initialise vars for debug")
-        .def("get_patch", &Patcher<double>::get_patch, pybind11::arg("fpath"),
+        .def("get_patch", &get_patch_array<double>, pybind11::arg("fpath"),
              pybind11::arg("qidx"), pybind11::arg("pshape"), pybind11::arg("pstride"),
              pybind11::arg("pnum"), pybind11::arg("padding") = pybind11::tuple(),
              pybind11::arg("pnum_offset") = pybind11::tuple(),
              "Read a patch from file, padding is automatically calculated to ensure valid "
              "extraction. Use padding parameter to add additional padding to object")
+        .def("get_patches", &get_patches_array<double>, pybind11::arg("fpath"),
+             pybind11::arg("qidx"), pybind11::arg("pshape"), pybind11::arg("pstride"),
+             pybind11::arg("pnums"), pybind11::arg("padding") = pybind11::tuple(),
+             pybind11::arg("pnum_offset") = pybind11::tuple(),
+             "Read a batch of patches from file into one array, the file is opened and "
+             "padding is calculated once for the whole batch")
         .def("get_data_strides", &Patcher<double>::get_data_strides, "Get the data strides")
         .def("get_patch_numbers", &Patcher<double>::get_patch_numbers,
              "Get the patch index in each dimension")
@@ -31,11 +745,9 @@ PYBIND11_MODULE(npy_patcher, m) {
         .def("get_stream_start", &Patcher<double>::get_stream_start,
              "Get the patch starting position in stream")
         .def("get_padding", &Patcher<double>::get_padding, "Get padding list")
-        .def(pybind11::pickle([](const Patcher<double> &p) { return pybind11::make_tuple(); },
-                              [](pybind11::tuple t) {
-                                  Patcher<double> p;
-                                  return p;
-                              }));
+        .def(pybind11::pickle(
+            [](const Patcher<double> &p) { return pybind11::make_tuple(); },
+            [](pybind11::tuple t) { return std::make_unique<Patcher<double>>(); }));
 
     pybind11::class_<Patcher<float>>(m, "PatcherFloat")
         .def(pybind11::init<>())
@@ -44,12 +756,18 @@ PYBIND11_MODULE(npy_patcher, m) {
              pybind11::arg("qidx"), pybind11::arg("pshape"), pybind11::arg("pstride"),
              pybind11::arg("pnum"), pybind11::arg("padding") = pybind11::tuple(),
              pybind11::arg("pnum_offset") = pybind11::tuple(), "Initialise vars for debug")
-        .def("get_patch", &Patcher<float>::get_patch, pybind11::arg("fpath"), pybind11::arg("qidx"),
+        .def("get_patch", &get_patch_array<float>, pybind11::arg("fpath"), pybind11::arg("qidx"),
              pybind11::arg("pshape"), pybind11::arg("pstride"), pybind11::arg("pnum"),
              pybind11::arg("padding") = pybind11::tuple(),
              pybind11::arg("pnum_offset") = pybind11::tuple(),
              "Read a patch from file, padding is automatically calculated to ensure valid "
              "extraction. Use padding parameter to add additional padding to object")
+        .def("get_patches", &get_patches_array<float>, pybind11::arg("fpath"),
+             pybind11::arg("qidx"), pybind11::arg("pshape"), pybind11::arg("pstride"),
+             pybind11::arg("pnums"), pybind11::arg("padding") = pybind11::tuple(),
+             pybind11::arg("pnum_offset") = pybind11::tuple(),
+             "Read a batch of patches from file into one array, the file is opened and "
+             "padding is calculated once for the whole batch")
         .def("get_data_strides", &Patcher<float>::get_data_strides, "Get the data strides")
         .def("get_patch_numbers", &Patcher<float>::get_patch_numbers,
              "Get the patch index in each dimension")
@@ -60,11 +778,9 @@ PYBIND11_MODULE(npy_patcher, m) {
         .def("get_stream_start", &Patcher<float>::get_stream_start,
              "Get the patch starting position in stream")
         .def("get_padding", &Patcher<float>::get_padding, "Get padding list")
-        .def(pybind11::pickle([](const Patcher<float> &p) { return pybind11::make_tuple(); },
-                              [](pybind11::tuple t) {
-                                  Patcher<float> p;
-                                  return p;
-                              }));
+        .def(pybind11::pickle(
+            [](const Patcher<float> &p) { return pybind11::make_tuple(); },
+            [](pybind11::tuple t) { return std::make_unique<Patcher<float>>(); }));
 
     pybind11::class_<Patcher<int>>(m, "PatcherInt")
         .def(pybind11::init<>())
@@ -73,12 +789,18 @@ PYBIND11_MODULE(npy_patcher, m) {
              pybind11::arg("pshape"), pybind11::arg("pstride"), pybind11::arg("pnum"),
              pybind11::arg("padding") = pybind11::tuple(),
              pybind11::arg("pnum_offset") = pybind11::tuple(), "Initialise vars for debug")
-        .def("get_patch", &Patcher<int>::get_patch, pybind11::arg("fpath"), pybind11::arg("qidx"),
+        .def("get_patch", &get_patch_array<int>, pybind11::arg("fpath"), pybind11::arg("qidx"),
              pybind11::arg("pshape"), pybind11::arg("pstride"), pybind11::arg("pnum"),
              pybind11::arg("padding") = pybind11::tuple(),
              pybind11::arg("pnum_offset") = pybind11::tuple(),
              "Read a patch from file, padding is automatically calculated to ensure valid "
              "extraction. Use padding parameter to add additional padding to object")
+        .def("get_patches", &get_patches_array<int>, pybind11::arg("fpath"),
+             pybind11::arg("qidx"), pybind11::arg("pshape"), pybind11::arg("pstride"),
+             pybind11::arg("pnums"), pybind11::arg("padding") = pybind11::tuple(),
+             pybind11::arg("pnum_offset") = pybind11::tuple(),
+             "Read a batch of patches from file into one array, the file is opened and "
+             "padding is calculated once for the whole batch")
         .def("get_data_strides", &Patcher<int>::get_data_strides, "Get the data strides")
         .def("get_patch_numbers", &Patcher<int>::get_patch_numbers,
              "Get the patch index in each dimension")
@@ -89,11 +811,9 @@ PYBIND11_MODULE(npy_patcher, m) {
         .def("get_stream_start", &Patcher<int>::get_stream_start,
              "Get the patch starting position in stream")
         .def("get_padding", &Patcher<int>::get_padding, "Get padding list")
-        .def(pybind11::pickle([](const Patcher<int> &p) { return pybind11::make_tuple(); },
-                              [](pybind11::tuple t) {
-                                  Patcher<int> p;
-                                  return p;
-                              }));
+        .def(pybind11::pickle(
+            [](const Patcher<int> &p) { return pybind11::make_tuple(); },
+            [](pybind11::tuple t) { return std::make_unique<Patcher<int>>(); }));
 
     pybind11::class_<Patcher<int64_t>>(m, "PatcherLong")
         .def(pybind11::init<>())
@@ -102,12 +822,18 @@ PYBIND11_MODULE(npy_patcher, m) {
              pybind11::arg("qidx"), pybind11::arg("pshape"), pybind11::arg("pstride"),
              pybind11::arg("pnum"), pybind11::arg("padding") = pybind11::tuple(),
              pybind11::arg("pnum_offset") = pybind11::tuple(), "Initialise vars for debug")
-        .def("get_patch", &Patcher<int64_t>::get_patch, pybind11::arg("fpath"),
+        .def("get_patch", &get_patch_array<int64_t>, pybind11::arg("fpath"),
              pybind11::arg("qidx"), pybind11::arg("pshape"), pybind11::arg("pstride"),
-             pybind11::arg("pnum") = pybind11::tuple(), pybind11::arg("padding"),
+             pybind11::arg("pnum"), pybind11::arg("padding") = pybind11::tuple(),
              pybind11::arg("pnum_offset") = pybind11::tuple(),
              "Read a patch from file, padding is automatically calculated to ensure valid "
              "extraction. Use padding parameter to add additional padding to object")
+        .def("get_patches", &get_patches_array<int64_t>, pybind11::arg("fpath"),
+             pybind11::arg("qidx"), pybind11::arg("pshape"), pybind11::arg("pstride"),
+             pybind11::arg("pnums"), pybind11::arg("padding") = pybind11::tuple(),
+             pybind11::arg("pnum_offset") = pybind11::tuple(),
+             "Read a batch of patches from file into one array, the file is opened and "
+             "padding is calculated once for the whole batch")
         .def("get_data_strides", &Patcher<int64_t>::get_data_strides, "Get the data strides")
         .def("get_patch_numbers", &Patcher<int64_t>::get_patch_numbers,
              "Get the patch index in each dimension")
@@ -118,9 +844,66 @@ PYBIND11_MODULE(npy_patcher, m) {
         .def("get_stream_start", &Patcher<int64_t>::get_stream_start,
              "Get the patch starting position in stream")
         .def("get_padding", &Patcher<int64_t>::get_padding, "Get padding list")
-        .def(pybind11::pickle([](const Patcher<int64_t> &p) { return pybind11::make_tuple(); },
-                              [](pybind11::tuple t) {
-                                  Patcher<int64_t> p;
-                                  return p;
-                              }));
+        .def(pybind11::pickle(
+            [](const Patcher<int64_t> &p) { return pybind11::make_tuple(); },
+            [](pybind11::tuple t) { return std::make_unique<Patcher<int64_t>>(); }));
+
+    declare_session<double>(m, "PatcherSessionDouble");
+    declare_session<float>(m, "PatcherSessionFloat");
+    declare_session<int>(m, "PatcherSessionInt");
+    declare_session<int64_t>(m, "PatcherSessionLong");
+
+    declare_grid<double>(m, "GridIteratorDouble");
+    declare_grid<float>(m, "GridIteratorFloat");
+    declare_grid<int>(m, "GridIteratorInt");
+    declare_grid<int64_t>(m, "GridIteratorLong");
+
+    declare_prefetcher<double>(m, "PrefetcherDouble");
+    declare_prefetcher<float>(m, "PrefetcherFloat");
+    declare_prefetcher<int>(m, "PrefetcherInt");
+    declare_prefetcher<int64_t>(m, "PrefetcherLong");
+
+    declare_sampler<double>(m, "PatchSamplerDouble");
+    declare_sampler<float>(m, "PatchSamplerFloat");
+    declare_sampler<int>(m, "PatchSamplerInt");
+    declare_sampler<int64_t>(m, "PatchSamplerLong");
+
+    declare_chunk_store<double>(m, "ChunkStoreSessionDouble");
+    declare_chunk_store<float>(m, "ChunkStoreSessionFloat");
+    declare_chunk_store<int>(m, "ChunkStoreSessionInt");
+    declare_chunk_store<int64_t>(m, "ChunkStoreSessionLong");
+
+    declare_patch_major<double>(m, "PatchMajorReaderDouble");
+    declare_patch_major<float>(m, "PatchMajorReaderFloat");
+    declare_patch_major<int>(m, "PatchMajorReaderInt");
+    declare_patch_major<int64_t>(m, "PatchMajorReaderLong");
+
+    pybind11::class_<sampler::LocalShuffle> shuffle(
+        m, "LocalShuffle", "Locality preserving epoch shuffle of the patches of a session");
+    declare_local_shuffle_init<double>(shuffle);
+    declare_local_shuffle_init<float>(shuffle);
+    declare_local_shuffle_init<int>(shuffle);
+    declare_local_shuffle_init<int64_t>(shuffle);
+    shuffle
+        .def(
+            "get_epoch",
+            [](const sampler::LocalShuffle &s, uint64_t epoch, size_t worker, size_t num_workers) {
+                std::vector<size_t> pnums = s.get_epoch(epoch, worker, num_workers);
+                std::vector<size_t> shape{pnums.size()};
+                return as_array(std::move(pnums), shape);
+            },
+            pybind11::arg("epoch"), pybind11::arg("worker") = 0, pybind11::arg("num_workers") = 1,
+            "Get the patch numbers of an epoch, the contiguous shard of worker out of "
+            "num_workers")
+        .def("bytes_seeked", &sampler::LocalShuffle::bytes_seeked, pybind11::arg("pnums"),
+             "Get the bytes seeked reading patches in the given order, the sum of the distances "
+             "between the start offsets of consecutive patches")
+        .def("expected_bytes_seeked", &sampler::LocalShuffle::expected_bytes_seeked,
+             pybind11::arg("num_epochs") = 4,
+             "Estimate the bytes seeked per epoch, averaged over the first num_epochs epochs")
+        .def("__len__", &sampler::LocalShuffle::size)
+        .def("get_partition_size", &sampler::LocalShuffle::get_partition_size,
+             "Get the number of patches in each partition")
+        .def("get_window", &sampler::LocalShuffle::get_window,
+             "Get the number of patches shuffled together");
 }
@@ -0,0 +1,256 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>  // std::max, std::stable_sort
+#include <cstring>    // std::memcpy, std::memset
+
+#include "src/byte_swap.hpp"
+#include "src/read_plan.hpp"
+
+
+namespace read_plan {
+
+
+void ReadPlan::clear() {
+    runs.clear();
+    reads.clear();
+    fills.clear();
+    rows = 0;
+}
+
+
+/**
+ * @brief Sets the element sizes in the file and in the patch, these differ when the datatype
+ *      is converted during execution. Must be set before adding runs.
+ *
+ * @param in Element size in file
+ * @param out Element size in patch
+ */
+void ReadPlan::set_element_sizes(size_t in, size_t out) {
+    in_size = in;
+    out_size = out;
+}
+
+
+/**
+ * @brief Gets the number of patch bytes a number of file bytes are converted into
+ */
+size_t ReadPlan::out_length(size_t length) const {
+    return (in_size == out_size) ? length : (length / in_size) * out_size;
+}
+
+
+/**
+ * @brief Adds a row to the plan, merging with the previous run if contiguous in both the
+ *      file and the patch.
+ *
+ * @param offset Byte offset within file
+ * @param length Number of bytes
+ * @param dest Byte offset within patch
+ */
+void ReadPlan::add_run(size_t offset, size_t length, size_t dest) {
+    rows++;
+    if (!runs.empty()) {
+        Run& last = runs.back();
+        if ((last.offset + last.length == offset) &&
+            (last.dest + out_length(last.length) == dest)) {
+            last.length += length;
+            return;
+        }
+    }
+    runs.push_back({offset, length, dest});
+}
+
+
+/**
+ * @brief Groups runs into reads. Runs are sorted by file offset, such that rows read more
+ *      than once (e.g. the source rows of reflected padding) and rows of unsorted qspace
+ *      indices are read in file order. Consecutive runs that overlap, or are separated by at
+ *      most max_gap bytes in the file, are read together and the gap is discarded. Must be
+ *      called after set_fills, which requires runs in patch order.
+ *
+ * @param max_gap Largest gap, in bytes, to read over rather than seek past
+ */
+void ReadPlan::coalesce(size_t max_gap) {
+    std::stable_sort(runs.begin(), runs.end(),
+                     [](const Run& a, const Run& b) { return a.offset < b.offset; });
+    reads.clear();
+    for (size_t i = 0; i < runs.size(); i++) {
+        const Run& run = runs[i];
+        if (!reads.empty()) {
+            // Relative to the read, offsets before the plan base wrap around
+            Read& last = reads.back();
+            size_t start = run.offset - last.offset;
+            size_t end = start + run.length;
+            if ((start <= last.length + max_gap) && (end <= max_read_length)) {
+                last.length = std::max(last.length, end);
+                last.num_runs++;
+                continue;
+            }
+        }
+        reads.push_back({run.offset, run.length, i, 1});
+    }
+}
+
+
+/**
+ * @brief Sets the patch bytes not covered by any run, these are filled on execution such
+ *      that the output buffer need not be initialised. Runs must be in patch order.
+ *
+ * @param patch_bytes Size of the patch in bytes
+ */
+void ReadPlan::set_fills(size_t patch_bytes) {
+    fills.clear();
+    size_t cursor = 0;
+    for (const Run& run : runs) {
+        if (run.dest > cursor) {
+            fills.push_back({cursor, run.dest - cursor});
+        }
+        cursor = run.dest + out_length(run.length);
+    }
+    if (patch_bytes > cursor) {
+        fills.push_back({cursor, patch_bytes - cursor});
+    }
+}
+
+
+/**
+ * @brief Fills the patch bytes not covered by any run, with the fill value of the transform
+ *      or zeros if unset
+ *
+ * @param out Patch buffer
+ * @param transform Transform giving the fill value
+ */
+void ReadPlan::fill(char* out, const Transform& transform) const {
+    for (const Fill& span : fills) {
+        if (transform.fill == nullptr) {
+            std::memset(out + span.dest, 0, span.length);
+            continue;
+        }
+        for (size_t i = 0; i < span.length; i += transform.fill_size) {
+            std::memcpy(out + span.dest + i, transform.fill, transform.fill_size);
+        }
+    }
+}
+
+
+/**
+ * @brief Executes the plan, single run reads go directly into the patch, reads spanning
+ *      multiple runs go through the scratch buffer. For data in non-native byte order,
+ *      each run is byte swapped in place once read, while still in cache. When converting
+ *      the datatype, a single run read goes into the tail of its span within the patch and
+ *      is converted front to back in place, as conversions only widen, each element is loaded
+ *      before its bytes are overwritten. Reads spanning multiple runs are byte swapped as a
+ *      whole in the scratch buffer, since runs of edge padding or repeated qspace indices may
+ *      overlap within it, and each run is converted as it is copied into the patch. Once a run
+ *      is in the patch it is normalized in place, while still in cache.
+ *
+ * @param rdr Reader to read with
+ * @param base Byte offset added to every file offset in the plan
+ * @param out Patch buffer
+ * @param scratch Scratch buffer, resized as needed
+ * @param transform Byte swap, datatype conversion, normalization & fill value to apply
+ */
+void ReadPlan::execute(reader::Reader& rdr, size_t base, char* out, std::vector<char>& scratch,
+                       const Transform& transform) const {
+    const size_t swap_size = transform.swap_size;
+    const convert::Kernel kernel = transform.kernel;
+    const normalize::Normalizer* norm = transform.norm;
+    const bool in_place = (kernel == nullptr) || (out_size >= in_size);
+    fill(out, transform);
+    for (const Read& read : reads) {
+        if ((read.num_runs == 1) && in_place) {
+            const Run& run = runs[read.first_run];
+            const size_t length = out_length(run.length);
+            char* dest = out + run.dest + (length - run.length);
+            rdr.read(dest, base + run.offset, run.length);
+            if (swap_size > 0) {
+                byte_swap::swap_in_place(dest, run.length, swap_size);
+            }
+            if (kernel != nullptr) {
+                kernel(dest, out + run.dest, run.length / in_size);
+            }
+            if (norm != nullptr) {
+                norm->apply(out, run.dest, length);
+            }
+            continue;
+        }
+        scratch.resize(std::max(scratch.size(), read.length));
+        rdr.read(scratch.data(), base + read.offset, read.length);
+        if (kernel != nullptr) {
+            if (swap_size > 0) {
+                byte_swap::swap_in_place(scratch.data(), read.length, swap_size);
+            }
+            for (size_t i = read.first_run; i < read.first_run + read.num_runs; i++) {
+                const char* src = scratch.data() + (runs[i].offset - read.offset);
+                kernel(src, out + runs[i].dest, runs[i].length / in_size);
+                if (norm != nullptr) {
+                    norm->apply(out, runs[i].dest, out_length(runs[i].length));
+                }
+            }
+            continue;
+        }
+        for (size_t i = read.first_run; i < read.first_run + read.num_runs; i++) {
+            std::memcpy(out + runs[i].dest, scratch.data() + (runs[i].offset - read.offset),
+                        runs[i].length);
+            if (swap_size > 0) {
+                byte_swap::swap_in_place(out + runs[i].dest, runs[i].length, swap_size);
+            }
+            if (norm != nullptr) {
+                norm->apply(out, runs[i].dest, runs[i].length);
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Adds the runs of the plan to a batch of reads, such that the reads of many patches
+ *      can be submitted together. Each run is read directly into the patch, the zero fill
+ *      spans must be filled separately.
+ *
+ * @param base Byte offset added to every file offset in the plan
+ * @param out Patch buffer
+ * @param requests Batch of reads to add to
+ */
+void ReadPlan::add_requests(size_t base, char* out,
+                            std::vector<reader::ReadRequest>& requests) const {
+    for (const Run& run : runs) {
+        requests.push_back({out + run.dest, base + run.offset, run.length});
+    }
+}
+
+
+/**
+ * @brief Gets the plan statistics
+ *
+ * @return PlanStats Number of rows, runs & reads, patch bytes and bytes read from file
+ */
+PlanStats ReadPlan::stats() const {
+    PlanStats out{rows, runs.size(), reads.size(), 0, 0};
+    for (const Run& run : runs) {
+        out.bytes += run.length;
+    }
+    for (const Read& read : reads) {
+        out.read_bytes += read.length;
+    }
+    return out;
+}
+
+
+const std::vector<Run>& ReadPlan::get_runs() const {
+    return runs;
+}
+
+
+const std::vector<Read>& ReadPlan::get_reads() const {
+    return reads;
+}
+
+
+const std::vector<Fill>& ReadPlan::get_fills() const {
+    return fills;
+}
+
+}  // namespace read_plan
@@ -0,0 +1,82 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef READ_PLAN_HPP_
+#define READ_PLAN_HPP_
+
+#include <vector>  // std::vector
+
+#include "src/convert.hpp"
+#include "src/normalize.hpp"
+#include "src/reader.hpp"
+
+namespace read_plan {
+
+// Upper bound of a read spanning multiple runs, bounds the scratch buffer size
+constexpr size_t max_read_length = 1 << 22;
+
+// Contiguous bytes within the file, copied to contiguous bytes within the patch. The length
+// is in file bytes, which differs from the patch bytes when the datatype is converted
+struct Run {
+    size_t offset, length, dest;
+};
+
+// Single read covering one or more runs, including the gaps between them
+struct Read {
+    size_t offset, length, first_run, num_runs;
+};
+
+// Bytes within the patch that lie in the constant padded region, set to the fill value
+struct Fill {
+    size_t dest, length;
+};
+
+// Number of rows requested, and the runs and reads they were coalesced into
+struct PlanStats {
+    size_t rows, runs, reads, bytes, read_bytes;
+};
+
+// Transforms applied as the plan is executed, each is skipped when unset
+struct Transform {
+    size_t swap_size = 0;                         // element size to byte swap
+    convert::Kernel kernel = nullptr;             // datatype conversion
+    const normalize::Normalizer *norm = nullptr;  // per channel normalization
+    const char *fill = nullptr;                   // fill value of fill_size bytes, else zeros
+    size_t fill_size = 0;
+};
+
+/**
+ * @brief List of reads needed to extract a patch. Rows are added in patch order, rows that
+ *      are contiguous both in the file and in the patch are merged into a single run. Runs
+ *      are then sorted by file offset, and runs that overlap or are separated by small gaps
+ *      are grouped into a single read, discarding the gaps.
+ *      File offsets may be relative, a base offset is then added when executing the plan.
+ */
+class ReadPlan {
+  private:
+    std::vector<Run> runs;
+    std::vector<Read> reads;
+    std::vector<Fill> fills;
+    size_t rows = 0, in_size = 1, out_size = 1;
+    size_t out_length(size_t) const;
+
+  public:
+    void clear();
+    void set_element_sizes(size_t, size_t);
+    void add_run(size_t, size_t, size_t);
+    void coalesce(size_t);
+    void set_fills(size_t);
+    void fill(char *, const Transform & = Transform()) const;
+    void execute(reader::Reader &, size_t, char *, std::vector<char> &,
+                 const Transform & = Transform()) const;
+    void add_requests(size_t, char *, std::vector<reader::ReadRequest> &) const;
+    PlanStats stats() const;
+    const std::vector<Run> &get_runs() const;
+    const std::vector<Read> &get_reads() const;
+    const std::vector<Fill> &get_fills() const;
+};
+
+}  // namespace read_plan
+
+#endif  // READ_PLAN_HPP_
@@ -0,0 +1,427 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>     // open, posix_fadvise
+#include <sys/mman.h>  // mmap, munmap, madvise
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // close, pread
+
+#include <algorithm>  // std::min
+#include <cerrno>     // errno, EINTR, EINVAL
+#include <cstdlib>    // std::free, posix_memalign
+#include <cstring>    // std::memcpy
+#include <stdexcept>  // std::runtime_error
+
+#include "src/block_cache.hpp"
+#include "src/reader.hpp"
+#include "src/uring.hpp"
+
+
+namespace reader {
+
+
+/**
+ * @brief Reads a batch of requests one at a time
+ *
+ * @param requests Reads to perform
+ */
+void Reader::read_many(const std::vector<ReadRequest>& requests) {
+    for (const ReadRequest& request : requests) {
+        read(request.buf, request.offset, request.length);
+    }
+}
+
+
+/**
+ * @brief Construct a new StreamReader object from an already opened stream, the stream
+ *      must outlive the reader.
+ *
+ * @param stream Opened file stream
+ * @param filepath Filepath the stream was opened with, reopened to advise the kernel
+ */
+StreamReader::StreamReader(std::ifstream& stream, const std::string& filepath)
+    : stream(stream), cursor(-1), filepath(filepath), advice_fd(-1) {}
+
+
+/**
+ * @brief Construct a new StreamReader object that opens, and owns, its own stream.
+ *
+ * @param filepath Filepath to open
+ */
+StreamReader::StreamReader(const std::string& filepath)
+    : stream(owned_stream), cursor(-1), filepath(filepath), advice_fd(-1) {
+    owned_stream.open(filepath, std::ifstream::binary);
+    if (!owned_stream) {
+        throw std::runtime_error("IO Error: failed to open " + filepath);
+    }
+}
+
+
+StreamReader::~StreamReader() {
+    if (advice_fd >= 0) {
+        ::close(advice_fd);
+    }
+}
+
+
+/**
+ * @brief Reads bytes from the stream
+ *
+ * @param buf Destination buffer
+ * @param offset Byte offset within file
+ * @param length Number of bytes to read
+ */
+void StreamReader::read(char* buf, size_t offset, size_t length) {
+    if (offset != cursor) {
+        stream.seekg(offset, stream.beg);
+    }
+    stream.read(buf, length);
+    if (!stream) {
+        stream.clear();
+        cursor = -1;
+        throw std::runtime_error("IO Error: failed to read from stream.");
+    }
+    cursor = offset + length;
+}
+
+
+/**
+ * @brief Gets the descriptor the kernel is advised through, opening it on first use
+ *
+ * @return int File descriptor, negative if the file could not be opened
+ */
+int StreamReader::get_advice_fd() {
+    if (advice_fd < 0) {
+        advice_fd = ::open(filepath.c_str(), O_RDONLY);
+    }
+    return advice_fd;
+}
+
+
+/**
+ * @brief Advises the kernel of the access pattern of the whole file. Only willneed is passed
+ *      on, as sequential & random advice sets the readahead of the descriptor it is given on,
+ *      not that of the stream, whereas willneed reads ahead into the shared page cache.
+ *
+ * @param hint Access pattern
+ */
+void StreamReader::advise(AccessHint hint) {
+    if ((hint == AccessHint::willneed) && (get_advice_fd() >= 0)) {
+        fadvise(advice_fd, hint);
+    }
+}
+
+
+void StreamReader::will_need(size_t offset, size_t length) {
+    if (get_advice_fd() >= 0) {
+        fadvise_will_need(advice_fd, offset, length);
+    }
+}
+
+
+/**
+ * @brief Opens and memory maps file
+ *
+ * @param filepath Filepath to map
+ */
+MmapReader::MmapReader(const std::string& filepath) : fd(-1), size(0), data(nullptr) {
+    fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("IO Error: failed to open " + filepath);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("IO Error: failed to stat " + filepath);
+    }
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("IO Error: failed to memory map " + filepath);
+        }
+        data = static_cast<const char*>(addr);
+    }
+}
+
+
+MmapReader::~MmapReader() {
+    if (data != nullptr) {
+        ::munmap(const_cast<char*>(data), size);
+    }
+    ::close(fd);
+}
+
+
+/**
+ * @brief Copies bytes from the mapping
+ *
+ * @param buf Destination buffer
+ * @param offset Byte offset within file
+ * @param length Number of bytes to read
+ */
+void MmapReader::read(char* buf, size_t offset, size_t length) {
+    if ((offset > size) || (length > size - offset)) {
+        throw std::runtime_error("IO Error: read outside of memory mapped file.");
+    }
+    std::memcpy(buf, data + offset, length);
+}
+
+
+/**
+ * @brief Advises the kernel of the access pattern of the mapping
+ *
+ * @param hint Access pattern
+ */
+void MmapReader::advise(AccessHint hint) {
+    if (data == nullptr) {
+        return;
+    }
+    int advice = MADV_NORMAL;
+    switch (hint) {
+        case AccessHint::sequential:
+            advice = MADV_SEQUENTIAL;
+            break;
+        case AccessHint::random:
+            advice = MADV_RANDOM;
+            break;
+        case AccessHint::willneed:
+            advice = MADV_WILLNEED;
+            break;
+        default:
+            break;
+    }
+    ::madvise(const_cast<char*>(data), size, advice);
+}
+
+
+/**
+ * @brief Advises the kernel that a byte range of the mapping will be read soon
+ *
+ * @param offset Byte offset within file
+ * @param length Number of bytes
+ */
+void MmapReader::will_need(size_t offset, size_t length) {
+    if ((offset >= size) || (length == 0)) {
+        return;
+    }
+    static const size_t page_size = ::sysconf(_SC_PAGESIZE);
+    size_t start = offset - (offset % page_size);
+    size_t end = std::min(offset + length, size);
+    ::madvise(const_cast<char*>(data) + start, end - start, MADV_WILLNEED);
+}
+
+
+/**
+ * @brief Opens file for positional reads
+ *
+ * @param filepath Filepath to open
+ */
+PreadReader::PreadReader(const std::string& filepath) : fd(-1) {
+    fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("IO Error: failed to open " + filepath);
+    }
+}
+
+
+PreadReader::~PreadReader() {
+    ::close(fd);
+}
+
+
+/**
+ * @brief Reads bytes at offset, without using or modifying the file position
+ *
+ * @param buf Destination buffer
+ * @param offset Byte offset within file
+ * @param length Number of bytes to read
+ */
+void PreadReader::read(char* buf, size_t offset, size_t length) {
+    while (length > 0) {
+        ssize_t n = ::pread(fd, buf, length, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("IO Error: failed to read from file.");
+        }
+        if (n == 0) {
+            throw std::runtime_error("IO Error: unexpected end of file.");
+        }
+        buf += n;
+        offset += n;
+        length -= n;
+    }
+}
+
+
+void PreadReader::advise(AccessHint hint) {
+    fadvise(fd, hint);
+}
+
+
+void PreadReader::will_need(size_t offset, size_t length) {
+    fadvise_will_need(fd, offset, length);
+}
+
+
+/**
+ * @brief Opens file for direct I/O
+ *
+ * @param filepath Filepath to open
+ */
+DirectReader::DirectReader(const std::string& filepath)
+    : fd(-1), file_size(0), staging_size(0), staging(nullptr) {
+#ifdef O_DIRECT
+    fd = ::open(filepath.c_str(), O_RDONLY | O_DIRECT);
+    if ((fd < 0) && (errno == EINVAL)) {
+        throw std::runtime_error("IO Error: direct I/O is not supported by the filesystem of " +
+                                 filepath);
+    }
+#endif
+    if (fd < 0) {
+        throw std::runtime_error("IO Error: failed to open " + filepath + " for direct I/O");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("IO Error: failed to stat " + filepath);
+    }
+    file_size = static_cast<size_t>(st.st_size);
+}
+
+
+DirectReader::~DirectReader() {
+    std::free(staging);
+    ::close(fd);
+}
+
+
+/**
+ * @brief Reads the aligned range covering the requested bytes into the staging buffer, then
+ *      copies the requested bytes out.
+ *
+ * @param buf Destination buffer
+ * @param offset Byte offset within file
+ * @param length Number of bytes to read
+ */
+void DirectReader::read(char* buf, size_t offset, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    if (offset + length > file_size) {
+        throw std::runtime_error("IO Error: unexpected end of file.");
+    }
+    const size_t start = offset & ~(direct_alignment - 1);
+    const size_t end = (offset + length + direct_alignment - 1) & ~(direct_alignment - 1);
+    const size_t needed = offset + length - start;
+    if (end - start > staging_size) {
+        std::free(staging);
+        staging = nullptr;
+        if (::posix_memalign(reinterpret_cast<void**>(&staging), direct_alignment, end - start)) {
+            staging_size = 0;
+            throw std::runtime_error("Memory Error: failed to allocate direct I/O buffer.");
+        }
+        staging_size = end - start;
+    }
+    size_t got = 0;
+    while (got < needed) {
+        ssize_t n = ::pread(fd, staging + got, end - start - got, static_cast<off_t>(start + got));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("IO Error: failed to read from file.");
+        }
+        if (n == 0) {
+            throw std::runtime_error("IO Error: unexpected end of file.");
+        }
+        if ((got + n >= needed) || (start + got + n >= file_size)) {
+            got += n;
+        } else {
+            // Short read, continue from an aligned position. A read shorter than the alignment
+            // would repeat the same range, so is treated as a failure rather than retried.
+            const size_t aligned = (got + n) & ~(direct_alignment - 1);
+            if (aligned == got) {
+                throw std::runtime_error("IO Error: direct read made no progress.");
+            }
+            got = aligned;
+        }
+    }
+    std::memcpy(buf, staging + (offset - start), length);
+}
+
+
+/**
+ * @brief Advises the kernel of the access pattern of a whole file, hints are ignored where
+ *      posix_fadvise is not available.
+ *
+ * @param fd File descriptor
+ * @param hint Access pattern
+ */
+void fadvise(int fd, AccessHint hint) {
+#ifdef POSIX_FADV_NORMAL
+    int advice = POSIX_FADV_NORMAL;
+    switch (hint) {
+        case AccessHint::sequential:
+            advice = POSIX_FADV_SEQUENTIAL;
+            break;
+        case AccessHint::random:
+            advice = POSIX_FADV_RANDOM;
+            break;
+        case AccessHint::willneed:
+            advice = POSIX_FADV_WILLNEED;
+            break;
+        default:
+            break;
+    }
+    ::posix_fadvise(fd, 0, 0, advice);
+#endif
+}
+
+
+/**
+ * @brief Advises the kernel that a byte range of a file will be read soon, starting readahead
+ *
+ * @param fd File descriptor
+ * @param offset Byte offset within file
+ * @param length Number of bytes
+ */
+void fadvise_will_need(int fd, size_t offset, size_t length) {
+#ifdef POSIX_FADV_WILLNEED
+    ::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length),
+                    POSIX_FADV_WILLNEED);
+#endif
+}
+
+
+/**
+ * @brief Opens a new reader that owns its file handle
+ *
+ * @param filepath Filepath to open
+ * @param mode Read backend
+ * @return std::unique_ptr<Reader> Opened reader
+ */
+std::unique_ptr<Reader> open_reader(const std::string& filepath, ReadMode mode) {
+    switch (mode) {
+        case ReadMode::stream:
+            return std::make_unique<StreamReader>(filepath);
+        case ReadMode::mmap:
+            return std::make_unique<MmapReader>(filepath);
+        case ReadMode::pread:
+            return std::make_unique<PreadReader>(filepath);
+        case ReadMode::cached:
+            return std::make_unique<block_cache::CachedReader>(filepath);
+        case ReadMode::uring:
+            return open_uring_reader(filepath);
+        case ReadMode::direct:
+            return std::make_unique<DirectReader>(filepath);
+        default:
+            throw std::runtime_error("Unrecognised read mode.");
+    }
+}
+
+}  // namespace reader
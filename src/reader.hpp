@@ -0,0 +1,143 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef READER_HPP_
+#define READER_HPP_
+
+#include <fstream>  // std::ifstream
+#include <memory>   // std::unique_ptr
+#include <string>   // std::string
+#include <vector>   // std::vector
+
+namespace reader {
+
+// Backend used to read patch data from the npy file
+enum class ReadMode { stream, mmap, pread, cached, uring, direct };
+
+// Expected access pattern, passed to the kernel with posix_fadvise or madvise
+enum class AccessHint { normal, sequential, random, willneed };
+
+// Single read of a batch, length bytes at offset within the file are read into buf
+struct ReadRequest {
+    char *buf;
+    size_t offset, length;
+};
+
+/**
+ * @brief Reads bytes at a given offset within a file.
+ */
+class Reader {
+  public:
+    virtual ~Reader() = default;
+    virtual void read(char *, size_t, size_t) = 0;
+    // Reads a batch of requests, in any order
+    virtual void read_many(const std::vector<ReadRequest> &);
+    // Whether read_many is cheaper than the equivalent calls to read
+    virtual bool is_batched() const { return false; }
+    // Advises the kernel of the access pattern of the whole file
+    virtual void advise(AccessHint) {}
+    // Advises the kernel that a byte range will be read soon
+    virtual void will_need(size_t, size_t) {}
+    // Whether read may be called concurrently from multiple threads
+    virtual bool is_thread_safe() const { return false; }
+    // Largest gap, in bytes, that is cheaper to read over and discard than to skip
+    virtual size_t max_gap() const { return 4096; }
+};
+
+/**
+ * @brief Reads using a std::ifstream, seeking only when the requested offset is not
+ *      the current stream position. As the descriptor of the stream is not exposed, the
+ *      kernel is advised through a second descriptor, opened on first use.
+ */
+class StreamReader : public Reader {
+  private:
+    std::ifstream owned_stream;
+    std::ifstream &stream;
+    size_t cursor;
+    std::string filepath;
+    int advice_fd;
+    int get_advice_fd();
+
+  public:
+    StreamReader(std::ifstream &, const std::string &);
+    explicit StreamReader(const std::string &);
+    ~StreamReader() override;
+    StreamReader(const StreamReader &) = delete;
+    StreamReader &operator=(const StreamReader &) = delete;
+    void read(char *, size_t, size_t) override;
+    void advise(AccessHint) override;
+    void will_need(size_t, size_t) override;
+};
+
+/**
+ * @brief Maps the whole file into memory once, reads are then a memcpy from
+ *      the mapping.
+ */
+class MmapReader : public Reader {
+  private:
+    int fd;
+    size_t size;
+    const char *data;
+
+  public:
+    explicit MmapReader(const std::string &);
+    ~MmapReader() override;
+    MmapReader(const MmapReader &) = delete;
+    MmapReader &operator=(const MmapReader &) = delete;
+    void read(char *, size_t, size_t) override;
+    bool is_thread_safe() const override { return true; }
+    size_t max_gap() const override { return 0; }
+    void advise(AccessHint) override;
+    void will_need(size_t, size_t) override;
+};
+
+/**
+ * @brief Reads with positional reads (pread) on a single descriptor, such that no file
+ *      position is shared between concurrent reads.
+ */
+class PreadReader : public Reader {
+  private:
+    int fd;
+
+  public:
+    explicit PreadReader(const std::string &);
+    ~PreadReader() override;
+    PreadReader(const PreadReader &) = delete;
+    PreadReader &operator=(const PreadReader &) = delete;
+    void read(char *, size_t, size_t) override;
+    bool is_thread_safe() const override { return true; }
+    void advise(AccessHint) override;
+    void will_need(size_t, size_t) override;
+};
+
+// Alignment of direct I/O reads, in bytes
+constexpr size_t direct_alignment = 4096;
+
+/**
+ * @brief Reads with direct I/O (O_DIRECT), bypassing the page cache. Each read is rounded out
+ *      to the alignment, read into an aligned staging buffer, and only the requested bytes are
+ *      copied out.
+ */
+class DirectReader : public Reader {
+  private:
+    int fd;
+    size_t file_size, staging_size;
+    char *staging;
+
+  public:
+    explicit DirectReader(const std::string &);
+    ~DirectReader() override;
+    DirectReader(const DirectReader &) = delete;
+    DirectReader &operator=(const DirectReader &) = delete;
+    void read(char *, size_t, size_t) override;
+    size_t max_gap() const override { return 4 * direct_alignment; }
+};
+
+void fadvise(int, AccessHint);
+void fadvise_will_need(int, size_t, size_t);
+std::unique_ptr<Reader> open_reader(const std::string &, ReadMode);
+
+}  // namespace reader
+
+#endif  // READER_HPP_
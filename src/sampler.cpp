@@ -0,0 +1,343 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>  // std::min, std::stable_sort, std::swap
+#include <cmath>      // std::isfinite
+#include <numeric>    // std::iota
+#include <sstream>    // std::ostringstream
+#include <stdexcept>  // std::runtime_error
+
+#include "src/sampler.hpp"
+
+
+namespace sampler {
+
+namespace {
+
+/**
+ * @brief Fisher-Yates shuffle with the bounded draws of Rng, std::shuffle is not used as its
+ *      output differs between implementations
+ */
+template <typename It>
+void shuffle_range(It first, It last, Rng& rng) {
+    for (size_t i = static_cast<size_t>(last - first); i > 1; i--) {
+        std::swap(first[i - 1], first[rng.below(i)]);
+    }
+}
+
+
+/**
+ * @brief Advances the splitmix64 state and returns the next output
+ */
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+}  // namespace
+
+
+/**
+ * @brief Construct a new Rng object. The seed, epoch and worker are hashed together, such that
+ *      neighbouring values give unrelated streams.
+ *
+ * @param seed Random seed
+ * @param epoch Epoch number
+ * @param worker Worker id
+ */
+Rng::Rng(uint64_t seed, uint64_t epoch, uint64_t worker) {
+    uint64_t state = seed;
+    uint64_t key = splitmix64(state);
+    state = key ^ epoch;
+    key = splitmix64(state);
+    state = key ^ worker;
+    for (uint64_t& word : s) {
+        word = splitmix64(state);
+    }
+}
+
+
+uint64_t Rng::next() {
+    const uint64_t out = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return out;
+}
+
+
+/**
+ * @brief Draws an integer uniformly from [0, n) without modulo bias, by rejecting the draws
+ *      below 2^64 mod n.
+ *
+ * @param n Upper bound, greater than 0
+ * @return uint64_t Random integer
+ */
+uint64_t Rng::below(uint64_t n) {
+    const uint64_t threshold = (0 - n) % n;
+    uint64_t r = next();
+    while (r < threshold) {
+        r = next();
+    }
+    return r % n;
+}
+
+
+/**
+ * @brief Draws a double uniformly from [0, 1), using the upper 53 bits
+ */
+double Rng::uniform() {
+    return static_cast<double>(next() >> 11) * 0x1.0p-53;
+}
+
+
+/**
+ * @brief Construct a new IndexSampler object drawing uniformly from a box of the patch grid
+ *
+ * @param num_patches Number of patches in each dimension
+ * @param lower First patch index in each dimension, empty for 0
+ * @param upper Patch index past the last in each dimension, empty for num_patches
+ */
+IndexSampler::IndexSampler(const std::vector<size_t>& num_patches,
+                           const std::vector<size_t>& lower, const std::vector<size_t>& upper)
+    : lower(lower.empty() ? std::vector<size_t>(num_patches.size(), 0) : lower),
+      extent(num_patches),
+      strides(num_patches.size(), 1) {
+    const std::vector<size_t>& end = upper.empty() ? num_patches : upper;
+    if ((this->lower.size() != num_patches.size()) || (end.size() != num_patches.size())) {
+        throw std::runtime_error("Sampler bounds must have one index per patch dimension.");
+    }
+    for (size_t i = num_patches.size(); i-- > 0;) {
+        if ((this->lower[i] >= end[i]) || (end[i] > num_patches[i])) {
+            std::ostringstream oss;
+            oss << "Sampler bounds in dim " << i << " are invalid: [" << this->lower[i] << ", "
+                << end[i] << ") with " << num_patches[i] << " patches.";
+            throw std::runtime_error(oss.str());
+        }
+        extent[i] = end[i] - this->lower[i];
+        count *= extent[i];
+        if (i > 0) {
+            strides[i - 1] = strides[i] * num_patches[i];
+        }
+    }
+}
+
+
+/**
+ * @brief Construct a new IndexSampler object drawing patches in proportion to their weight.
+ *      Builds the alias table over the patches with a non-zero weight, such that patches with
+ *      zero weight are never drawn.
+ *
+ * @param num_patches Number of patches in each dimension
+ * @param weights Non-negative weight of each patch, in patch number order
+ */
+IndexSampler::IndexSampler(const std::vector<size_t>& num_patches,
+                           const std::vector<double>& weights) {
+    size_t total = 1;
+    for (size_t n : num_patches) {
+        total *= n;
+    }
+    if (weights.size() != total) {
+        std::ostringstream oss;
+        oss << "Sampler weights must have one weight per patch: " << weights.size()
+            << " given for " << total << " patches.";
+        throw std::runtime_error(oss.str());
+    }
+    double sum = 0;
+    for (size_t i = 0; i < weights.size(); i++) {
+        if (!std::isfinite(weights[i]) || (weights[i] < 0)) {
+            throw std::runtime_error("Sampler weights must be finite and non-negative.");
+        }
+        if (weights[i] > 0) {
+            indices.push_back(i);
+            sum += weights[i];
+        }
+    }
+    if (indices.empty()) {
+        throw std::runtime_error("Sampler weights must contain at least one non-zero weight.");
+    }
+    count = indices.size();
+
+    // Vose's alias method, probabilities scaled such that the mean is 1
+    probability.resize(count);
+    alias.resize(count);
+    std::vector<size_t> small, large;
+    for (size_t i = 0; i < count; i++) {
+        probability[i] = weights[indices[i]] * static_cast<double>(count) / sum;
+        (probability[i] < 1.0 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        size_t s = small.back();
+        size_t l = large.back();
+        small.pop_back();
+        alias[s] = l;
+        probability[l] -= 1.0 - probability[s];
+        if (probability[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Remaining entries are 1 up to rounding
+    for (size_t i : large) {
+        probability[i] = 1.0;
+    }
+    for (size_t i : small) {
+        probability[i] = 1.0;
+    }
+}
+
+
+/**
+ * @brief Draws a patch number
+ *
+ * @param rng Random number generator
+ * @return size_t Patch number
+ */
+size_t IndexSampler::sample(Rng& rng) const {
+    if (!indices.empty()) {
+        size_t i = static_cast<size_t>(rng.below(count));
+        if (rng.uniform() >= probability[i]) {
+            i = alias[i];
+        }
+        return indices[i];
+    }
+    size_t r = static_cast<size_t>(rng.below(count));
+    size_t pnum = 0;
+    for (size_t i = extent.size(); i-- > 0;) {
+        pnum += (lower[i] + (r % extent[i])) * strides[i];
+        r /= extent[i];
+    }
+    return pnum;
+}
+
+
+size_t IndexSampler::size() const {
+    return count;
+}
+
+
+/**
+ * @brief Construct a new LocalShuffle object
+ *
+ * @param offsets File offset at which each patch starts, in patch number order
+ * @param partition_size Number of neighbouring patches in each partition
+ * @param window Number of patches shuffled together, 1 keeps partitions in file order
+ * @param seed Random seed
+ */
+LocalShuffle::LocalShuffle(const std::vector<size_t>& offsets, size_t partition_size,
+                           size_t window, uint64_t seed)
+    : offsets(offsets),
+      sorted(offsets.size()),
+      partition_size(partition_size),
+      window(window),
+      seed(seed) {
+    if ((partition_size == 0) || (window == 0)) {
+        throw std::runtime_error("Shuffle partition size and window must be greater than 0.");
+    }
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [&](size_t a, size_t b) { return offsets[a] < offsets[b]; });
+}
+
+
+/**
+ * @brief Gets the patch numbers of an epoch. Every worker shuffles the same order, and takes
+ *      a contiguous shard of it, such that each worker also reads neighbouring patches.
+ *
+ * @param epoch Epoch number
+ * @param worker Worker id
+ * @param num_workers Number of workers
+ * @return std::vector<size_t> Patch numbers of the shard of the worker
+ */
+std::vector<size_t> LocalShuffle::get_epoch(uint64_t epoch, size_t worker,
+                                            size_t num_workers) const {
+    if (worker >= num_workers) {
+        throw std::runtime_error("Shuffle worker id must be less than the number of workers.");
+    }
+    Rng rng(seed, epoch);
+    const size_t num_partitions = (sorted.size() + partition_size - 1) / partition_size;
+    std::vector<size_t> partitions(num_partitions);
+    std::iota(partitions.begin(), partitions.end(), 0);
+    shuffle_range(partitions.begin(), partitions.end(), rng);
+
+    std::vector<size_t> order;
+    order.reserve(sorted.size());
+    for (size_t p : partitions) {
+        const size_t begin = p * partition_size;
+        const size_t end = std::min(begin + partition_size, sorted.size());
+        order.insert(order.end(), sorted.begin() + begin, sorted.begin() + end);
+    }
+    for (size_t begin = 0; begin < order.size(); begin += window) {
+        const size_t end = std::min(begin + window, order.size());
+        shuffle_range(order.begin() + begin, order.begin() + end, rng);
+    }
+
+    const size_t shard_begin = (order.size() * worker) / num_workers;
+    const size_t shard_end = (order.size() * (worker + 1)) / num_workers;
+    return std::vector<size_t>(order.begin() + shard_begin, order.begin() + shard_end);
+}
+
+
+/**
+ * @brief Gets the bytes seeked reading patches in order, the sum of the distances between the
+ *      start offsets of consecutive patches.
+ *
+ * @param pnums Patch numbers, in read order
+ * @return size_t Bytes seeked
+ */
+size_t LocalShuffle::bytes_seeked(const std::vector<size_t>& pnums) const {
+    size_t total = 0;
+    for (size_t i = 1; i < pnums.size(); i++) {
+        const size_t a = offsets.at(pnums[i - 1]);
+        const size_t b = offsets.at(pnums[i]);
+        total += (a < b) ? (b - a) : (a - b);
+    }
+    return total;
+}
+
+
+/**
+ * @brief Estimates the bytes seeked per epoch, averaged over the first epochs
+ *
+ * @param num_epochs Number of epochs to average over
+ * @return double Expected bytes seeked per epoch
+ */
+double LocalShuffle::expected_bytes_seeked(size_t num_epochs) const {
+    if (num_epochs == 0) {
+        throw std::runtime_error("Number of epochs must be greater than 0.");
+    }
+    double total = 0;
+    for (size_t epoch = 0; epoch < num_epochs; epoch++) {
+        total += static_cast<double>(bytes_seeked(get_epoch(epoch)));
+    }
+    return total / static_cast<double>(num_epochs);
+}
+
+
+size_t LocalShuffle::size() const {
+    return offsets.size();
+}
+
+
+size_t LocalShuffle::get_partition_size() const {
+    return partition_size;
+}
+
+
+size_t LocalShuffle::get_window() const {
+    return window;
+}
+
+}  // namespace sampler
@@ -0,0 +1,240 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef SAMPLER_HPP_
+#define SAMPLER_HPP_
+
+#include <cstddef>  // size_t
+#include <cstdint>  // uint64_t
+#include <vector>   // std::vector
+
+#include "src/session.hpp"
+
+namespace sampler {
+
+/**
+ * @brief xoshiro256** pseudo random number generator, seeded with splitmix64. Bounded and
+ *      floating point draws are implemented here rather than with the standard library
+ *      distributions, whose output differs between implementations, such that a seed gives
+ *      the same patches on every platform.
+ */
+class Rng {
+  private:
+    uint64_t s[4];
+
+  public:
+    Rng(uint64_t = 0, uint64_t = 0, uint64_t = 0);
+    uint64_t next();
+    uint64_t below(uint64_t);
+    double uniform();
+};
+
+/**
+ * @brief Draws patch numbers, either uniformly from a box of the patch grid, or weighted by
+ *      a per patch weight with the alias method. Each draw is O(1).
+ */
+class IndexSampler {
+  private:
+    std::vector<size_t> lower, extent, strides;
+    std::vector<size_t> indices, alias;
+    std::vector<double> probability;
+    size_t count = 1;
+
+  public:
+    IndexSampler(const std::vector<size_t> &, const std::vector<size_t> &,
+                 const std::vector<size_t> &);
+    IndexSampler(const std::vector<size_t> &, const std::vector<double> &);
+    size_t sample(Rng &) const;
+    size_t size() const;
+};
+
+/**
+ * @brief Locality preserving epoch shuffle. Patches are sorted by the file offset at which
+ *      they start, and split into partitions of neighbouring patches. Each epoch the order of
+ *      the partitions is shuffled, then patches are shuffled within windows of the resulting
+ *      sequence. Small windows read each partition almost sequentially, windows spanning
+ *      several partitions mix them at the cost of seeking between them.
+ */
+class LocalShuffle {
+  private:
+    std::vector<size_t> offsets, sorted;
+    const size_t partition_size, window;
+    const uint64_t seed;
+
+  public:
+    LocalShuffle(const std::vector<size_t> &, size_t, size_t, uint64_t);
+    std::vector<size_t> get_epoch(uint64_t, size_t = 0, size_t = 1) const;
+    size_t bytes_seeked(const std::vector<size_t> &) const;
+    double expected_bytes_seeked(size_t = 4) const;
+    size_t size() const;
+    size_t get_partition_size() const;
+    size_t get_window() const;
+};
+
+/**
+ * @brief Creates a locality preserving shuffle of the patches of a session
+ *
+ * @tparam T datatype of data found within fpath
+ * @param session session to get patch offsets from
+ * @param seed random seed
+ * @param partition_size number of neighbouring patches in each partition
+ * @param window number of patches shuffled together
+ * @return LocalShuffle Shuffle of every patch number of the session
+ */
+template <typename T>
+LocalShuffle make_local_shuffle(PatcherSession<T> &session, uint64_t seed, size_t partition_size,
+                                size_t window) {
+    size_t num_patches = 1;
+    for (size_t n : session.get_num_patches()) {
+        num_patches *= n;
+    }
+    std::vector<size_t> offsets(num_patches);
+    for (size_t pnum = 0; pnum < num_patches; pnum++) {
+        offsets[pnum] = session.get_patch_offset(pnum);
+    }
+    return LocalShuffle(offsets, partition_size, window, seed);
+}
+
+}  // namespace sampler
+
+/**
+ * @brief Samples random patches of a session with replacement. The random stream is derived
+ *      from the seed, epoch and worker, such that each worker of each epoch draws a different,
+ *      reproducible sequence of batches. Not thread safe, use one sampler per worker.
+ *
+ * @tparam T datatype of data found within fpath
+ */
+template <typename T>
+class PatchSampler {
+  private:
+    PatcherSession<T> &session;
+    const sampler::IndexSampler indices;
+    const uint64_t seed;
+    uint64_t epoch = 0, worker = 0;
+    sampler::Rng rng;
+
+  public:
+    PatchSampler(PatcherSession<T> &, uint64_t, const std::vector<size_t> & = {},
+                 const std::vector<size_t> & = {});
+    PatchSampler(PatcherSession<T> &, uint64_t, const std::vector<double> &);
+    void set_epoch(uint64_t, uint64_t = 0);
+    std::vector<size_t> sample_pnums(size_t);
+    std::vector<size_t> sample_into(size_t, T *, size_t = 1);
+    uint64_t get_seed() const;
+    uint64_t get_epoch() const;
+    uint64_t get_worker() const;
+    size_t size() const;
+    const PatcherSession<T> &get_session() const;
+};
+
+/**
+ * @brief Construct a new PatchSampler object, drawing uniformly from the patches within the
+ *      bounds.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param session session to extract patches with, must outlive the sampler
+ * @param seed random seed
+ * @param lower first patch index in each dimension, empty for the first patch
+ * @param upper patch index past the last in each dimension, empty for the number of patches
+ */
+template <typename T>
+PatchSampler<T>::PatchSampler(PatcherSession<T> &session, uint64_t seed,
+                              const std::vector<size_t> &lower, const std::vector<size_t> &upper)
+    : session(session),
+      indices(session.get_num_patches(), lower, upper),
+      seed(seed),
+      rng(seed) {}
+
+/**
+ * @brief Construct a new PatchSampler object, drawing patches in proportion to their weight.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param session session to extract patches with, must outlive the sampler
+ * @param seed random seed
+ * @param weights non-negative weight of each patch, in patch number order
+ */
+template <typename T>
+PatchSampler<T>::PatchSampler(PatcherSession<T> &session, uint64_t seed,
+                              const std::vector<double> &weights)
+    : session(session), indices(session.get_num_patches(), weights), seed(seed), rng(seed) {}
+
+/**
+ * @brief Restarts the random stream for an epoch and worker
+ *
+ * @tparam T datatype of data found within fpath
+ * @param epoch_num epoch number
+ * @param worker_id data loader worker id
+ */
+template <typename T>
+void PatchSampler<T>::set_epoch(uint64_t epoch_num, uint64_t worker_id) {
+    epoch = epoch_num;
+    worker = worker_id;
+    rng = sampler::Rng(seed, epoch, worker);
+}
+
+/**
+ * @brief Draws the next batch of patch numbers
+ *
+ * @tparam T datatype of data found within fpath
+ * @param batch_size number of patches
+ * @return std::vector<size_t> Patch numbers
+ */
+template <typename T>
+std::vector<size_t> PatchSampler<T>::sample_pnums(size_t batch_size) {
+    std::vector<size_t> pnums(batch_size);
+    for (size_t &pnum : pnums) {
+        pnum = indices.sample(rng);
+    }
+    return pnums;
+}
+
+/**
+ * @brief Draws the next batch of patch numbers, and extracts the patches into an output
+ *      buffer.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param batch_size number of patches
+ * @param out output buffer, must hold batch_size * get_patch_size() elements
+ * @param num_threads number of worker threads, 0 uses the number of hardware threads
+ * @return std::vector<size_t> Patch numbers, in order of the patches in out
+ */
+template <typename T>
+std::vector<size_t> PatchSampler<T>::sample_into(size_t batch_size, T *out, size_t num_threads) {
+    std::vector<size_t> pnums = sample_pnums(batch_size);
+    session.get_patches_into(pnums, out, num_threads);
+    return pnums;
+}
+
+template <typename T>
+uint64_t PatchSampler<T>::get_seed() const {
+    return seed;
+}
+
+template <typename T>
+uint64_t PatchSampler<T>::get_epoch() const {
+    return epoch;
+}
+
+template <typename T>
+uint64_t PatchSampler<T>::get_worker() const {
+    return worker;
+}
+
+/**
+ * @brief Gets the number of patches that can be drawn
+ *
+ * @tparam T datatype of data found within fpath
+ * @return size_t Number of patches within the bounds, or with a non-zero weight
+ */
+template <typename T>
+size_t PatchSampler<T>::size() const {
+    return indices.size();
+}
+
+template <typename T>
+const PatcherSession<T> &PatchSampler<T>::get_session() const {
+    return session;
+}
+
+#endif  // SAMPLER_HPP_
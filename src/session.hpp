@@ -0,0 +1,327 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef SESSION_HPP_
+#define SESSION_HPP_
+
+#include <algorithm>  // std::max
+#include <memory>     // std::unique_ptr
+#include <mutex>      // std::mutex, std::lock_guard, std::unique_lock
+#include <string>     // std::string
+#include <thread>     // std::thread
+#include <vector>     // std::vector
+
+#include "src/patcher.hpp"
+#include "src/read_plan.hpp"
+#include "src/reader.hpp"
+#include "src/thread_pool.hpp"
+
+/**
+ * @brief Stateful patcher object. The npy file is opened, and its header parsed, once
+ *      during construction. The patch geometry (padding, strides & number of patches) is
+ *      also computed once, such that get_patch only has to read the patch data.
+ *
+ * @tparam T datatype of data found within fpath
+ */
+template <typename T>
+class PatcherSession : protected Patcher<T> {
+  private:
+    const std::string fpath_arg;
+    const std::vector<size_t> qidx_arg, pshape_arg, pstride_arg, padding_arg, pnum_offset_arg;
+    const reader::ReadMode mode_arg;
+    reader::AccessHint hint = reader::AccessHint::normal;
+    std::mutex read_mutex, pool_mutex;
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<std::unique_ptr<reader::Reader>> worker_readers;
+    std::vector<ReadState> worker_states;
+    void set_num_threads(size_t);
+
+  public:
+    PatcherSession(const std::string &, const std::vector<size_t> &, const std::vector<size_t> &,
+                   const std::vector<size_t> &, const std::vector<size_t> & = {},
+                   const std::vector<size_t> & = {}, reader::ReadMode = reader::ReadMode::stream);
+    ~PatcherSession();
+    PatcherSession(const PatcherSession &) = delete;
+    PatcherSession &operator=(const PatcherSession &) = delete;
+    std::vector<T> get_patch(size_t);
+    void get_patch_into(size_t, T *);
+    std::vector<T> get_patches(const std::vector<size_t> &, size_t = 1);
+    void get_patches_into(const std::vector<size_t> &, T *, size_t = 1);
+    read_plan::PlanStats get_plan_stats(size_t) const;
+    size_t get_patch_offset(size_t) const;
+    void set_access_hint(reader::AccessHint);
+    reader::AccessHint get_access_hint() const;
+    const std::string &get_filepath() const;
+    const std::vector<size_t> &get_qidx() const;
+    const std::vector<size_t> &get_pshape() const;
+    const std::vector<size_t> &get_pstride() const;
+    const std::vector<size_t> &get_extra_padding() const;
+    const std::vector<size_t> &get_pnum_offset() const;
+    reader::ReadMode get_read_mode() const;
+    using Patcher<T>::get_patch_size;
+    using Patcher<T>::get_data_shape;
+    using Patcher<T>::get_padding;
+    using Patcher<T>::get_data_strides;
+    using Patcher<T>::get_patch_strides;
+    using Patcher<T>::get_num_patches;
+    using Patcher<T>::set_normalization;
+    using Patcher<T>::clear_normalization;
+    using Patcher<T>::get_normalizer;
+    using Patcher<T>::set_padding_mode;
+    using Patcher<T>::get_padding_mode;
+    using Patcher<T>::get_padding_value;
+};
+
+/**
+ * @brief Construct a new PatcherSession object, opens the npy file and sets the patch
+ *      geometry.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param fpath filepath for .npy data file
+ * @param qidx qspace index (0th index in file)
+ * @param pshape patch shape
+ * @param pstride patch stride
+ * @param padding extra padding, applied after initial padding calculation
+ * @param pnum_offset patch number offset
+ * @param mode backend used to read patch data
+ */
+template <typename T>
+PatcherSession<T>::PatcherSession(const std::string &fpath, const std::vector<size_t> &qidx,
+                                  const std::vector<size_t> &pshape,
+                                  const std::vector<size_t> &pstride,
+                                  const std::vector<size_t> &padding,
+                                  const std::vector<size_t> &pnum_offset,
+                                  reader::ReadMode mode)
+    : fpath_arg(fpath),
+      qidx_arg(qidx),
+      pshape_arg(pshape),
+      pstride_arg(pstride),
+      padding_arg(padding),
+      pnum_offset_arg(pnum_offset),
+      mode_arg(mode) {
+    if (qidx.empty()) {
+        throw std::runtime_error("qspace index must contain at least one index.");
+    }
+    this->set_init_vars(fpath, qidx, pshape, pstride, padding, pnum_offset);
+    this->open_file();
+    this->open_reader(mode);
+    this->set_geometry();
+    std::vector<T>().swap(this->patch);  // patches are read into caller owned buffers
+}
+
+/**
+ * @brief Destroy the PatcherSession object, closes the npy file.
+ *
+ * @tparam T datatype of data found within fpath
+ */
+template <typename T>
+PatcherSession<T>::~PatcherSession() {
+    this->stream.close();
+}
+
+/**
+ * @brief Extracts patch from the already opened npy file.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param pnum patch number
+ * @return std::vector<T> Patch data
+ */
+template <typename T>
+std::vector<T> PatcherSession<T>::get_patch(size_t pnum) {
+    std::vector<T> patch(this->patch_size);
+    get_patch_into(pnum, patch.data());
+    return patch;
+}
+
+/**
+ * @brief Extracts patch from the already opened npy file into an output buffer. Safe to
+ *      call from multiple threads, the read state is kept on the stack. Calls run
+ *      concurrently when the reader is thread safe (mmap & pread), otherwise the reads
+ *      are serialised.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param pnum patch number
+ * @param out output buffer, must hold get_patch_size() elements
+ */
+template <typename T>
+void PatcherSession<T>::get_patch_into(size_t pnum, T *out) {
+    ReadState state;
+    std::unique_lock<std::mutex> lock(read_mutex, std::defer_lock);
+    if (!this->reader->is_thread_safe()) {
+        lock.lock();
+    }
+    this->extract_patch(pnum, out, this->reader.get(), state);
+}
+
+/**
+ * @brief Extracts a batch of patches from the already opened npy file.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param pnums patch numbers
+ * @param num_threads number of worker threads, 0 uses the number of hardware threads
+ * @return std::vector<T> Patch data, contiguous patches in order of pnums
+ */
+template <typename T>
+std::vector<T> PatcherSession<T>::get_patches(const std::vector<size_t> &pnums,
+                                              size_t num_threads) {
+    std::vector<T> patches(this->patch_size * pnums.size());
+    get_patches_into(pnums, patches.data(), num_threads);
+    return patches;
+}
+
+/**
+ * @brief Extracts a batch of patches from the already opened npy file into an output buffer.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param pnums patch numbers
+ * @param out output buffer, must hold pnums.size() * get_patch_size() elements
+ * @param num_threads number of worker threads, 0 uses the number of hardware threads
+ */
+template <typename T>
+void PatcherSession<T>::get_patches_into(const std::vector<size_t> &pnums, T *out,
+                                         size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    if ((hint != reader::AccessHint::normal) && (pnums.size() > 1)) {
+        ReadState state;
+        this->advise_patches(pnums, this->reader.get(), state);
+    }
+    if ((num_threads == 1) || (pnums.size() <= 1)) {
+        ReadState state;
+        std::unique_lock<std::mutex> lock(read_mutex, std::defer_lock);
+        if (!this->reader->is_thread_safe()) {
+            lock.lock();
+        }
+        this->extract_patches(pnums, out, this->reader.get(), state);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    set_num_threads(num_threads);
+    pool->parallel_for(pnums.size(), [&](size_t worker, size_t i) {
+        reader::Reader *rdr = worker_readers[worker] ? worker_readers[worker].get()
+                                                     : this->reader.get();
+        this->extract_patch(pnums[i], out + (i * this->patch_size), rdr, worker_states[worker]);
+    });
+}
+
+/**
+ * @brief Plans the reads of a patch without reading it, such that the effect of merging and
+ *      coalescing rows can be inspected for a given geometry.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param pnum patch number
+ * @return read_plan::PlanStats Number of rows, runs & reads, patch bytes and bytes read
+ */
+template <typename T>
+read_plan::PlanStats PatcherSession<T>::get_plan_stats(size_t pnum) const {
+    ReadState state;
+    this->set_patch_numbers(pnum, state);
+    state.reader = this->reader.get();
+    return this->get_read_plan(state).stats();
+}
+
+/**
+ * @brief Gets the file offset at which reading of a patch starts, i.e. that of the first
+ *      element of the patch within the data.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param pnum patch number
+ * @return size_t Byte offset within the file
+ */
+template <typename T>
+size_t PatcherSession<T>::get_patch_offset(size_t pnum) const {
+    ReadState state;
+    this->set_patch_numbers(pnum, state);
+    this->move_stream_to_start(state);
+    return state.start;
+}
+
+/**
+ * @brief Sets up the worker pool, reused across calls until a different number of threads
+ *      is requested. Each worker gets its own reader, unless the session reader is thread
+ *      safe.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param num_threads number of worker threads
+ */
+template <typename T>
+void PatcherSession<T>::set_num_threads(size_t num_threads) {
+    if (pool && (pool->size() == num_threads)) {
+        return;
+    }
+    pool = std::make_unique<ThreadPool>(num_threads);
+    worker_states = std::vector<ReadState>(num_threads);
+    worker_readers.clear();
+    for (size_t i = 0; i < num_threads; i++) {
+        if (this->reader->is_thread_safe()) {
+            worker_readers.push_back(nullptr);
+        } else {
+            worker_readers.push_back(reader::open_reader(this->data_path, mode_arg));
+            worker_readers.back()->advise(hint);
+        }
+    }
+}
+
+/**
+ * @brief Sets the expected access pattern, which is passed to the kernel for the session and
+ *      worker readers. Unless normal, batches of patches also advise the kernel of the byte
+ *      ranges to be read before extraction starts.
+ *
+ * @tparam T datatype of data found within fpath
+ * @param access_hint sequential for sweeps, random for sampling, willneed to read ahead
+ */
+template <typename T>
+void PatcherSession<T>::set_access_hint(reader::AccessHint access_hint) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    hint = access_hint;
+    this->reader->advise(hint);
+    for (std::unique_ptr<reader::Reader> &rdr : worker_readers) {
+        if (rdr) {
+            rdr->advise(hint);
+        }
+    }
+}
+
+template <typename T>
+const std::string &PatcherSession<T>::get_filepath() const {
+    return fpath_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &PatcherSession<T>::get_qidx() const {
+    return qidx_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &PatcherSession<T>::get_pshape() const {
+    return pshape_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &PatcherSession<T>::get_pstride() const {
+    return pstride_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &PatcherSession<T>::get_extra_padding() const {
+    return padding_arg;
+}
+
+template <typename T>
+const std::vector<size_t> &PatcherSession<T>::get_pnum_offset() const {
+    return pnum_offset_arg;
+}
+
+template <typename T>
+reader::ReadMode PatcherSession<T>::get_read_mode() const {
+    return mode_arg;
+}
+
+template <typename T>
+reader::AccessHint PatcherSession<T>::get_access_hint() const {
+    return hint;
+}
+
+#endif  // SESSION_HPP_
@@ -0,0 +1,159 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include "src/thread_pool.hpp"
+
+
+/**
+ * @brief Construct a new ThreadPool object and start the workers
+ *
+ * @param num_threads Number of worker threads, 0 uses the number of hardware threads
+ */
+ThreadPool::ThreadPool(size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::thread::hardware_concurrency();
+    }
+    if (num_threads == 0) {
+        num_threads = 1;
+    }
+    ranges = std::vector<Range>(num_threads);
+    workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_cv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+
+size_t ThreadPool::size() const {
+    return workers.size();
+}
+
+
+/**
+ * @brief Calls fn(worker, index) for every index in [0, n), blocks until all calls have
+ *      returned. The first exception thrown by fn is rethrown once all workers have stopped.
+ *
+ * @param n Number of indices
+ * @param fn Function to call, given the worker number & index
+ */
+void ThreadPool::parallel_for(size_t n, const std::function<void(size_t, size_t)>& fn) {
+    std::lock_guard<std::mutex> job_lock(job_mutex);  // one job at a time
+    if (n == 0) {
+        return;
+    }
+    for (size_t i = 0; i < ranges.size(); i++) {
+        std::lock_guard<std::mutex> lock(ranges[i].mutex);
+        ranges[i].begin = (n * i) / ranges.size();
+        ranges[i].end = (n * (i + 1)) / ranges.size();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    job = &fn;
+    error = nullptr;
+    cancelled = false;
+    remaining = workers.size();
+    generation++;
+    job_cv.notify_all();
+    done_cv.wait(lock, [this] { return remaining == 0; });
+    job = nullptr;
+
+    if (error) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+
+/**
+ * @brief Gets the next index for a worker, stealing from other workers once its own
+ *      range is exhausted.
+ *
+ * @param id Worker number
+ * @param index Output index
+ * @return true if an index was found
+ */
+bool ThreadPool::next_index(size_t id, size_t& index) {
+    if (cancelled) {
+        return false;
+    }
+    Range& own = ranges[id];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.begin < own.end) {
+            index = own.begin++;
+            return true;
+        }
+    }
+    // Steal back half of another worker's remaining range
+    for (size_t i = 1; i < ranges.size(); i++) {
+        Range& victim = ranges[(id + i) % ranges.size()];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin >= victim.end) {
+                continue;
+            }
+            begin = victim.begin + ((victim.end - victim.begin) / 2);
+            end = victim.end;
+            victim.end = begin;
+        }
+        std::lock_guard<std::mutex> lock(own.mutex);
+        index = begin;
+        own.begin = begin + 1;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * @brief Worker thread main loop, waits for a job then processes indices until none remain.
+ *
+ * @param id Worker number
+ */
+void ThreadPool::worker_loop(size_t id) {
+    size_t seen = 0;
+    while (true) {
+        const std::function<void(size_t, size_t)>* fn;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_cv.wait(lock, [this, seen] { return stopping || (generation != seen); });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            fn = job;
+        }
+        size_t index;
+        while (next_index(id, index)) {
+            try {
+                (*fn)(id, index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                cancelled = true;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) {
+            done_cv.notify_one();
+        }
+    }
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <atomic>              // std::atomic
+#include <condition_variable>  // std::condition_variable
+#include <exception>           // std::exception_ptr
+#include <functional>          // std::function
+#include <mutex>               // std::mutex
+#include <thread>              // std::thread
+#include <vector>              // std::vector
+
+/**
+ * @brief Fixed size pool of worker threads, reused across calls to parallel_for.
+ *
+ * @details Each call splits the index space into one contiguous range per worker, such
+ *      that a worker reads neighbouring patches. Workers that run out of indices steal
+ *      half of the remaining range of another worker, balancing out patches of uneven cost.
+ */
+class ThreadPool {
+  private:
+    struct Range {
+        std::mutex mutex;
+        size_t begin = 0, end = 0;
+    };
+    std::vector<std::thread> workers;
+    std::vector<Range> ranges;
+    std::mutex mutex, job_mutex;
+    std::condition_variable job_cv, done_cv;
+    const std::function<void(size_t, size_t)> *job = nullptr;
+    size_t generation = 0, remaining = 0;
+    bool stopping = false;
+    std::atomic<bool> cancelled{false};
+    std::exception_ptr error;
+    void worker_loop(size_t);
+    bool next_index(size_t, size_t &);
+
+  public:
+    explicit ThreadPool(size_t);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    size_t size() const;
+    void parallel_for(size_t, const std::function<void(size_t, size_t)> &);
+};
+
+#endif  // THREAD_POOL_HPP_
@@ -0,0 +1,148 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>  // std::min
+#include <cstdint>    // uint8_t, uint16_t, uint32_t, uint64_t
+#include <cstring>    // std::memcpy
+#include <stdexcept>  // std::runtime_error
+
+#if defined(__SSE2__)
+#include <emmintrin.h>  // _mm_loadu_ps, _mm_storeu_ps, _MM_TRANSPOSE4_PS
+#endif
+
+#include "src/transpose.hpp"
+
+
+namespace transpose {
+
+namespace {
+
+/**
+ * @brief Transposes one tile, element by element
+ *
+ * @tparam E unsigned integer type of the element size
+ */
+template <typename E>
+void transpose_scalar(const char* src, char* dst, size_t rows, size_t src_stride,
+                      const size_t* columns, size_t num_columns, size_t dst_stride) {
+    for (size_t c = 0; c < num_columns; c++) {
+        const char* in = src + (columns[c] * sizeof(E));
+        E* out = reinterpret_cast<E*>(dst + (c * dst_stride));
+        for (size_t r = 0; r < rows; r++) {
+            E value;
+            std::memcpy(&value, in + (r * src_stride), sizeof(E));
+            out[r] = value;
+        }
+    }
+}
+
+
+template <typename E>
+void transpose_tile(const char* src, char* dst, size_t rows, size_t src_stride,
+                    const size_t* columns, size_t num_columns, size_t dst_stride) {
+    transpose_scalar<E>(src, dst, rows, src_stride, columns, num_columns, dst_stride);
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief Transposes one tile of 4 byte elements, in 4x4 blocks of SSE registers where four
+ *      consecutive output rows gather consecutive columns, falling back to scalar copies
+ *      for the remaining rows & columns.
+ */
+template <>
+void transpose_tile<uint32_t>(const char* src, char* dst, size_t rows, size_t src_stride,
+                              const size_t* columns, size_t num_columns, size_t dst_stride) {
+    size_t c = 0;
+    for (; c + 4 <= num_columns; c += 4) {
+        if ((columns[c + 1] != columns[c] + 1) || (columns[c + 2] != columns[c] + 2) ||
+            (columns[c + 3] != columns[c] + 3)) {
+            transpose_scalar<uint32_t>(src, dst + (c * dst_stride), rows, src_stride,
+                                       columns + c, 4, dst_stride);
+            continue;
+        }
+        const char* in = src + (columns[c] * 4);
+        char* out = dst + (c * dst_stride);
+        size_t r = 0;
+        for (; r + 4 <= rows; r += 4) {
+            __m128 row0 = _mm_loadu_ps(reinterpret_cast<const float*>(in + (r * src_stride)));
+            __m128 row1 =
+                _mm_loadu_ps(reinterpret_cast<const float*>(in + ((r + 1) * src_stride)));
+            __m128 row2 =
+                _mm_loadu_ps(reinterpret_cast<const float*>(in + ((r + 2) * src_stride)));
+            __m128 row3 =
+                _mm_loadu_ps(reinterpret_cast<const float*>(in + ((r + 3) * src_stride)));
+            _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+            _mm_storeu_ps(reinterpret_cast<float*>(out + (r * 4)), row0);
+            _mm_storeu_ps(reinterpret_cast<float*>(out + dst_stride + (r * 4)), row1);
+            _mm_storeu_ps(reinterpret_cast<float*>(out + (2 * dst_stride) + (r * 4)), row2);
+            _mm_storeu_ps(reinterpret_cast<float*>(out + (3 * dst_stride) + (r * 4)), row3);
+        }
+        for (; r < rows; r++) {
+            for (size_t k = 0; k < 4; k++) {
+                std::memcpy(out + (k * dst_stride) + (r * 4), in + (r * src_stride) + (k * 4), 4);
+            }
+        }
+    }
+    if (c < num_columns) {
+        transpose_scalar<uint32_t>(src, dst + (c * dst_stride), rows, src_stride, columns + c,
+                                   num_columns - c, dst_stride);
+    }
+}
+#endif
+
+/**
+ * @brief Transposes in square tiles, such that both the rows read and the rows written by a
+ *      tile stay in cache.
+ *
+ * @tparam E unsigned integer type of the element size
+ */
+template <typename E>
+void transpose_blocked(const char* src, char* dst, size_t rows, size_t src_stride,
+                       const std::vector<size_t>& columns, size_t dst_stride) {
+    for (size_t c = 0; c < columns.size(); c += tile_size) {
+        const size_t num_columns = std::min(tile_size, columns.size() - c);
+        for (size_t r = 0; r < rows; r += tile_size) {
+            transpose_tile<E>(src + (r * src_stride), dst + (c * dst_stride) + (r * sizeof(E)),
+                              std::min(tile_size, rows - r), src_stride, columns.data() + c,
+                              num_columns, dst_stride);
+        }
+    }
+}
+
+}  // namespace
+
+
+/**
+ * @brief Transposes a 2D block of elements, gathering a subset of its columns. Element
+ *      (r, columns[c]) of the source is written to element (c, r) of the destination.
+ *
+ * @param src Source block, rows of src_stride bytes
+ * @param dst Destination block, rows of dst_stride bytes
+ * @param rows Number of source rows, i.e. elements in each destination row
+ * @param src_stride Byte stride between source rows
+ * @param columns Source column of each destination row
+ * @param dst_stride Byte stride between destination rows
+ * @param elem_size Element size in bytes
+ */
+void gather_transpose(const char* src, char* dst, size_t rows, size_t src_stride,
+                      const std::vector<size_t>& columns, size_t dst_stride, size_t elem_size) {
+    switch (elem_size) {
+        case 1:
+            transpose_blocked<uint8_t>(src, dst, rows, src_stride, columns, dst_stride);
+            break;
+        case 2:
+            transpose_blocked<uint16_t>(src, dst, rows, src_stride, columns, dst_stride);
+            break;
+        case 4:
+            transpose_blocked<uint32_t>(src, dst, rows, src_stride, columns, dst_stride);
+            break;
+        case 8:
+            transpose_blocked<uint64_t>(src, dst, rows, src_stride, columns, dst_stride);
+            break;
+        default:
+            throw std::runtime_error("Unsupported element size for transpose.");
+    }
+}
+
+}  // namespace transpose
@@ -0,0 +1,21 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef TRANSPOSE_HPP_
+#define TRANSPOSE_HPP_
+
+#include <cstddef>  // size_t
+#include <vector>   // std::vector
+
+namespace transpose {
+
+// Side length, in elements, of the tiles the transpose is blocked into
+constexpr size_t tile_size = 16;
+
+void gather_transpose(const char *, char *, size_t, size_t, const std::vector<size_t> &, size_t,
+                      size_t);
+
+}  // namespace transpose
+
+#endif  // TRANSPOSE_HPP_
@@ -0,0 +1,317 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>     // open
+#include <sys/mman.h>  // mmap, munmap
+#include <unistd.h>    // close, syscall
+
+#include <algorithm>  // std::min, std::max
+#include <cerrno>     // errno, EINTR, EAGAIN, EBUSY
+#include <cstring>    // std::memset
+#include <deque>      // std::deque
+#include <stdexcept>  // std::runtime_error
+#include <thread>     // std::this_thread::yield
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>  // io_uring_params, io_uring_sqe, io_uring_cqe
+#include <sys/syscall.h>     // __NR_io_uring_setup, __NR_io_uring_enter
+#define NPY_PATCHER_URING 1
+#endif
+
+#include "src/uring.hpp"
+
+
+namespace reader {
+
+#ifdef NPY_PATCHER_URING
+
+namespace {
+
+// Largest length of a single submission, longer reads are split
+constexpr size_t max_submit_length = 1 << 30;
+
+
+int uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+
+int uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(
+        ::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+}  // namespace
+
+
+/**
+ * @brief Opens file and sets up the submission & completion rings
+ *
+ * @param filepath Filepath to open
+ * @param entries Number of submission queue entries
+ */
+UringReader::UringReader(const std::string& filepath, unsigned entries)
+    : fd(-1), ring_fd(-1), sq_ptr(MAP_FAILED), cq_ptr(MAP_FAILED), sqes(nullptr) {
+    fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("IO Error: failed to open " + filepath);
+    }
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd = uring_setup(entries, &params);
+    if (ring_fd < 0) {
+        close_ring();
+        throw std::runtime_error("IO Error: io_uring is not available.");
+    }
+    this->entries = params.sq_entries;
+
+    // Map rings, which may share a single mapping
+    sq_size = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+    cq_size = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_size = cq_size = std::max(sq_size, cq_size);
+    }
+    sq_ptr = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                    IORING_OFF_SQ_RING);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ptr = sq_ptr;
+    } else if (sq_ptr != MAP_FAILED) {
+        cq_ptr = ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd, IORING_OFF_CQ_RING);
+    }
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes_ptr = MAP_FAILED;
+    if (cq_ptr != MAP_FAILED) {
+        sqes_ptr = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd, IORING_OFF_SQES);
+    }
+    if (sqes_ptr == MAP_FAILED) {
+        close_ring();
+        throw std::runtime_error("IO Error: failed to map io_uring rings.");
+    }
+    sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+    char* sq = static_cast<char*>(sq_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(cq_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+
+UringReader::~UringReader() {
+    close_ring();
+}
+
+
+void UringReader::close_ring() {
+    if (sqes != nullptr) {
+        ::munmap(sqes, sqes_size);
+    }
+    if ((cq_ptr != MAP_FAILED) && (cq_ptr != sq_ptr)) {
+        ::munmap(cq_ptr, cq_size);
+    }
+    if (sq_ptr != MAP_FAILED) {
+        ::munmap(sq_ptr, sq_size);
+    }
+    if (ring_fd >= 0) {
+        ::close(ring_fd);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+
+void UringReader::read(char* buf, size_t offset, size_t length) {
+    read_many({{buf, offset, length}});
+}
+
+
+/**
+ * @brief Reads a batch of requests. Requests are queued in the submission ring until it is
+ *      full, then submitted while waiting for completions. Short reads are queued again for the
+ *      remaining bytes. On error, no more reads are queued, reads the kernel has not consumed
+ *      are withdrawn from the submission ring, and all reads in flight are reaped before
+ *      throwing, such that no read completes into a buffer after returning.
+ *
+ * @param requests Reads to perform
+ */
+void UringReader::read_many(const std::vector<ReadRequest>& requests) {
+    std::deque<ReadRequest> queue(requests.begin(), requests.end());
+    std::vector<ReadRequest> in_flight(entries);
+    std::vector<unsigned> free_slots;
+    for (unsigned i = entries; i > 0; i--) {
+        free_slots.push_back(i - 1);
+    }
+    unsigned unsubmitted = 0;
+    int error = 0;
+
+    while ((!queue.empty() && (error == 0)) || (free_slots.size() < entries)) {
+        // Queue requests while there are free slots
+        unsigned tail = *sq_tail;
+        while (!queue.empty() && !free_slots.empty() && (error == 0)) {
+            ReadRequest request = queue.front();
+            queue.pop_front();
+            if (request.length == 0) {
+                continue;
+            }
+            unsigned slot = free_slots.back();
+            free_slots.pop_back();
+            in_flight[slot] = request;
+
+            unsigned index = tail & *sq_mask;
+            io_uring_sqe* sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<unsigned long long>(request.buf);
+            sqe->len = static_cast<unsigned>(std::min(request.length, max_submit_length));
+            sqe->off = request.offset;
+            sqe->user_data = slot;
+            sq_array[index] = index;
+            tail++;
+            unsubmitted++;
+        }
+        __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+        if (free_slots.size() == entries) {
+            continue;  // only empty requests were queued
+        }
+
+        // Submit, and wait for at least one completion
+        int ret = uring_enter(ring_fd, unsubmitted, 1, IORING_ENTER_GETEVENTS);
+        if (ret < 0) {
+            if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY)) {
+                if (error == 0) {
+                    error = -2;
+                }
+                // Withdraw the reads not yet consumed, completions still arrive in the ring
+                const unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+                for (unsigned i = tail; i != head; i--) {
+                    free_slots.push_back(static_cast<unsigned>(sqes[(i - 1) & *sq_mask].user_data));
+                }
+                __atomic_store_n(sq_tail, head, __ATOMIC_RELEASE);
+                unsubmitted = 0;
+                std::this_thread::yield();
+            }
+        } else {
+            unsubmitted -= std::min(unsubmitted, static_cast<unsigned>(ret));
+        }
+
+        // Reap completions
+        unsigned head = *cq_head;
+        while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe* cqe = &cqes[head & *cq_mask];
+            unsigned slot = static_cast<unsigned>(cqe->user_data);
+            ReadRequest request = in_flight[slot];
+            free_slots.push_back(slot);
+            if ((cqe->res == -EINTR) || (cqe->res == -EAGAIN)) {
+                queue.push_front(request);
+            } else if (cqe->res < 0) {
+                error = -cqe->res;
+            } else if (cqe->res == 0) {
+                error = -1;
+            } else if (static_cast<size_t>(cqe->res) < request.length) {
+                queue.push_front({request.buf + cqe->res, request.offset + cqe->res,
+                                  request.length - cqe->res});
+            }
+            head++;
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    if (error == -1) {
+        throw std::runtime_error("IO Error: unexpected end of file.");
+    } else if (error == -2) {
+        throw std::runtime_error("IO Error: io_uring_enter failed.");
+    } else if (error != 0) {
+        throw std::runtime_error("IO Error: failed to read from file.");
+    }
+}
+
+
+void UringReader::advise(AccessHint hint) {
+    fadvise(fd, hint);
+}
+
+
+void UringReader::will_need(size_t offset, size_t length) {
+    fadvise_will_need(fd, offset, length);
+}
+
+
+/**
+ * @brief Checks io_uring is supported, i.e. both by the kernel and not blocked by seccomp.
+ *
+ * @return true If io_uring rings can be set up
+ */
+bool uring_available() {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int ring_fd = uring_setup(1, &params);
+    if (ring_fd < 0) {
+        return false;
+    }
+    ::close(ring_fd);
+    return true;
+}
+
+#else
+
+UringReader::UringReader(const std::string& filepath, unsigned entries) {
+    throw std::runtime_error("IO Error: io_uring is not available.");
+}
+
+
+UringReader::~UringReader() {}
+
+
+void UringReader::close_ring() {}
+
+
+void UringReader::read(char* buf, size_t offset, size_t length) {}
+
+
+void UringReader::read_many(const std::vector<ReadRequest>& requests) {}
+
+
+void UringReader::advise(AccessHint hint) {}
+
+
+void UringReader::will_need(size_t offset, size_t length) {}
+
+
+bool uring_available() {
+    return false;
+}
+
+#endif
+
+
+/**
+ * @brief Opens an io_uring reader, falling back to pread if io_uring is not available or
+ *      does not support reads (Linux < 5.6).
+ *
+ * @param filepath Filepath to open
+ * @return std::unique_ptr<Reader> Opened reader
+ */
+std::unique_ptr<Reader> open_uring_reader(const std::string& filepath) {
+    if (uring_available()) {
+        try {
+            std::unique_ptr<Reader> uring = std::make_unique<UringReader>(filepath);
+            char probe;
+            uring->read(&probe, 0, 1);
+            return uring;
+        } catch (const std::runtime_error&) {
+        }
+    }
+    return std::make_unique<PreadReader>(filepath);
+}
+
+}  // namespace reader
@@ -0,0 +1,56 @@
+// Copyright (c) 2022 Matthew Lyon. All rights reserved.
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file.
+
+#ifndef URING_HPP_
+#define URING_HPP_
+
+#include <memory>  // std::unique_ptr
+#include <string>  // std::string
+#include <vector>  // std::vector
+
+#include "src/reader.hpp"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace reader {
+
+// Default number of submission queue entries
+constexpr unsigned uring_entries = 256;
+
+/**
+ * @brief Reads with io_uring, using the raw system calls. All reads of a batch are queued in
+ *      the submission ring, and submitted & reaped with as few system calls as possible.
+ */
+class UringReader : public Reader {
+  private:
+    int fd, ring_fd;
+    unsigned entries;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size, sqes_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    io_uring_sqe *sqes;
+    io_uring_cqe *cqes;
+    void close_ring();
+
+  public:
+    explicit UringReader(const std::string &, unsigned = uring_entries);
+    ~UringReader() override;
+    UringReader(const UringReader &) = delete;
+    UringReader &operator=(const UringReader &) = delete;
+    void read(char *, size_t, size_t) override;
+    void read_many(const std::vector<ReadRequest> &) override;
+    bool is_batched() const override { return true; }
+    void advise(AccessHint) override;
+    void will_need(size_t, size_t) override;
+    size_t max_gap() const override { return 0; }
+};
+
+bool uring_available();
+std::unique_ptr<Reader> open_uring_reader(const std::string &);
+
+}  // namespace reader
+
+#endif  // URING_HPP_
@@ -0,0 +1,164 @@
+'''Testing batched patch extraction'''
+import os
+import unittest
+import numpy as np
+
+from npy_patcher import PatcherLong, PatcherSessionLong, ReadMode
+
+
+def get_test_data_3d(filepath):
+    '''Testing: 3D shape, overlapping patches, differing qspace indexing
+
+    Datatype: long
+    Padding required: (0, 0, 4, 3, 2, 1)
+    '''
+    data_in = np.random.randint(0, 300, (5, 12, 33, 22), dtype=np.int64)
+    np.save(filepath, data_in, allow_pickle=False)
+    data_in_dict = {
+        'fpath': filepath,
+        'qidx': np.array([4, 0, 2]),
+        'pshape': (3, 10, 5),
+        'pstride': (3, 10, 5),
+        'padding': [],
+    }
+    pnums = np.random.permutation(4 * 4 * 5)
+    data_out_dict = {
+        'pnums': np.concatenate([pnums, pnums[:3]]),
+    }
+
+    return data_in_dict, data_out_dict
+
+
+class BaseTestCases:
+    '''Base test case class with TestClass members'''
+
+    class BaseTest(unittest.TestCase):
+        '''Actual Base test class'''
+
+        # pylint: disable=no-member
+
+        def setUp(self) -> None:
+            self.set_up_vars()
+            self.data_in, self.data_out = get_test_data_3d(self.filepath)
+            self.patcher = PatcherLong()
+
+        def tearDown(self):
+            os.remove(self.filepath)
+
+        def set_up_vars(self):
+            '''Method to setup vars for testing'''
+            raise NotImplementedError
+
+        def run_get_patches(self, pnums):
+            '''Runs batched extraction given patch numbers'''
+            raise NotImplementedError
+
+        def get_expected(self, pnums):
+            '''Stacks single patch extraction output'''
+            patches = [self.patcher.get_patch(pnum=pnum, **self.data_in) for pnum in pnums]
+            return np.stack(patches)
+
+        def test_equality(self):
+            '''Tests batch is equal to stacked single patches'''
+            pnums = self.data_out['pnums']
+            data_out_test = self.run_get_patches(pnums)
+            data_out_true = self.get_expected(pnums)
+            self.assertEqual(data_out_test.shape, data_out_true.shape)
+            self.assertTrue(np.array_equal(data_out_test, data_out_true))
+
+        def test_empty(self):
+            '''Tests empty batch returns an empty array'''
+            data_out_test = self.run_get_patches([])
+            shape = (0, len(self.data_in['qidx'])) + tuple(self.data_in['pshape'])
+            self.assertEqual(data_out_test.shape, shape)
+
+        def test_invalid_pnum(self):
+            '''Tests pnum outside range raises'''
+            with self.assertRaises(RuntimeError):
+                self.run_get_patches([0, len(self.data_out['pnums'])])
+
+
+class TestPatcherBatch(BaseTestCases.BaseTest):
+    '''Batched extraction using Patcher'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_batch.npy'
+
+    def run_get_patches(self, pnums):
+        return self.patcher.get_patches(pnums=pnums, **self.data_in)
+
+
+class TestPatcherSessionBatch(BaseTestCases.BaseTest):
+    '''Batched extraction using PatcherSession'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_session_batch.npy'
+
+    def run_get_patches(self, pnums):
+        session = PatcherSessionLong(**self.data_in)
+        return session.get_patches(pnums)
+
+
+class TestPatcherSessionMmapBatch(BaseTestCases.BaseTest):
+    '''Batched extraction using a memory mapped PatcherSession'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_session_mmap_batch.npy'
+
+    def run_get_patches(self, pnums):
+        session = PatcherSessionLong(**self.data_in, mode=ReadMode.mmap)
+        return session.get_patches(pnums)
+
+
+class TestPatcherSessionThreadedBatch(BaseTestCases.BaseTest):
+    '''Batched extraction using PatcherSession worker threads'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_session_threaded_batch.npy'
+
+    def run_get_patches(self, pnums):
+        session = PatcherSessionLong(**self.data_in)
+        session.get_patches(pnums[:4], num_threads=4)  # pool is reused by later calls
+        return session.get_patches(pnums, num_threads=4)
+
+
+class TestPatcherSessionMmapThreadedBatch(BaseTestCases.BaseTest):
+    '''Batched extraction using memory mapped PatcherSession worker threads'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_session_mmap_threaded_batch.npy'
+
+    def run_get_patches(self, pnums):
+        session = PatcherSessionLong(**self.data_in, mode=ReadMode.mmap)
+        return session.get_patches(pnums, num_threads=0)
+
+
+class TestPatcherSessionUringBatch(BaseTestCases.BaseTest):
+    '''Batched extraction using an io_uring PatcherSession'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_session_uring_batch.npy'
+
+    def run_get_patches(self, pnums):
+        session = PatcherSessionLong(**self.data_in, mode=ReadMode.uring)
+        return session.get_patches(pnums)
+
+
+class TestPatcherSessionDirectBatch(BaseTestCases.BaseTest):
+    '''Batched extraction using a direct I/O PatcherSession'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_session_direct_batch.npy'
+
+    def run_get_patches(self, pnums):
+        try:
+            session = PatcherSessionLong(**self.data_in, mode=ReadMode.direct)
+        except RuntimeError as err:
+            if 'not supported' in str(err):
+                self.skipTest(str(err))
+            raise
+        return session.get_patches(pnums, num_threads=2)
+
+
+if __name__ == '__main__':
+    unittest.main()
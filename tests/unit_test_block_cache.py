@@ -0,0 +1,134 @@
+'''Testing the shared block cache'''
+import os
+import unittest
+import numpy as np
+
+from npy_patcher import (
+    CachePolicy,
+    PatcherSessionFloat,
+    ReadMode,
+    clear_block_cache,
+    get_block_cache_stats,
+    set_block_cache,
+)
+
+
+def get_test_data(filepath):
+    '''Testing: 2D shape, overlapping patches
+
+    Datatype: float
+    '''
+    data_in = np.random.randn(4, 40, 36).astype(np.float32)
+    np.save(filepath, data_in, allow_pickle=False)
+    data_in_dict = {
+        'fpath': filepath,
+        'qidx': np.array([3, 0, 1]),
+        'pshape': (8, 6),
+        'pstride': (4, 3),
+    }
+
+    return data_in_dict
+
+
+class BaseTestCases:
+    '''Base test case class with TestClass members'''
+
+    class BaseTest(unittest.TestCase):
+        '''Actual Base test class'''
+
+        # pylint: disable=no-member
+
+        def setUp(self) -> None:
+            self.set_up_vars()
+            self.data_in = get_test_data(self.filepath)
+            set_block_cache(self.budget, block_size=self.block_size, policy=self.policy)
+            self.session = PatcherSessionFloat(**self.data_in, mode=ReadMode.cached)
+            self.pread_session = PatcherSessionFloat(**self.data_in, mode=ReadMode.pread)
+            self.pnums = np.prod(self.session.get_num_patches())
+
+        def tearDown(self):
+            del self.session
+            del self.pread_session
+            os.remove(self.filepath)
+            set_block_cache(256 << 20)
+
+        def set_up_vars(self):
+            '''Method to setup vars for testing'''
+            raise NotImplementedError
+
+        def test_equality(self):
+            '''Tests cached output is equal to pread output, also when read again'''
+            pnums = np.random.permutation(self.pnums)
+            data_out_true = self.pread_session.get_patches(pnums)
+            for _ in range(2):
+                data_out_test = self.session.get_patches(pnums, num_threads=4)
+                self.assertTrue(np.array_equal(data_out_test, data_out_true))
+
+        def test_rewritten_file(self):
+            '''Tests a file removed & written again with the same size is not served stale blocks'''
+            self.session.get_patches(range(self.pnums))
+            del self.session
+            os.remove(self.filepath)
+            data_in = np.random.randn(4, 40, 36).astype(np.float32)
+            np.save(self.filepath, data_in, allow_pickle=False)
+            self.session = PatcherSessionFloat(**self.data_in, mode=ReadMode.cached)
+            self.assertTrue(np.array_equal(self.session.get_patch(0), data_in[[3, 0, 1], 0:8, 0:6]))
+
+        def test_stats(self):
+            '''Tests statistics and budget'''
+            clear_block_cache()
+            self.session.get_patches(range(self.pnums))
+            stats = get_block_cache_stats()
+            self.assertGreater(stats['misses'], 0)
+            self.assertLessEqual(stats['size'], self.budget)
+            self.assertEqual(stats['budget'], self.budget)
+            self.assertEqual(stats['block_size'], self.block_size)
+
+
+class TestBlockCacheLru(BaseTestCases.BaseTest):
+    '''LRU block cache holding the whole file'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_block_cache_lru.npy'
+        self.budget = 1 << 20
+        self.block_size = 4096
+        self.policy = CachePolicy.lru
+
+    def test_hits(self):
+        '''Tests second pass over the file is only served from the cache'''
+        self.session.get_patches(range(self.pnums))
+        misses = get_block_cache_stats()['misses']
+        self.session.get_patches(range(self.pnums))
+        stats = get_block_cache_stats()
+        self.assertEqual(stats['misses'], misses)
+        self.assertEqual(stats['evictions'], 0)
+        self.assertGreater(stats['hits'], 0)
+
+
+class TestBlockCacheClock(BaseTestCases.BaseTest):
+    '''CLOCK block cache smaller than the file, with unaligned block size'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_block_cache_clock.npy'
+        self.budget = 3000
+        self.block_size = 300
+        self.policy = CachePolicy.clock
+
+    def test_evictions(self):
+        '''Tests blocks are evicted once the budget is reached'''
+        self.session.get_patches(range(self.pnums))
+        self.assertGreater(get_block_cache_stats()['evictions'], 0)
+
+
+class TestBlockCacheDisabled(BaseTestCases.BaseTest):
+    '''Block cache with zero budget'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_block_cache_disabled.npy'
+        self.budget = 0
+        self.block_size = 4096
+        self.policy = CachePolicy.lru
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,116 @@
+'''Testing extraction from data in non-native byte order'''
+import os
+import sys
+import unittest
+import numpy as np
+
+from npy_patcher import (
+    GridIteratorFloat,
+    PatcherFloat,
+    PatcherLong,
+    PatcherSessionFloat,
+    PatcherSessionLong,
+    ReadMode,
+)
+
+SWAPPED_ORDER = '>' if sys.byteorder == 'little' else '<'
+
+
+def get_test_data(filepath, shape, dtype):
+    '''Saves the same data in native byte order and in swapped byte order
+
+    Returns filepath of the swapped data, and of the native data
+    '''
+    data_in = (np.random.rand(*shape) * 1000).astype(dtype)
+    np.save(filepath, data_in.astype(data_in.dtype.newbyteorder(SWAPPED_ORDER)))
+    native_filepath = filepath.replace('.npy', '_native.npy')
+    np.save(native_filepath, data_in, allow_pickle=False)
+    return filepath, native_filepath
+
+
+class BaseTestCases:
+    '''Base test case class with TestClass members'''
+
+    class BaseTest(unittest.TestCase):
+        '''Actual Base test class'''
+
+        # pylint: disable=no-member
+
+        def setUp(self) -> None:
+            self.set_up_vars()
+            self.filepath, self.native_filepath = get_test_data(
+                self.filepath, self.shape, self.dtype
+            )
+            self.kwargs = {'qidx': self.qidx, 'pshape': self.pshape, 'pstride': self.pstride}
+            session = self.session_class(self.native_filepath, **self.kwargs)
+            self.pnums = list(range(np.prod(session.get_num_patches())))
+            self.data_out_true = session.get_patches(self.pnums)
+
+        def tearDown(self):
+            os.remove(self.filepath)
+            os.remove(self.native_filepath)
+
+        def set_up_vars(self):
+            '''Method to setup vars for testing'''
+            raise NotImplementedError
+
+        def test_byte_order(self):
+            '''Tests test data is saved in swapped byte order'''
+            self.assertEqual(np.load(self.filepath).dtype.byteorder, SWAPPED_ORDER)
+
+        def test_patcher(self):
+            '''Tests Patcher output is equal to that of native data'''
+            data_out_test = self.patcher_class().get_patches(
+                self.filepath, pnums=self.pnums, **self.kwargs
+            )
+            self.assertTrue(np.array_equal(data_out_test.ravel(), self.data_out_true.ravel()))
+
+        def test_session(self):
+            '''Tests session output is equal to that of native data, for each read mode'''
+            for mode in (ReadMode.stream, ReadMode.mmap, ReadMode.uring, ReadMode.cached):
+                with self.subTest(f'Mode: {mode}'):
+                    session = self.session_class(self.filepath, **self.kwargs, mode=mode)
+                    data_out_test = session.get_patches(self.pnums)
+                    self.assertTrue(np.array_equal(data_out_test, self.data_out_true))
+                    data_out_test = np.stack([session.get_patch(pnum) for pnum in self.pnums])
+                    self.assertTrue(
+                        np.array_equal(data_out_test.ravel(), self.data_out_true.ravel())
+                    )
+
+
+class TestByteOrderFloat(BaseTestCases.BaseTest):
+    '''2D float test case, with padding'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_byte_order_float.npy'
+        self.shape = (4, 30, 27)
+        self.dtype = np.float32
+        self.qidx = [3, 0, 1]
+        self.pshape = (8, 8)
+        self.pstride = (6, 5)
+        self.patcher_class = PatcherFloat
+        self.session_class = PatcherSessionFloat
+
+    def test_grid(self):
+        '''Tests grid iterator output is equal to that of native data'''
+        grid = GridIteratorFloat(self.filepath, **self.kwargs)
+        data_out_test = np.stack(list(grid))
+        self.assertTrue(np.array_equal(data_out_test.ravel(), self.data_out_true.ravel()))
+
+
+class TestByteOrderLong(BaseTestCases.BaseTest):
+    '''3D long test case, with padding'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_byte_order_long.npy'
+        self.shape = (3, 10, 9, 14)
+        self.dtype = np.int64
+        self.qidx = [2, 0]
+        self.pshape = (5, 4, 6)
+        self.pstride = (4, 3, 4)
+        self.patcher_class = PatcherLong
+        self.session_class = PatcherSessionLong
+
+
+if __name__ == '__main__':
+    unittest.main()
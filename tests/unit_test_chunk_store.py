@@ -0,0 +1,101 @@
+'''Testing patch extraction from chunked stores'''
+import os
+import pickle
+import unittest
+import numpy as np
+
+from npy_patcher import (
+    ChunkStoreSessionFloat,
+    ChunkStoreSessionLong,
+    PadMode,
+    PatcherSessionFloat,
+    PatcherSessionLong,
+    clear_chunk_cache,
+    convert_to_chunk_store,
+    get_chunk_cache_stats,
+)
+
+
+class TestChunkStore(unittest.TestCase):
+    '''Chunked store test case comparing output to that of a session of the npy file'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_chunk_store.npy'
+        self.store_filepath = 'test_data_chunk_store.npc'
+        self.data_in = np.random.randn(4, 21, 17).astype(np.float32)
+        self.data_in[np.random.rand(*self.data_in.shape) < 0.9] = 0
+        np.save(self.filepath, self.data_in, allow_pickle=False)
+        self.kwargs = {'qidx': [3, 0], 'pshape': (6, 5), 'pstride': (4, 4), 'padding': (0, 0, 2, 2)}
+
+    def tearDown(self):
+        os.remove(self.filepath)
+        if os.path.exists(self.store_filepath):
+            os.remove(self.store_filepath)
+
+    def get_all(self, session, **kwargs):
+        '''Gets every patch of the session'''
+        return session.get_patches(list(range(np.prod(session.get_num_patches()))), **kwargs)
+
+    def test_chunk_shapes(self):
+        '''Tests patches are equal to the npy file for chunks smaller & larger than a patch'''
+        session = PatcherSessionFloat(self.filepath, **self.kwargs)
+        data_out_true = self.get_all(session)
+        for chunk_shape in ((4, 4), (3, 7), (1, 1), (21, 17), (30, 30)):
+            for shuffle in (True, False):
+                with self.subTest(f'Chunk shape: {chunk_shape}, shuffle: {shuffle}'):
+                    convert_to_chunk_store(
+                        self.filepath, self.store_filepath, chunk_shape, shuffle=shuffle
+                    )
+                    store = ChunkStoreSessionFloat(self.store_filepath, **self.kwargs)
+                    self.assertEqual(store.get_padding(), session.get_padding())
+                    self.assertTrue(np.array_equal(self.get_all(store), data_out_true))
+                    self.assertTrue(
+                        np.array_equal(self.get_all(store, num_threads=3), data_out_true)
+                    )
+
+    def test_padding_modes(self):
+        '''Tests padded regions are filled as by the session'''
+        convert_to_chunk_store(self.filepath, self.store_filepath, (4, 4), (1, 2))
+        session = PatcherSessionFloat(self.filepath, **self.kwargs)
+        store = ChunkStoreSessionFloat(self.store_filepath, **self.kwargs)
+        for mode in (PadMode.constant, PadMode.edge, PadMode.symmetric, PadMode.wrap):
+            with self.subTest(f'Mode: {mode}'):
+                session.set_padding_mode(mode, 2.5)
+                store.set_padding_mode(mode, 2.5)
+                self.assertTrue(np.array_equal(self.get_all(store), self.get_all(session)))
+        store = pickle.loads(pickle.dumps(store))
+        self.assertEqual(store.get_padding_mode(), PadMode.wrap)
+        self.assertTrue(np.array_equal(self.get_all(store), self.get_all(session)))
+
+    def test_conversion(self):
+        '''Tests Fortran ordered, big endian data is read into a different datatype'''
+        data_in = np.random.randint(-1000, 1000, (3, 9, 10, 8)).astype('>i2')
+        np.save(self.filepath, np.asfortranarray(data_in), allow_pickle=False)
+        kwargs = {'qidx': [2, 1], 'pshape': (4, 5, 3), 'pstride': (2, 5, 3)}
+        convert_to_chunk_store(self.filepath, self.store_filepath, (2, 5, 3))
+        store = ChunkStoreSessionLong(self.store_filepath, **kwargs)
+        data_out_true = self.get_all(PatcherSessionLong(self.filepath, **kwargs))
+        self.assertTrue(np.array_equal(self.get_all(store), data_out_true))
+
+    def test_chunk_cache(self):
+        '''Tests only the chunks a patch overlaps are decompressed, and then reused'''
+        kwargs = {'qidx': [3, 0], 'pshape': (4, 4), 'pstride': (4, 4)}
+        padding = PatcherSessionFloat(self.filepath, **kwargs).get_padding()
+        convert_to_chunk_store(self.filepath, self.store_filepath, (4, 4), padding[::2])
+        store = ChunkStoreSessionFloat(self.store_filepath, **kwargs)
+        clear_chunk_cache()
+        store.get_patch(7)
+        self.assertEqual(get_chunk_cache_stats()['misses'], 2)
+        store.get_patch(7)
+        self.assertEqual(get_chunk_cache_stats()['hits'], 2)
+        self.assertEqual(get_chunk_cache_stats()['misses'], 2)
+        self.assertLess(store.get_compressed_bytes(), self.data_in.nbytes)
+
+    def test_errors(self):
+        '''Tests an npy file is not opened as a store'''
+        with self.assertRaisesRegex(RuntimeError, 'Not a chunked store'):
+            ChunkStoreSessionFloat(self.filepath, **self.kwargs)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,143 @@
+'''Testing datatype conversion during extraction'''
+import os
+import unittest
+import numpy as np
+
+from npy_patcher import (
+    GridIteratorFloat,
+    PadMode,
+    PatcherDouble,
+    PatcherFloat,
+    PatcherSessionDouble,
+    PatcherSessionFloat,
+    PatcherSessionInt,
+    ReadMode,
+)
+
+
+def get_test_data(filepath, shape, dtype):
+    '''Saves data in the file datatype
+
+    Returns the data as saved
+    '''
+    data_in = (np.random.rand(*shape) * 200).astype(dtype)
+    np.save(filepath, data_in, allow_pickle=False)
+    return data_in
+
+
+class BaseTestCases:
+    '''Base test case class with TestClass members'''
+
+    class BaseTest(unittest.TestCase):
+        '''Actual Base test class'''
+
+        # pylint: disable=no-member
+
+        def setUp(self) -> None:
+            self.set_up_vars()
+            data_in = get_test_data(self.filepath, self.shape, self.dtype)
+            self.native_filepath = self.filepath.replace('.npy', '_native.npy')
+            np.save(self.native_filepath, data_in.astype(self.out_dtype), allow_pickle=False)
+            self.kwargs = {'qidx': self.qidx, 'pshape': self.pshape, 'pstride': self.pstride}
+            session = self.session_class(self.native_filepath, **self.kwargs)
+            self.pnums = list(range(np.prod(session.get_num_patches())))
+            self.data_out_true = session.get_patches(self.pnums)
+
+        def tearDown(self):
+            os.remove(self.filepath)
+            os.remove(self.native_filepath)
+
+        def set_up_vars(self):
+            '''Method to setup vars for testing'''
+            raise NotImplementedError
+
+        def test_patcher(self):
+            '''Tests Patcher output is equal to that of data saved in the output datatype'''
+            data_out_test = self.patcher_class().get_patches(
+                self.filepath, pnums=self.pnums, **self.kwargs
+            )
+            self.assertEqual(data_out_test.dtype, self.out_dtype)
+            self.assertTrue(np.array_equal(data_out_test.ravel(), self.data_out_true.ravel()))
+
+        def test_session(self):
+            '''Tests session output is equal to that of data saved in the output datatype'''
+            for mode in (ReadMode.stream, ReadMode.mmap, ReadMode.uring):
+                with self.subTest(f'Mode: {mode}'):
+                    session = self.session_class(self.filepath, **self.kwargs, mode=mode)
+                    data_out_test = session.get_patches(self.pnums, num_threads=2)
+                    self.assertEqual(data_out_test.dtype, self.out_dtype)
+                    self.assertTrue(np.array_equal(data_out_test, self.data_out_true))
+
+
+class TestConvertInt16Float(BaseTestCases.BaseTest):
+    '''2D int16 to float test case, with padding'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_convert_int16.npy'
+        self.shape = (4, 30, 27)
+        self.dtype = np.int16
+        self.out_dtype = np.float32
+        self.qidx = [3, 0, 1]
+        self.pshape = (8, 8)
+        self.pstride = (6, 5)
+        self.patcher_class = PatcherFloat
+        self.session_class = PatcherSessionFloat
+
+    def test_grid(self):
+        '''Tests grid iterator output is equal to that of data saved as float'''
+        grid = GridIteratorFloat(self.filepath, **self.kwargs)
+        data_out_test = np.stack(list(grid))
+        self.assertTrue(np.array_equal(data_out_test.ravel(), self.data_out_true.ravel()))
+
+    def test_int(self):
+        '''Tests conversion from int16 to int'''
+        session = PatcherSessionInt(self.filepath, **self.kwargs)
+        data_out_test = session.get_patches(self.pnums)
+        self.assertEqual(data_out_test.dtype, np.int32)
+        self.assertTrue(np.array_equal(data_out_test, self.data_out_true.astype(np.int32)))
+
+    def test_narrowing(self):
+        '''Tests conversions that may lose values raise an error'''
+        for dtype, session_class in (
+            (np.float64, PatcherSessionFloat),
+            (np.int32, PatcherSessionFloat),
+            (np.float32, PatcherSessionInt),
+            (np.int64, PatcherSessionInt),
+        ):
+            with self.subTest(f'{np.dtype(dtype).name} to {session_class.__name__}'):
+                get_test_data(self.filepath, self.shape, dtype)
+                with self.assertRaisesRegex(RuntimeError, 'Type mismatch'):
+                    session_class(self.filepath, **self.kwargs)
+
+    def test_swapped_padding(self):
+        '''Tests big endian data is swapped once where padded or repeated reads overlap'''
+        data_in = np.load(self.filepath).astype('>i2')
+        kwargs = {**self.kwargs, 'qidx': [3, 0, 3]}
+        for order in ('C', 'F'):
+            np.save(self.filepath, np.asarray(data_in, order=order), allow_pickle=False)
+            for mode in (PadMode.edge, PadMode.reflect, PadMode.symmetric, PadMode.wrap):
+                with self.subTest(f'Order: {order}, mode: {mode}'):
+                    native = PatcherSessionFloat(self.native_filepath, **kwargs)
+                    native.set_padding_mode(mode)
+                    session = PatcherSessionFloat(self.filepath, **kwargs, mode=ReadMode.mmap)
+                    session.set_padding_mode(mode)
+                    data_out_test = session.get_patches(self.pnums)
+                    self.assertTrue(np.array_equal(data_out_test, native.get_patches(self.pnums)))
+
+class TestConvertUint8Double(BaseTestCases.BaseTest):
+    '''3D uint8 to double test case, with padding'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_convert_uint8.npy'
+        self.shape = (3, 10, 9, 14)
+        self.dtype = np.uint8
+        self.out_dtype = np.float64
+        self.qidx = [2, 0]
+        self.pshape = (5, 4, 6)
+        self.pstride = (4, 3, 4)
+        self.patcher_class = PatcherDouble
+        self.session_class = PatcherSessionDouble
+
+
+if __name__ == '__main__':
+    unittest.main()
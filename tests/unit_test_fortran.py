@@ -0,0 +1,112 @@
+'''Testing extraction from Fortran ordered data'''
+import os
+import unittest
+import numpy as np
+
+from npy_patcher import (
+    GridIteratorFloat,
+    PatcherFloat,
+    PatcherLong,
+    PatcherSessionFloat,
+    PatcherSessionLong,
+    ReadMode,
+)
+
+
+def get_test_data(filepath, shape, dtype):
+    '''Saves the same data in C order and in Fortran order
+
+    Returns filepath of the Fortran ordered data, and of the C ordered data
+    '''
+    data_in = (np.random.rand(*shape) * 1000).astype(dtype)
+    np.save(filepath, np.asfortranarray(data_in), allow_pickle=False)
+    c_filepath = filepath.replace('.npy', '_c.npy')
+    np.save(c_filepath, data_in, allow_pickle=False)
+    return filepath, c_filepath
+
+
+class BaseTestCases:
+    '''Base test case class with TestClass members'''
+
+    class BaseTest(unittest.TestCase):
+        '''Actual Base test class'''
+
+        # pylint: disable=no-member
+
+        def setUp(self) -> None:
+            self.set_up_vars()
+            self.filepath, self.c_filepath = get_test_data(self.filepath, self.shape, self.dtype)
+            self.kwargs = {'qidx': self.qidx, 'pshape': self.pshape, 'pstride': self.pstride}
+
+        def tearDown(self):
+            os.remove(self.filepath)
+            os.remove(self.c_filepath)
+
+        def set_up_vars(self):
+            '''Method to setup vars for testing'''
+            raise NotImplementedError
+
+        def test_fortran_order(self):
+            '''Tests test data is saved in Fortran order'''
+            self.assertTrue(np.load(self.filepath).flags['F_CONTIGUOUS'])
+
+        def test_patcher(self):
+            '''Tests Patcher output is equal to that of C ordered data'''
+            patcher = self.patcher_class()
+            pnums = np.prod(self.session_class(self.c_filepath, **self.kwargs).get_num_patches())
+            for pnum in range(pnums):
+                with self.subTest(f'Patch: {pnum}'):
+                    data_out_test = patcher.get_patch(self.filepath, pnum=pnum, **self.kwargs)
+                    data_out_true = patcher.get_patch(self.c_filepath, pnum=pnum, **self.kwargs)
+                    self.assertTrue(np.array_equal(data_out_test, data_out_true))
+
+        def test_session(self):
+            '''Tests session batches are equal to those of C ordered data, for each read mode'''
+            c_session = self.session_class(self.c_filepath, **self.kwargs)
+            pnums = list(range(np.prod(c_session.get_num_patches())))
+            data_out_true = c_session.get_patches(pnums)
+            for mode in (ReadMode.stream, ReadMode.mmap, ReadMode.pread, ReadMode.uring):
+                with self.subTest(f'Mode: {mode}'):
+                    session = self.session_class(self.filepath, **self.kwargs, mode=mode)
+                    self.assertEqual(session.get_data_shape(), c_session.get_data_shape())
+                    self.assertTrue(np.array_equal(session.get_patches(pnums), data_out_true))
+                    self.assertTrue(
+                        np.array_equal(session.get_patches(pnums, num_threads=2), data_out_true)
+                    )
+
+
+class TestFortran2D(BaseTestCases.BaseTest):
+    '''2D float test case, with padding and non-contiguous qspace indexing'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_fortran_2D.npy'
+        self.shape = (5, 23, 18)
+        self.dtype = np.float32
+        self.qidx = [4, 0, 1, 2, 3]
+        self.pshape = (8, 6)
+        self.pstride = (4, 5)
+        self.patcher_class = PatcherFloat
+        self.session_class = PatcherSessionFloat
+
+    def test_grid(self):
+        '''Tests grid iteration of Fortran ordered data raises an error'''
+        with self.assertRaises(RuntimeError):
+            GridIteratorFloat(self.filepath, **self.kwargs)
+
+
+class TestFortran3D(BaseTestCases.BaseTest):
+    '''3D long test case, with padding'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_fortran_3D.npy'
+        self.shape = (4, 12, 9, 14)
+        self.dtype = np.int64
+        self.qidx = [2, 0]
+        self.pshape = (5, 4, 6)
+        self.pstride = (4, 3, 4)
+        self.patcher_class = PatcherLong
+        self.session_class = PatcherSessionLong
+
+
+if __name__ == '__main__':
+    unittest.main()
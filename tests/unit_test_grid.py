@@ -0,0 +1,105 @@
+'''Testing grid iteration over every patch'''
+import os
+import unittest
+import numpy as np
+
+from npy_patcher import GridIteratorFloat, GridIteratorLong, PatcherSessionFloat, ReadMode
+
+
+def get_test_data_2d(filepath):
+    '''Testing: 2D shape, overlapping patches
+
+    Datatype: float
+    '''
+    data_in = np.random.randn(5, 26, 19).astype(np.float32)
+    np.save(filepath, data_in, allow_pickle=False)
+    data_in_dict = {
+        'fpath': filepath,
+        'qidx': np.array([4, 0, 2]),
+        'pshape': (8, 5),
+        'pstride': (3, 2),
+    }
+
+    return data_in_dict
+
+
+class TestGridIterator2D(unittest.TestCase):
+    '''2D test case comparing grid output to session output'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_grid_2D.npy'
+        self.data_in = get_test_data_2d(self.filepath)
+        self.session = PatcherSessionFloat(**self.data_in)
+
+    def tearDown(self):
+        del self.session
+        os.remove(self.filepath)
+
+    def get_grid(self):
+        '''Gets grid iterator'''
+        return GridIteratorFloat(**self.data_in)
+
+    def test_equality(self):
+        '''Tests each patch is equal to session output, in patch number order'''
+        grid = self.get_grid()
+        patches = list(grid)
+        self.assertEqual(len(patches), len(grid))
+        self.assertEqual(len(grid), np.prod(self.session.get_num_patches()))
+        for pnum, data_out_test in enumerate(patches):
+            with self.subTest(f'Patch: {pnum}'):
+                self.assertTrue(np.array_equal(data_out_test, self.session.get_patch(pnum)))
+
+    def test_bytes_read(self):
+        '''Tests each byte of the qspace indices is read at most once'''
+        grid = self.get_grid()
+        for _ in grid:
+            pass
+        data_bytes = len(self.data_in['qidx']) * 26 * 19 * 4
+        self.assertLessEqual(grid.get_bytes_read(), data_bytes)
+        self.assertEqual(grid.get_slab_bytes(), len(self.data_in['qidx']) * 8 * 19 * 4)
+
+    def test_reset(self):
+        '''Tests iteration restarts after reset'''
+        grid = self.get_grid()
+        first = next(grid)
+        for _ in grid:
+            pass
+        grid.reset()
+        self.assertEqual(grid.position(), 0)
+        self.assertTrue(np.array_equal(next(grid), first))
+
+
+class TestGridIteratorMmap2D(TestGridIterator2D):
+    '''2D test case reading slabs from a memory mapping'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_grid_mmap_2D.npy'
+        self.data_in = get_test_data_2d(self.filepath)
+        self.session = PatcherSessionFloat(**self.data_in)
+
+    def get_grid(self):
+        return GridIteratorFloat(**self.data_in, mode=ReadMode.mmap)
+
+
+class TestGridIterator3D(unittest.TestCase):
+    '''3D test case with padding, comparing grid output to the data'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_grid_3D.npy'
+        self.data_in = np.random.randint(0, 300, (3, 6, 7, 8), dtype=np.int64)
+        np.save(self.filepath, self.data_in, allow_pickle=False)
+
+    def tearDown(self):
+        os.remove(self.filepath)
+
+    def test_full_coverage(self):
+        '''Tests non overlapping patches tile the data'''
+        grid = GridIteratorLong(self.filepath, [0, 1, 2], (3, 4, 4), (3, 4, 4))
+        self.assertEqual(grid.get_num_patches(), [2, 2, 2])
+        patches = np.stack(list(grid)).reshape(2, 2, 2, 3, 3, 4, 4)
+        tiled = patches.transpose(3, 0, 4, 1, 5, 2, 6).reshape(3, 6, 8, 8)
+        self.assertTrue(np.array_equal(tiled[:, :, 1:, :], self.data_in))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,76 @@
+'''Testing the process wide npy header cache'''
+import os
+import unittest
+import numpy as np
+
+from npy_patcher import (
+    PatcherFloat,
+    PatcherSessionFloat,
+    clear_header_cache,
+    get_header_cache_stats,
+    set_header_cache_capacity,
+)
+
+
+class TestHeaderCache(unittest.TestCase):
+    '''Header cache test case'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_header_cache.npy'
+        self.data_in = np.random.randn(3, 10, 12).astype(np.float32)
+        np.save(self.filepath, self.data_in, allow_pickle=False)
+        self.args = {'fpath': self.filepath, 'qidx': [0, 2], 'pshape': (5, 6), 'pstride': (5, 6)}
+        set_header_cache_capacity(4096)
+        clear_header_cache()
+
+    def tearDown(self):
+        os.remove(self.filepath)
+        set_header_cache_capacity(4096)
+
+    def test_hit(self):
+        '''Tests header is parsed once across objects'''
+        for _ in range(3):
+            PatcherSessionFloat(**self.args)
+        PatcherFloat().get_patch(pnum=0, padding=(), pnum_offset=(), **self.args)
+        stats = get_header_cache_stats()
+        self.assertEqual(stats['misses'], 1)
+        self.assertEqual(stats['hits'], 3)
+        self.assertEqual(stats['size'], 1)
+
+    def test_modified_file(self):
+        '''Tests a rewritten file is not served the cached header'''
+        PatcherSessionFloat(**self.args)
+        data_in = np.random.randn(3, 20, 12).astype(np.float32)
+        np.save(self.filepath, data_in, allow_pickle=False)
+        session = PatcherSessionFloat(**self.args)
+        self.assertEqual(session.get_data_shape(), [3, 20, 12])
+        self.assertTrue(np.array_equal(session.get_patch(0), data_in[[0, 2], 0:5, 0:6]))
+        self.assertEqual(get_header_cache_stats()['misses'], 2)
+
+    def test_same_size_rewrite(self):
+        '''Tests a same size file rewritten in place, or removed & written again, is reparsed'''
+        PatcherSessionFloat(**self.args)
+        np.save(self.filepath, self.data_in.view(np.int32), allow_pickle=False)
+        with self.assertRaisesRegex(RuntimeError, 'Type mismatch'):
+            PatcherSessionFloat(**self.args)
+        os.remove(self.filepath)
+        data_in = np.random.randn(3, 12, 10).astype(np.float32)
+        np.save(self.filepath, data_in, allow_pickle=False)
+        session = PatcherSessionFloat(**self.args)
+        self.assertEqual(session.get_data_shape(), [3, 12, 10])
+        self.assertTrue(np.array_equal(session.get_patch(0), data_in[[0, 2], 0:5, 0:6]))
+        self.assertEqual(get_header_cache_stats()['misses'], 3)
+
+    def test_capacity(self):
+        '''Tests cache of zero capacity does not cache headers'''
+        set_header_cache_capacity(0)
+        PatcherSessionFloat(**self.args)
+        session = PatcherSessionFloat(**self.args)
+        self.assertTrue(np.array_equal(session.get_patch(0), self.data_in[[0, 2], 0:5, 0:6]))
+        stats = get_header_cache_stats()
+        self.assertEqual(stats['misses'], 2)
+        self.assertEqual(stats['size'], 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,148 @@
+'''Testing per channel normalization during extraction'''
+import os
+import pickle
+import unittest
+import numpy as np
+
+from npy_patcher import (
+    GridIteratorFloat,
+    PatcherSessionDouble,
+    PatcherSessionFloat,
+    PatcherSessionInt,
+    ReadMode,
+)
+
+
+class BaseTestCases:
+    '''Base test case class with TestClass members'''
+
+    class BaseTest(unittest.TestCase):
+        '''Actual Base test class'''
+
+        # pylint: disable=no-member
+
+        def setUp(self) -> None:
+            self.set_up_vars()
+            data_in = (np.random.rand(*self.shape) * 1000 - 300).astype(self.dtype)
+            np.save(self.filepath, data_in, allow_pickle=False)
+            self.ones_filepath = self.filepath.replace('.npy', '_ones.npy')
+            np.save(self.ones_filepath, np.ones(self.shape, self.dtype), allow_pickle=False)
+            self.kwargs = {'qidx': self.qidx, 'pshape': self.pshape, 'pstride': self.pstride}
+            self.clip = (-100.0, 250.0)
+            self.fill_value = -5.0
+
+        def tearDown(self):
+            os.remove(self.filepath)
+            os.remove(self.ones_filepath)
+
+        def set_up_vars(self):
+            '''Method to setup vars for testing'''
+            raise NotImplementedError
+
+        def get_expected(self, pnums, scale, offset):
+            '''Normalizes unnormalized patches in NumPy, padded regions given by the patches of
+            data of ones'''
+            session = self.session_class(self.filepath, **self.kwargs)
+            data = session.get_patches(pnums)
+            mask = self.session_class(self.ones_filepath, **self.kwargs).get_patches(pnums)
+            shape = (1, -1) + (1,) * len(self.pshape)
+            scale = np.array(scale, self.dtype).reshape(shape)
+            offset = np.array(offset, self.dtype).reshape(shape)
+            lo, hi = self.dtype(self.clip[0]), self.dtype(self.clip[1])
+            norm = np.clip(data * scale + offset, lo, hi)
+            return np.where(mask == 1, norm, self.dtype(self.fill_value))
+
+        def get_pnums(self):
+            '''Gets all patch numbers'''
+            session = self.session_class(self.filepath, **self.kwargs)
+            return list(range(np.prod(session.get_num_patches())))
+
+        def test_session(self):
+            '''Tests normalized patches are equal to patches normalized in NumPy'''
+            pnums = self.get_pnums()
+            scale = [0.5 + i for i in range(len(self.qidx))]
+            offset = [10.0 - (3 * i) for i in range(len(self.qidx))]
+            data_out_true = self.get_expected(pnums, scale, offset)
+            for mode in (ReadMode.stream, ReadMode.mmap, ReadMode.uring):
+                with self.subTest(f'Mode: {mode}'):
+                    session = self.session_class(self.filepath, **self.kwargs, mode=mode)
+                    session.set_normalization(scale, offset, *self.clip, self.fill_value)
+                    data_out_test = session.get_patches(pnums, num_threads=2)
+                    self.assertTrue(np.array_equal(data_out_test, data_out_true))
+
+        def test_single_channel_parameters(self):
+            '''Tests a single scale & offset is applied to every qspace index'''
+            pnums = self.get_pnums()
+            data_out_true = self.get_expected(pnums, [2.0] * len(self.qidx), [1.5] * len(self.qidx))
+            session = self.session_class(self.filepath, **self.kwargs)
+            session.set_normalization([2.0], [1.5], *self.clip, self.fill_value)
+            self.assertTrue(np.array_equal(session.get_patches(pnums), data_out_true))
+
+        def test_clear(self):
+            '''Tests clearing the normalization returns unnormalized, zero padded patches'''
+            pnums = self.get_pnums()
+            session = self.session_class(self.filepath, **self.kwargs)
+            data_out_true = session.get_patches(pnums)
+            session.set_normalization([2.0], [1.5])
+            session.clear_normalization()
+            self.assertIsNone(session.get_normalization())
+            self.assertTrue(np.array_equal(session.get_patches(pnums), data_out_true))
+
+        def test_pickle(self):
+            '''Tests the normalization is kept when pickled'''
+            session = self.session_class(self.filepath, **self.kwargs)
+            session.set_normalization([2.0], [1.5], *self.clip, self.fill_value)
+            unpickled = pickle.loads(pickle.dumps(session))
+            self.assertEqual(unpickled.get_normalization(), session.get_normalization())
+            self.assertTrue(np.array_equal(unpickled.get_patch(0), session.get_patch(0)))
+
+        def test_invalid_channels(self):
+            '''Tests the number of channels must match the qspace index'''
+            session = self.session_class(self.filepath, **self.kwargs)
+            num_channels = len(self.qidx) + 1
+            with self.assertRaises(RuntimeError):
+                session.set_normalization([1.0] * num_channels, [0.0] * num_channels)
+
+
+class TestNormalize2D(BaseTestCases.BaseTest):
+    '''2D float test case, with padding'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_normalize_2d.npy'
+        self.shape = (4, 30, 27)
+        self.dtype = np.float32
+        self.qidx = [3, 0, 1]
+        self.pshape = (8, 8)
+        self.pstride = (6, 5)
+        self.session_class = PatcherSessionFloat
+
+    def test_grid(self):
+        '''Tests grid iterator output is equal to that of the session'''
+        pnums = self.get_pnums()
+        data_out_true = self.get_expected(pnums, [0.5, 1.0, 2.0], [0.0, 1.0, 2.0])
+        grid = GridIteratorFloat(self.filepath, **self.kwargs)
+        grid.set_normalization([0.5, 1.0, 2.0], [0.0, 1.0, 2.0], *self.clip, self.fill_value)
+        self.assertTrue(np.array_equal(np.stack(list(grid)), data_out_true))
+
+    def test_int(self):
+        '''Tests normalization of integer patches raises an error'''
+        session = PatcherSessionInt(self.filepath.replace('.npy', '_ones.npy'), **self.kwargs)
+        with self.assertRaises(RuntimeError):
+            session.set_normalization([1.0], [0.0])
+
+
+class TestNormalize3D(BaseTestCases.BaseTest):
+    '''3D double test case, with padding'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_normalize_3d.npy'
+        self.shape = (3, 10, 9, 14)
+        self.dtype = np.float64
+        self.qidx = [2, 0]
+        self.pshape = (5, 4, 6)
+        self.pstride = (4, 3, 4)
+        self.session_class = PatcherSessionDouble
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,89 @@
+'''Testing patch extraction from npz archive members'''
+import os
+import unittest
+import numpy as np
+
+from npy_patcher import (
+    GridIteratorFloat,
+    PatcherDouble,
+    PatcherSessionDouble,
+    PatcherSessionFloat,
+    ReadMode,
+)
+
+
+class TestNpz(unittest.TestCase):
+    '''NPZ test case comparing output to that of the equivalent npy files'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_npz.npz'
+        self.image = np.random.randn(4, 21, 17).astype(np.float32)
+        self.volume = np.random.randn(3, 9, 10, 8)
+        fortran = np.asfortranarray(self.image)
+        np.savez(self.filepath, self.image, volume=self.volume, fortran=fortran)
+        self.npy_filepath = 'test_data_npz.npy'
+        np.save(self.npy_filepath, self.image, allow_pickle=False)
+        self.image_args = {'qidx': [3, 0], 'pshape': (6, 5), 'pstride': (4, 4)}
+
+    def tearDown(self):
+        os.remove(self.filepath)
+        os.remove(self.npy_filepath)
+
+    def get_all(self, session):
+        '''Gets every patch of the session'''
+        return session.get_patches(list(range(np.prod(session.get_num_patches()))))
+
+    def test_members(self):
+        '''Tests each member is read equal to the npy file, with or without extension'''
+        data_out_true = self.get_all(PatcherSessionFloat(self.npy_filepath, **self.image_args))
+        for member in ('arr_0', 'arr_0.npy', 'fortran'):
+            for mode in (ReadMode.stream, ReadMode.mmap, ReadMode.uring):
+                with self.subTest(f'Member: {member}, mode: {mode}'):
+                    fpath = f'{self.filepath}/{member}'
+                    session = PatcherSessionFloat(fpath, **self.image_args, mode=mode)
+                    self.assertTrue(np.array_equal(self.get_all(session), data_out_true))
+
+    def test_volume(self):
+        '''Tests a 3D member against the array saved'''
+        args = {'qidx': [2, 1], 'pshape': (9, 10, 8), 'pstride': (9, 10, 8)}
+        session = PatcherSessionDouble(f'{self.filepath}/volume', **args)
+        self.assertTrue(np.array_equal(session.get_patch(0), self.volume[[2, 1]]))
+        patch = PatcherDouble().get_patch(
+            f'{self.filepath}/volume', pnum=0, padding=(), pnum_offset=(), **args
+        )
+        self.assertTrue(np.array_equal(np.array(patch).reshape(2, 9, 10, 8), self.volume[[2, 1]]))
+
+    def test_grid(self):
+        '''Tests grid iteration of a member'''
+        grid = GridIteratorFloat(f'{self.filepath}/arr_0', **self.image_args)
+        data_out_true = self.get_all(PatcherSessionFloat(self.npy_filepath, **self.image_args))
+        self.assertTrue(np.array_equal(np.stack(list(grid)), data_out_true))
+
+    def test_rewritten_archive(self):
+        '''Tests an archive rewritten to the same size with its members reordered is rescanned'''
+        data_out_true = self.get_all(PatcherSessionFloat(self.npy_filepath, **self.image_args))
+        session = PatcherSessionFloat(f'{self.filepath}/arr_0', **self.image_args)
+        self.assertTrue(np.array_equal(self.get_all(session), data_out_true))
+        size = os.path.getsize(self.filepath)
+        os.remove(self.filepath)
+        fortran = np.asfortranarray(self.image)
+        np.savez(self.filepath, arr_0=self.image, volume=self.volume, fortran=fortran)
+        self.assertEqual(os.path.getsize(self.filepath), size)
+        session = PatcherSessionFloat(f'{self.filepath}/arr_0', **self.image_args)
+        self.assertTrue(np.array_equal(self.get_all(session), data_out_true))
+
+    def test_errors(self):
+        '''Tests compressed & missing members raise an error'''
+        compressed_filepath = 'test_data_npz_compressed.npz'
+        np.savez_compressed(compressed_filepath, self.image)
+        try:
+            with self.assertRaisesRegex(RuntimeError, 'compressed'):
+                PatcherSessionFloat(f'{compressed_filepath}/arr_0', **self.image_args)
+        finally:
+            os.remove(compressed_filepath)
+        with self.assertRaisesRegex(RuntimeError, 'not found'):
+            PatcherSessionFloat(f'{self.filepath}/missing', **self.image_args)
+
+
+if __name__ == '__main__':
+    unittest.main()
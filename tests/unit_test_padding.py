@@ -0,0 +1,155 @@
+'''Testing padding modes during extraction'''
+import os
+import pickle
+import unittest
+import numpy as np
+
+from skimage.util import view_as_windows
+
+from npy_patcher import (
+    GridIteratorFloat,
+    PadMode,
+    PatcherSessionFloat,
+    PatcherSessionInt,
+    ReadMode,
+)
+
+MODES = {
+    PadMode.edge: 'edge',
+    PadMode.reflect: 'reflect',
+    PadMode.symmetric: 'symmetric',
+    PadMode.wrap: 'wrap',
+}
+
+
+class BaseTestCases:
+    '''Base test case class with TestClass members'''
+
+    class BaseTest(unittest.TestCase):
+        '''Actual Base test class'''
+
+        # pylint: disable=no-member
+
+        def setUp(self) -> None:
+            self.set_up_vars()
+            self.data_in = (np.random.rand(*self.shape) * 1000).astype(self.dtype)
+            np.save(self.filepath, self.data_in, allow_pickle=False)
+            self.fortran_filepath = self.filepath.replace('.npy', '_fortran.npy')
+            np.save(self.fortran_filepath, np.asfortranarray(self.data_in), allow_pickle=False)
+            self.kwargs = {
+                'qidx': self.qidx,
+                'pshape': self.pshape,
+                'pstride': self.pstride,
+                'padding': list(sum(self.extra_padding, ())),
+            }
+            padding = self.session_class(self.filepath, **self.kwargs).get_padding()
+            self.padding = tuple(zip(padding[::2], padding[1::2]))
+
+        def tearDown(self):
+            os.remove(self.filepath)
+            os.remove(self.fortran_filepath)
+
+        def set_up_vars(self):
+            '''Method to setup vars for testing'''
+            raise NotImplementedError
+
+        def get_expected(self, *args, **kwargs):
+            '''Pads the data with np.pad, then splits it into patches'''
+            data_out = np.pad(self.data_in, ((0, 0),) + self.padding, *args, **kwargs)
+            data_out = view_as_windows(
+                data_out,
+                (len(self.data_in),) + tuple(self.pshape),
+                (len(self.data_in),) + tuple(self.pstride),
+            )
+            data_out = data_out.reshape((-1, len(self.data_in)) + tuple(self.pshape))
+            return data_out[:, self.qidx, ...]
+
+        def test_modes(self):
+            '''Tests each padding mode is equal to np.pad'''
+            for mode, np_mode in MODES.items():
+                data_out_true = self.get_expected(np_mode)
+                pnums = list(range(len(data_out_true)))
+                for read_mode in (ReadMode.stream, ReadMode.mmap, ReadMode.uring):
+                    with self.subTest(f'Mode: {mode}, {read_mode}'):
+                        session = self.session_class(self.filepath, **self.kwargs, mode=read_mode)
+                        session.set_padding_mode(mode)
+                        data_out_test = session.get_patches(pnums, num_threads=2)
+                        self.assertTrue(np.array_equal(data_out_test, data_out_true))
+                        self.assertTrue(np.array_equal(session.get_patch(1), data_out_true[1]))
+
+        def test_fortran(self):
+            '''Tests padding modes of Fortran ordered files'''
+            for mode, np_mode in MODES.items():
+                with self.subTest(f'Mode: {mode}'):
+                    data_out_true = self.get_expected(np_mode)
+                    session = self.session_class(self.fortran_filepath, **self.kwargs)
+                    session.set_padding_mode(mode)
+                    data_out_test = session.get_patches(list(range(len(data_out_true))))
+                    self.assertTrue(np.array_equal(data_out_test, data_out_true))
+
+        def test_constant(self):
+            '''Tests constant padding with a non zero value'''
+            data_out_true = self.get_expected('constant', constant_values=7)
+            session = self.session_class(self.filepath, **self.kwargs)
+            session.set_padding_mode(PadMode.constant, 7)
+            self.assertEqual(session.get_padding_mode(), PadMode.constant)
+            self.assertEqual(session.get_padding_value(), 7)
+            data_out_test = session.get_patches(list(range(len(data_out_true))))
+            self.assertTrue(np.array_equal(data_out_test, data_out_true))
+
+        def test_pickle(self):
+            '''Tests the padding mode is kept when pickled'''
+            session = self.session_class(self.filepath, **self.kwargs)
+            session.set_padding_mode(PadMode.reflect)
+            unpickled = pickle.loads(pickle.dumps(session))
+            self.assertEqual(unpickled.get_padding_mode(), PadMode.reflect)
+            self.assertTrue(np.array_equal(unpickled.get_patch(0), session.get_patch(0)))
+
+
+class TestPadding2D(BaseTestCases.BaseTest):
+    '''2D float test case'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_padding_2d.npy'
+        self.shape = (4, 9, 10)
+        self.dtype = np.float32
+        self.qidx = [3, 0, 1]
+        self.pshape = (3, 4)
+        self.pstride = (3, 2)
+        self.extra_padding = ((3, 0), (2, 2))
+        self.session_class = PatcherSessionFloat
+
+    def test_grid(self):
+        '''Tests grid iterator output is equal to np.pad'''
+        for mode, np_mode in MODES.items():
+            with self.subTest(f'Mode: {mode}'):
+                grid = GridIteratorFloat(self.filepath, **self.kwargs)
+                grid.set_padding_mode(mode)
+                self.assertTrue(np.array_equal(np.stack(list(grid)), self.get_expected(np_mode)))
+
+    def test_normalized(self):
+        '''Tests gathered padding is normalized as the rest of the patch'''
+        data_out_true = self.get_expected('symmetric') * np.float32(2) + np.float32(1)
+        session = self.session_class(self.filepath, **self.kwargs)
+        session.set_padding_mode(PadMode.symmetric)
+        session.set_normalization([2.0], [1.0])
+        data_out_test = session.get_patches(list(range(len(data_out_true))))
+        self.assertTrue(np.array_equal(data_out_test, data_out_true))
+
+
+class TestPadding3D(BaseTestCases.BaseTest):
+    '''3D int test case, with automatic padding'''
+
+    def set_up_vars(self):
+        self.filepath = 'test_data_padding_3d.npy'
+        self.shape = (3, 6, 5, 7)
+        self.dtype = np.int32
+        self.qidx = [2, 0]
+        self.pshape = (4, 3, 3)
+        self.pstride = (2, 3, 2)
+        self.extra_padding = ((2, 0), (0, 3), (1, 1))
+        self.session_class = PatcherSessionInt
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,92 @@
+'''Testing patch extraction from patch-major files'''
+import os
+import pickle
+import unittest
+import numpy as np
+
+from npy_patcher import (
+    PadMode,
+    PatchMajorReaderFloat,
+    PatchMajorReaderLong,
+    PatcherSessionFloat,
+    PatcherSessionLong,
+    convert_to_patch_major,
+)
+
+
+class TestPatchMajor(unittest.TestCase):
+    '''Patch-major test case comparing output to that of a session of the npy file'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_patch_major.npy'
+        self.pm_filepath = 'test_data_patch_major.npp'
+        self.data_in = np.random.randn(5, 21, 17).astype(np.float32)
+        np.save(self.filepath, self.data_in, allow_pickle=False)
+        self.kwargs = {'pshape': (6, 5), 'pstride': (4, 4), 'padding': (0, 0, 2, 2)}
+        self.session = PatcherSessionFloat(self.filepath, [3, 0, 4], **self.kwargs)
+        self.session.set_padding_mode(PadMode.edge)
+        self.pnums = list(range(np.prod(self.session.get_num_patches())))
+
+    def tearDown(self):
+        os.remove(self.filepath)
+        if os.path.exists(self.pm_filepath):
+            os.remove(self.pm_filepath)
+
+    def test_patches(self):
+        '''Tests patches are equal to those of the session, read singly and in batches'''
+        convert_to_patch_major(self.session, self.pm_filepath, num_threads=2)
+        reader = PatchMajorReaderFloat(self.pm_filepath)
+        self.assertEqual(reader.get_padding(), self.session.get_padding())
+        self.assertEqual(reader.get_num_patches(), self.session.get_num_patches())
+        self.assertEqual(reader.get_num_reads(), 1)
+        data_out_true = self.session.get_patches(self.pnums)
+        for pnum in self.pnums:
+            self.assertTrue(np.array_equal(reader.get_patch(pnum), data_out_true[pnum]))
+        self.assertTrue(np.array_equal(reader.get_patches(self.pnums), data_out_true))
+        self.assertTrue(
+            np.array_equal(reader.get_patches(self.pnums[::-1], 3), data_out_true[::-1])
+        )
+        reader = pickle.loads(pickle.dumps(reader))
+        self.assertTrue(np.array_equal(reader.get_patches(self.pnums), data_out_true))
+
+    def test_qidx_subset(self):
+        '''Tests a subset of the stored qspace indices is read in the requested order'''
+        convert_to_patch_major(self.session, self.pm_filepath)
+        for qidx, num_reads in (([0, 4], 1), ([4, 3], 2), ([0], 1), ([4, 0, 3], 3)):
+            with self.subTest(f'qidx: {qidx}'):
+                session = PatcherSessionFloat(self.filepath, qidx, **self.kwargs)
+                session.set_padding_mode(PadMode.edge)
+                reader = PatchMajorReaderFloat(self.pm_filepath, qidx)
+                self.assertEqual(reader.get_num_reads(), num_reads)
+                self.assertTrue(
+                    np.array_equal(reader.get_patches(self.pnums), session.get_patches(self.pnums))
+                )
+
+    def test_type(self):
+        '''Tests integer patches are read from a session of big endian data'''
+        data_in = np.random.randint(-1000, 1000, (3, 9, 10, 8)).astype('>i2')
+        np.save(self.filepath, data_in, allow_pickle=False)
+        session = PatcherSessionLong(self.filepath, [2, 1], (4, 5, 3), (2, 5, 3))
+        convert_to_patch_major(session, self.pm_filepath)
+        reader = PatchMajorReaderLong(self.pm_filepath)
+        pnums = list(range(np.prod(session.get_num_patches())))
+        self.assertTrue(np.array_equal(reader.get_patches(pnums), session.get_patches(pnums)))
+
+    def test_errors(self):
+        '''Tests errors for the wrong type, qspace indices, patch numbers & files'''
+        convert_to_patch_major(self.session, self.pm_filepath)
+        with self.assertRaisesRegex(RuntimeError, 'Type mismatch'):
+            PatchMajorReaderLong(self.pm_filepath)
+        with self.assertRaisesRegex(RuntimeError, 'qspace index 1 is not stored'):
+            PatchMajorReaderFloat(self.pm_filepath, [1])
+        with self.assertRaisesRegex(RuntimeError, 'Max patch index'):
+            PatchMajorReaderFloat(self.pm_filepath).get_patch(len(self.pnums))
+        with self.assertRaisesRegex(RuntimeError, 'Not a patch-major file'):
+            PatchMajorReaderFloat(self.filepath)
+        session = PatcherSessionFloat(self.filepath, [0], (6, 5), (4, 4), pnum_offset=(1, 0))
+        with self.assertRaisesRegex(RuntimeError, 'patch number offset'):
+            convert_to_patch_major(session, self.pm_filepath)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,75 @@
+'''Testing prefetched patch extraction'''
+import os
+import unittest
+import numpy as np
+
+from npy_patcher import PatcherSessionFloat, PrefetcherFloat, ReadMode
+
+
+def get_test_data_2d(filepath):
+    '''Testing: 2D shape, overlapping patches
+
+    Datatype: float
+    '''
+    data_in = np.random.randn(5, 26, 19).astype(np.float32)
+    np.save(filepath, data_in, allow_pickle=False)
+    data_in_dict = {
+        'fpath': filepath,
+        'qidx': np.array([4, 0, 2]),
+        'pshape': (8, 5),
+        'pstride': (3, 2),
+    }
+
+    return data_in_dict
+
+
+class TestPrefetcher(unittest.TestCase):
+    '''Prefetcher test case comparing output to session output'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_prefetch.npy'
+        self.data_in = get_test_data_2d(self.filepath)
+        self.session = PatcherSessionFloat(**self.data_in, mode=ReadMode.pread)
+        self.num_patches = int(np.prod(self.session.get_num_patches()))
+
+    def tearDown(self):
+        del self.session
+        os.remove(self.filepath)
+
+    def test_order(self):
+        '''Tests patches are returned in order of pnums'''
+        pnums = np.random.permutation(self.num_patches).tolist() * 2
+        prefetcher = PrefetcherFloat(self.session, pnums, depth=4, num_threads=3)
+        self.assertEqual(len(prefetcher), len(pnums))
+        patches = list(prefetcher)
+        self.assertEqual(len(patches), len(pnums))
+        for pnum, data_out_test in zip(pnums, patches):
+            with self.subTest(f'Patch: {pnum}'):
+                self.assertTrue(np.array_equal(data_out_test, self.session.get_patch(pnum)))
+
+    def test_iterable(self):
+        '''Tests pnums given by a finite generator'''
+        pnums = (pnum for pnum in range(self.num_patches) if pnum % 2 == 0)
+        patches = list(PrefetcherFloat(self.session, pnums))
+        self.assertEqual(len(patches), (self.num_patches + 1) // 2)
+        self.assertTrue(np.array_equal(patches[1], self.session.get_patch(2)))
+
+    def test_early_delete(self):
+        '''Tests deleting before all patches are consumed'''
+        prefetcher = PrefetcherFloat(self.session, range(self.num_patches), num_threads=4)
+        next(prefetcher)
+        del prefetcher
+
+    def test_invalid_pnum(self):
+        '''Tests invalid pnum raises in order, and later patches are still returned'''
+        prefetcher = PrefetcherFloat(self.session, [0, self.num_patches, 1], depth=2)
+        next(prefetcher)
+        with self.assertRaises(RuntimeError):
+            next(prefetcher)
+        self.assertTrue(np.array_equal(next(prefetcher), self.session.get_patch(1)))
+        with self.assertRaises(StopIteration):
+            next(prefetcher)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,132 @@
+'''Testing seeded random patch sampling'''
+import os
+import unittest
+import numpy as np
+
+from npy_patcher import LocalShuffle, PatcherSessionFloat, PatchSamplerFloat, ReadMode
+
+
+class TestSampler(unittest.TestCase):
+    '''Sampler test case comparing output to session output'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_sampler.npy'
+        np.save(self.filepath, np.random.randn(5, 26, 19).astype(np.float32), allow_pickle=False)
+        self.session = PatcherSessionFloat(
+            self.filepath, [4, 0, 2], (8, 5), (3, 2), mode=ReadMode.pread
+        )
+        self.num_patches = self.session.get_num_patches()
+
+    def tearDown(self):
+        del self.session
+        os.remove(self.filepath)
+
+    def test_patches(self):
+        '''Tests sampled patches are equal to the patches of the sampled pnums'''
+        sampler = PatchSamplerFloat(self.session, 1234)
+        pnums, patches = sampler.sample(64, num_threads=3)
+        self.assertEqual(pnums.shape, (64,))
+        self.assertTrue(np.array_equal(patches, self.session.get_patches(pnums.tolist())))
+        self.assertTrue(np.all(pnums < np.prod(self.num_patches)))
+
+    def test_reproducible(self):
+        '''Tests a seed, epoch & worker give the same batches, and others do not'''
+        samplers = [PatchSamplerFloat(self.session, 1234) for _ in range(2)]
+        for sampler in samplers:
+            sampler.set_epoch(3, worker=1)
+        batches = [[sampler.sample_pnums(32) for _ in range(3)] for sampler in samplers]
+        self.assertTrue(np.array_equal(batches[0], batches[1]))
+        self.assertFalse(np.array_equal(batches[0][0], batches[0][1]))
+        for epoch, worker in ((4, 1), (3, 2)):
+            with self.subTest(f'Epoch: {epoch}, worker: {worker}'):
+                samplers[1].set_epoch(epoch, worker)
+                self.assertFalse(np.array_equal(samplers[1].sample_pnums(32), batches[0][0]))
+
+    def test_bounds(self):
+        '''Tests only patches within the bounds are drawn'''
+        lower, upper = (1, 2), (4, 5)
+        sampler = PatchSamplerFloat(self.session, 7, lower=lower, upper=upper)
+        self.assertEqual(len(sampler), 9)
+        index = np.unravel_index(sampler.sample_pnums(1000), self.num_patches)
+        for dim in range(2):
+            self.assertEqual(set(index[dim]), set(range(lower[dim], upper[dim])))
+
+    def test_weights(self):
+        '''Tests patches are drawn in proportion to their weight'''
+        weights = np.zeros(np.prod(self.num_patches))
+        weights[[0, 5, 9]] = [1.0, 3.0, 0.5]
+        sampler = PatchSamplerFloat(self.session, 7, weights=weights)
+        self.assertEqual(len(sampler), 3)
+        pnums = sampler.sample_pnums(45000).astype(np.int64)
+        counts = np.bincount(pnums, minlength=len(weights))
+        self.assertEqual(counts.sum(), counts[[0, 5, 9]].sum())
+        expected = np.array([1.0, 3.0, 0.5]) / 4.5
+        self.assertTrue(np.allclose(counts[[0, 5, 9]] / 45000, expected, atol=0.01))
+
+    def test_invalid(self):
+        '''Tests invalid bounds & weights raise an error'''
+        with self.assertRaises(RuntimeError):
+            PatchSamplerFloat(self.session, 0, lower=(0, 0), upper=(self.num_patches[0] + 1, 1))
+        with self.assertRaises(RuntimeError):
+            PatchSamplerFloat(self.session, 0, weights=[1.0, 2.0])
+        with self.assertRaises(RuntimeError):
+            PatchSamplerFloat(self.session, 0, weights=np.zeros(np.prod(self.num_patches)))
+
+
+class TestLocalShuffle(unittest.TestCase):
+    '''Locality preserving shuffle test case'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_shuffle.npy'
+        np.save(self.filepath, np.zeros((3, 120, 90), dtype=np.float32), allow_pickle=False)
+        self.session = PatcherSessionFloat(self.filepath, [0, 2], (8, 8), (4, 4))
+        self.num_patches = int(np.prod(self.session.get_num_patches()))
+
+    def tearDown(self):
+        del self.session
+        os.remove(self.filepath)
+
+    def test_permutation(self):
+        '''Tests each epoch is a different permutation of every patch'''
+        shuffle = LocalShuffle(self.session, 1234, partition_size=16, window=4)
+        self.assertEqual(len(shuffle), self.num_patches)
+        epochs = [shuffle.get_epoch(epoch) for epoch in range(2)]
+        for pnums in epochs:
+            self.assertTrue(np.array_equal(np.sort(pnums), np.arange(self.num_patches)))
+        self.assertFalse(np.array_equal(epochs[0], epochs[1]))
+        self.assertTrue(np.array_equal(shuffle.get_epoch(0), epochs[0]))
+
+    def test_shards(self):
+        '''Tests the worker shards of an epoch concatenate to the whole epoch'''
+        shuffle = LocalShuffle(self.session, 1234)
+        shards = [shuffle.get_epoch(3, worker, 3) for worker in range(3)]
+        self.assertTrue(np.array_equal(np.concatenate(shards), shuffle.get_epoch(3)))
+
+    def test_sequential(self):
+        '''Tests a window of 1 reads partitions in file order'''
+        size = self.session.get_num_patches()[1]
+        shuffle = LocalShuffle(self.session, 1234, partition_size=size, window=1)
+        pnums = shuffle.get_epoch(0)
+        offsets = np.array([self.session.get_patch_offset(pnum) for pnum in pnums.tolist()])
+        for partition in np.split(offsets, range(size, len(offsets), size)):
+            with self.subTest(f'Partition at: {partition[0]}'):
+                self.assertTrue(np.all(np.diff(partition) >= 0))
+
+    def test_bytes_seeked(self):
+        '''Tests larger windows seek further, and in order reads seek the least'''
+        seeked = [
+            LocalShuffle(self.session, 1234, partition_size=64, window=window)
+            .expected_bytes_seeked()
+            for window in (1, 8, 64)
+        ]
+        self.assertTrue(seeked[0] < seeked[1] < seeked[2])
+        shuffle = LocalShuffle(self.session, 1234)
+        order = sorted(range(self.num_patches), key=self.session.get_patch_offset)
+        self.assertEqual(
+            shuffle.bytes_seeked(order),
+            self.session.get_patch_offset(order[-1]) - self.session.get_patch_offset(order[0]),
+        )
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,237 @@
+'''Testing PatcherSession class'''
+import os
+import pickle
+import unittest
+from concurrent.futures import ThreadPoolExecutor
+import numpy as np
+
+from skimage.util import view_as_windows
+
+from npy_patcher import AccessHint, PatcherFloat, PatcherSessionFloat, PatcherSessionInt, ReadMode
+
+
+def get_test_data_2d(filepath):
+    '''Testing: 2D shape with non-contiguous qspace indexing and overlapping patches
+
+    Datatype: int
+    Padding required: (2, 0, 2, 2)
+    '''
+    data_in = np.arange(9).reshape(1, 3, 3).astype(np.int32)
+    data_in = np.pad(data_in, ((0, 0), (1, 1), (1, 1)), constant_values=42)
+    rand = lambda x: np.random.randint(0, 50, (x, 5, 5), dtype=np.int32)
+    data_in = np.concatenate([data_in, rand(4), data_in, data_in, rand(2)], axis=0)
+    pshape = [3, 3]
+    qidx = np.array([0, 5, 6])
+    np.save(filepath, data_in, allow_pickle=False)
+    extra_padding = ((2, 0), (2, 2))
+    data_in_dict = {
+        'fpath': filepath,
+        'pshape': pshape,
+        'pstride': [2, 2],
+        'qidx': qidx,
+        'padding': list(sum(extra_padding, ())),
+    }
+    data_out = np.pad(data_in, ((0, 0),) + extra_padding)
+    data_out = view_as_windows(
+        data_out,
+        (len(data_in),) + tuple(pshape),
+        (len(data_in),) + tuple(data_in_dict['pstride']),
+    )
+    data_out = data_out.flatten().reshape((-1, len(data_in)) + tuple(pshape))
+    data_out = data_out[:, qidx, ...]
+    data_out_dict = {
+        'pnums': 12,
+        'padding': tuple(sum(extra_padding, ())),
+        'data_out': data_out,
+    }
+
+    return data_in_dict, data_out_dict
+
+
+def get_test_data_3d(filepath):
+    '''Testing: 3D shape, compared against the stateless Patcher
+
+    Datatype: float
+    Padding required: (0, 0, 4, 3, 2, 1)
+    '''
+    data_in = np.random.randn(5, 12, 33, 22).astype(np.float32)
+    np.save(filepath, data_in, allow_pickle=False)
+    data_in_dict = {
+        'fpath': filepath,
+        'qidx': np.array([4, 0, 2]),
+        'pshape': (3, 10, 5),
+        'pstride': (3, 10, 5),
+        'padding': [],
+    }
+    data_out_dict = {
+        'pnums': 4 * 4 * 5,
+        'padding': (0, 0, 4, 3, 2, 1),
+    }
+
+    return data_in_dict, data_out_dict
+
+
+class TestPatcherSession2D(unittest.TestCase):
+    '''2D test case testing each patch from one session'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_session_2D.npy'
+        self.data_in, self.data_out = get_test_data_2d(self.filepath)
+        self.session = PatcherSessionInt(**self.data_in)
+
+    def tearDown(self):
+        del self.session
+        os.remove(self.filepath)
+
+    def test_equality_loop(self):
+        '''Tests equality of array output for each patch'''
+        pshape = (len(self.data_in['qidx']),) + tuple(self.data_in['pshape'])
+        for pnum in range(self.data_out['pnums']):
+            with self.subTest(f'Patch: {pnum}'):
+                data_out_test = np.array(self.session.get_patch(pnum)).reshape(pshape)
+                data_out_true = self.data_out['data_out'][pnum, ...]
+                self.assertTrue(
+                    np.array_equal(data_out_test, data_out_true),
+                    f'\n{data_out_test}\n\n-------\n{data_out_true}',
+                )
+
+    def test_reverse_order(self):
+        '''Tests patches are independent of the order they are read in'''
+        pshape = (len(self.data_in['qidx']),) + tuple(self.data_in['pshape'])
+        for pnum in reversed(range(self.data_out['pnums'])):
+            with self.subTest(f'Patch: {pnum}'):
+                data_out_test = np.array(self.session.get_patch(pnum)).reshape(pshape)
+                data_out_true = self.data_out['data_out'][pnum, ...]
+                self.assertTrue(np.array_equal(data_out_test, data_out_true))
+
+    def test_padding(self):
+        '''Tests padding value is correct'''
+        self.assertEqual(tuple(self.session.get_padding()), self.data_out['padding'])
+
+    def test_array_output(self):
+        '''Tests patch is returned as an array of shape (len(qidx), *pshape)'''
+        patch = self.session.get_patch(0)
+        self.assertIsInstance(patch, np.ndarray)
+        self.assertEqual(patch.dtype, np.int32)
+        self.assertEqual(patch.shape, (len(self.data_in['qidx']),) + tuple(self.data_in['pshape']))
+
+    def test_invalid_pnum(self):
+        '''Tests pnum outside range raises, and session is still usable afterwards'''
+        with self.assertRaises(RuntimeError):
+            self.session.get_patch(self.data_out['pnums'])
+        data_out_test = np.array(self.session.get_patch(0)).ravel()
+        self.assertTrue(np.array_equal(data_out_test, self.data_out['data_out'][0].ravel()))
+
+    def test_pickle(self):
+        '''Tests session can be pickled, i.e. sent to a data loader worker'''
+        session = pickle.loads(pickle.dumps(self.session))
+        for pnum in range(self.data_out['pnums']):
+            with self.subTest(f'Patch: {pnum}'):
+                data_out_test = session.get_patch(pnum)
+                self.assertTrue(np.array_equal(data_out_test, self.session.get_patch(pnum)))
+
+
+class TestPatcherSession3D(unittest.TestCase):
+    '''3D test case comparing session output to Patcher output'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_session_3D.npy'
+        self.data_in, self.data_out = get_test_data_3d(self.filepath)
+        self.session = PatcherSessionFloat(**self.data_in)
+        self.patcher = PatcherFloat()
+
+    def tearDown(self):
+        del self.session
+        os.remove(self.filepath)
+
+    def test_equality_loop(self):
+        '''Tests equality of session and Patcher output for each patch'''
+        for pnum in range(self.data_out['pnums']):
+            with self.subTest(f'Patch: {pnum}'):
+                data_out_test = self.session.get_patch(pnum)
+                data_out_true = self.patcher.get_patch(pnum=pnum, **self.data_in)
+                self.assertTrue(np.array_equal(data_out_test, data_out_true))
+
+    def test_geometry(self):
+        '''Tests geometry is equal to that of Patcher'''
+        self.patcher.debug_vars(pnum=0, **self.data_in)
+        self.assertEqual(self.session.get_padding(), self.patcher.get_padding())
+        self.assertEqual(self.session.get_num_patches(), self.patcher.get_num_patches())
+        self.assertEqual(self.session.get_data_strides(), self.patcher.get_data_strides())
+        self.assertEqual(tuple(self.session.get_padding()), self.data_out['padding'])
+
+    def test_plan_stats(self):
+        '''Tests read plan never needs more reads than rows'''
+        for pnum in range(self.data_out['pnums']):
+            with self.subTest(f'Patch: {pnum}'):
+                stats = self.session.get_plan_stats(pnum)
+                self.assertLessEqual(stats['runs'], stats['rows'])
+                self.assertLessEqual(stats['reads'], stats['runs'])
+                self.assertLessEqual(stats['bytes'], stats['read_bytes'])
+
+    def test_plan_stats_contiguous(self):
+        '''Tests patch spanning the full data extent of adjacent qidx is read in one run'''
+        session = PatcherSessionFloat(self.filepath, [0, 1, 2], (12, 33, 22), (12, 33, 22))
+        stats = session.get_plan_stats(0)
+        self.assertEqual(stats['rows'], 3 * 12 * 33)
+        self.assertEqual(stats['runs'], 1)
+        self.assertEqual(stats['bytes'], 3 * 12 * 33 * 22 * 4)
+        self.assertTrue(np.array_equal(session.get_patch(0), np.load(self.filepath)[0:3]))
+
+    def test_access_hint(self):
+        '''Tests batches are unchanged when the kernel is advised of the access pattern'''
+        pnums = list(range(self.data_out['pnums']))
+        data_out_true = self.session.get_patches(pnums)
+        for hint in AccessHint.__members__.values():
+            with self.subTest(f'Hint: {hint}'):
+                self.session.set_access_hint(hint)
+                self.assertEqual(self.session.get_access_hint(), hint)
+                self.assertTrue(np.array_equal(self.session.get_patches(pnums), data_out_true))
+                self.assertTrue(
+                    np.array_equal(self.session.get_patches(pnums, num_threads=2), data_out_true)
+                )
+        session = pickle.loads(pickle.dumps(self.session))
+        self.assertEqual(session.get_access_hint(), AccessHint.willneed)
+
+
+class TestPatcherSessionMmap2D(TestPatcherSession2D):
+    '''2D test case testing each patch from one memory mapped session'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_session_mmap_2D.npy'
+        self.data_in, self.data_out = get_test_data_2d(self.filepath)
+        self.session = PatcherSessionInt(**self.data_in, mode=ReadMode.mmap)
+
+
+class TestPatcherSessionMmap3D(TestPatcherSession3D):
+    '''3D test case comparing memory mapped session output to Patcher output'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_session_mmap_3D.npy'
+        self.data_in, self.data_out = get_test_data_3d(self.filepath)
+        self.session = PatcherSessionFloat(**self.data_in, mode=ReadMode.mmap)
+        self.patcher = PatcherFloat()
+
+
+class TestPatcherSessionPread3D(TestPatcherSession3D):
+    '''3D test case comparing pread session output to Patcher output'''
+
+    def setUp(self) -> None:
+        self.filepath = 'test_data_session_pread_3D.npy'
+        self.data_in, self.data_out = get_test_data_3d(self.filepath)
+        self.session = PatcherSessionFloat(**self.data_in, mode=ReadMode.pread)
+        self.patcher = PatcherFloat()
+
+    def test_concurrent(self):
+        '''Tests a single session called from multiple Python threads'''
+        pnums = list(range(self.data_out['pnums'])) * 4
+        with ThreadPoolExecutor(max_workers=4) as executor:
+            patches = list(executor.map(self.session.get_patch, pnums))
+        for pnum, data_out_test in zip(pnums, patches):
+            with self.subTest(f'Patch: {pnum}'):
+                data_out_true = self.patcher.get_patch(pnum=pnum, **self.data_in)
+                self.assertTrue(np.array_equal(data_out_test, data_out_true))
+
+
+if __name__ == '__main__':
+    unittest.main()
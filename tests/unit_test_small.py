@@ -182,6 +182,14 @@ class BaseTestCases:
             data_out_test = np.array(data_out_test).reshape(patch_shape)
             self.assertTrue(np.array_equal(data_out_test, self.data_out['data_out']))
 
+        def test_array_shape(self):
+            '''Tests output is an array of shape (len(qidx), *pshape)'''
+            data_out_test = self.run_get_patch()
+            patch_shape = (len(self.data_in['qidx']),) + tuple(self.data_in['pshape'])
+            self.assertIsInstance(data_out_test, np.ndarray)
+            self.assertEqual(data_out_test.shape, patch_shape)
+            self.assertEqual(data_out_test.dtype, self.data_out['data_out'].dtype)
+
         def test_padding(self):
             '''Tests padding value is correct'''
             self.debug_vars()